@@ -0,0 +1,134 @@
+#ifndef DYNAMIC_BENCH_HPP
+#define DYNAMIC_BENCH_HPP
+
+/*
+    Copyright (C) 2009, Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+///
+/// minimal benchmark harness for the bench target
+///
+namespace bench {
+
+typedef void (*case_function)();
+
+///
+/// registers a benchmark case at static initialization time
+///
+struct registrar {
+    registrar(const char* name, case_function fn);
+};
+
+#define BENCH_CASE(name) \
+    static void name(); \
+    static bench::registrar name##_registrar(#name, name); \
+    static void name()
+
+/// number of timed samples per single-threaded measurement
+const int samples = 100;
+/// number of timed repetitions per multi-threaded measurement
+const int repetitions = 5;
+
+///
+/// summary of one measurement
+///
+struct result {
+    std::string name;
+    std::size_t threads;
+    std::size_t ops;
+    double median_ns;
+    double p99_ns;
+};
+
+void report(const result& r);
+
+/// keep value alive so the optimizer cannot drop the work that produced it
+void escape(const void* value);
+
+///
+/// summarize samples in ns/op and report them
+///
+inline void report(const std::string& name, std::size_t threads, std::size_t ops, std::vector<double>& ns_per_op) {
+    std::sort(ns_per_op.begin(), ns_per_op.end());
+    result r;
+    r.name = name;
+    r.threads = threads;
+    r.ops = ops;
+    r.median_ns = ns_per_op[ns_per_op.size() / 2];
+    r.p99_ns = ns_per_op[(ns_per_op.size() * 99 - 1) / 100];
+    report(r);
+}
+
+///
+/// time fn(ops) after one warm-up run and report the median and p99 ns/op
+///
+/// The ops are split into equal batches and each batch is one sample, so p99
+/// shows the slowest batches rather than the slowest single operation.
+///
+template <typename F>
+void run(const std::string& name, std::size_t ops, F fn) {
+    const std::size_t batch = ops < std::size_t(samples) ? 1 : ops / samples;
+    fn(batch);
+    std::vector<double> ns_per_op;
+    for (int i = 0; i < samples; ++i) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        fn(batch);
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        ns_per_op.push_back(elapsed.count() / batch);
+    }
+    report(name, 1, batch * samples, ns_per_op);
+}
+
+///
+/// time fn(thread, ops) running on threads threads at once and report the median and p99 ns/op
+///
+/// ns/op is wall time divided by the total number of operations, so it drops as
+/// throughput scales with the thread count.
+///
+template <typename F>
+void run_threads(const std::string& name, std::size_t threads, std::size_t ops, F fn) {
+    std::vector<double> ns_per_op;
+    for (int i = 0; i <= repetitions; ++i) {
+        std::vector<std::thread> workers;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (std::size_t t = 0; t < threads; ++t)
+            workers.push_back(std::thread(fn, t, ops));
+        for (std::size_t t = 0; t < threads; ++t)
+            workers[t].join();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        if (i > 0) ns_per_op.push_back(elapsed.count() / (ops * threads)); // first run is warm-up
+    }
+    report(name, threads, ops * threads, ns_per_op);
+}
+
+}
+
+#endif // DYNAMIC_BENCH_HPP
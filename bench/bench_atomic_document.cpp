@@ -0,0 +1,76 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <dynamic/dynamic.hpp>
+
+#include "bench.hpp"
+
+using namespace dynamic;
+
+static var make_config(int n) {
+    var routes = make_map();
+    for (int i = 0; i < 1000; ++i)
+        routes(i, make_map("backend", "host")("weight", i)("version", n));
+    return make_map("routes", routes)("version", n);
+}
+
+///
+/// time snapshot reads, optionally with a writer replacing the whole tree every millisecond
+///
+static void read_during_reloads(const std::string& name, bool reload) {
+    atomic_document doc(make_config(0));
+    std::atomic<bool> done(false);
+    std::thread writer;
+    if (reload)
+        writer = std::thread([&] {
+            for (int n = 1; !done.load(); ++n) {
+                doc.publish(make_config(n));
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    for (std::size_t threads = 1; threads <= 8; threads *= 2)
+        bench::run_threads(name, threads, 100000, [&doc](std::size_t, std::size_t ops) {
+            int sum = 0;
+            for (std::size_t i = 0; i < ops; ++i) {
+                atomic_document::snapshot s = doc.read();
+                sum += int(s.root()["routes"][int(i % 1000)]["weight"]);
+            }
+            if (sum < 0) std::abort();
+        });
+    done = true;
+    if (writer.joinable()) writer.join();
+}
+
+BENCH_CASE(atomic_document_read) {
+    read_during_reloads("atomic_document read", false);
+}
+
+BENCH_CASE(atomic_document_read_during_reloads) {
+    read_during_reloads("atomic_document read during reloads", true);
+}
@@ -0,0 +1,95 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <memory>
+#include <mutex>
+
+#include <dynamic/dynamic.hpp>
+
+#include "bench.hpp"
+
+using namespace dynamic;
+
+static const int key_space = 10000;
+
+/// cheap per-thread key sequence
+struct lcg {
+    explicit lcg(unsigned seed) : state(seed * 2654435761u + 1) {}
+    int next() { state = state * 1664525u + 1013904223u; return int((state >> 8) % key_space); }
+    unsigned state;
+};
+
+/// the baseline: one map behind one mutex
+struct locked_map {
+    std::mutex lock;
+    var::map_type map;
+};
+
+template <typename Workload>
+static void scale(const std::string& name, Workload workload) {
+    for (std::size_t threads = 1; threads <= 8; threads *= 2)
+        bench::run_threads(name, threads, 50000, workload);
+}
+
+BENCH_CASE(concurrent_map_read_90_write_10) {
+    concurrent_map_ptr map = make_concurrent_map(64);
+    for (int k = 0; k < key_space; ++k) map->insert_or_assign(k, k);
+    scale("concurrent_map read 90% write 10%", [map](std::size_t thread, std::size_t ops) {
+        lcg keys(static_cast<unsigned>(thread));
+        var value;
+        for (std::size_t i = 0; i < ops; ++i) {
+            int k = keys.next();
+            if (i % 10 == 0) map->insert_or_assign(k, int(i));
+            else map->find(k, value);
+        }
+    });
+}
+
+BENCH_CASE(locked_map_read_90_write_10) {
+    std::shared_ptr<locked_map> map = std::make_shared<locked_map>();
+    for (int k = 0; k < key_space; ++k) map->map[k] = k;
+    scale("single mutex map read 90% write 10%", [map](std::size_t thread, std::size_t ops) {
+        lcg keys(static_cast<unsigned>(thread));
+        var value;
+        for (std::size_t i = 0; i < ops; ++i) {
+            var k = keys.next();
+            std::lock_guard<std::mutex> guard(map->lock);
+            if (i % 10 == 0) map->map[k] = int(i);
+            else {
+                var::map_type::const_iterator it = map->map.find(k);
+                if (it != map->map.end()) value = it->second;
+            }
+        }
+    });
+}
+
+BENCH_CASE(concurrent_map_compute_if_absent) {
+    concurrent_map_ptr map = make_concurrent_map(64);
+    scale("concurrent_map compute_if_absent", [map](std::size_t thread, std::size_t ops) {
+        lcg keys(static_cast<unsigned>(thread));
+        for (std::size_t i = 0; i < ops; ++i)
+            map->compute_if_absent(keys.next(), [](const var& k) { return var(int(k) * 2); });
+    });
+}
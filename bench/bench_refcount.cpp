@@ -0,0 +1,71 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <dynamic/dynamic.hpp>
+
+#include "bench.hpp"
+
+using namespace dynamic;
+
+#ifdef DYNAMIC_NON_ATOMIC_REFCOUNT
+static const std::string policy = " (non-atomic refcount)";
+#else
+static const std::string policy = " (atomic refcount)";
+#endif
+
+BENCH_CASE(refcount_copy_assign) {
+    const var values[] = { var("a string payload"), make_vector(1)(2)(3), make_map("key", "value") };
+    const char* names[] = { "string", "vector", "map" };
+    for (int n = 0; n < 3; ++n) {
+        const var& source = values[n];
+        bench::run(std::string("refcount operator=(const var&) ") + names[n] + policy, 1000000, [&source](std::size_t ops) {
+            var target;
+            for (std::size_t i = 0; i < ops; ++i)
+                target = source;
+            if (target.count() == 0) std::abort();
+        });
+    }
+}
+
+BENCH_CASE(refcount_vector_growth) {
+    const var item("a string payload");
+    bench::run("refcount vector growth" + policy, 1000000, [&item](std::size_t ops) {
+        // every reallocation copies the vars already appended
+        std::vector<var> items;
+        for (std::size_t i = 0; i < ops; ++i)
+            items.push_back(item);
+        if (items.size() != ops) std::abort();
+    });
+    bench::run("refcount var vector growth" + policy, 1000000, [&item](std::size_t ops) {
+        var items = make_vector();
+        for (std::size_t i = 0; i < ops; ++i)
+            items(item);
+        if (items.count() != ops) std::abort();
+    });
+}
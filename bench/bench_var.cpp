@@ -0,0 +1,704 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dynamic/dynamic.hpp>
+
+#include "bench.hpp"
+
+using namespace dynamic;
+
+///
+/// document shapes every case runs against
+///
+struct shape {
+    const char* name;
+    int size;
+};
+
+static const shape shapes[] = { { "small", 10 }, { "large", 10000 } };
+
+/// @return key of record i
+static std::string key(int i) {
+    std::ostringstream os;
+    os << "item" << i;
+    return os.str();
+}
+
+/// @return vector of n ints
+static var make_list(int n) {
+    var list = make_vector();
+    for (int i = 0; i < n; ++i)
+        list(i);
+    return list;
+}
+
+/// @return map of n records keyed by key(i)
+static var make_doc(int n) {
+    var doc = make_map();
+    for (int i = 0; i < n; ++i)
+        doc(key(i), make_map("id", i)("name", "record")("score", i * 0.5)("tags", make_vector("a")("b")));
+    return doc;
+}
+
+/// time constructing and destroying one var per op
+template <typename T>
+static void construct(const std::string& name, const T& value) {
+    bench::run("var ctor " + name, 1000000, [&value](std::size_t ops) {
+        for (std::size_t i = 0; i < ops; ++i) {
+            var v(value);
+            bench::escape(&v);
+        }
+    });
+}
+
+BENCH_CASE(var_ctor) {
+    bench::run("var ctor ()", 1000000, [](std::size_t ops) {
+        for (std::size_t i = 0; i < ops; ++i) {
+            var v;
+            bench::escape(&v);
+        }
+    });
+    construct("(bool)", true);
+    construct("(int)", 42);
+    construct("(double)", 3.14);
+    construct("(const std::string&)", std::string("hello, world"));
+    construct("(const char*)", "hello, world");
+    construct("(const std::wstring&)", std::wstring(L"hello, world"));
+    construct("(const wchar_t*)", L"hello, world");
+    construct("(const var&) string", var("hello, world"));
+    construct("(const var&) map", make_doc(10));
+    bench::run("var ctor make_vector()", 1000000, [](std::size_t ops) {
+        for (std::size_t i = 0; i < ops; ++i) {
+            var v = make_vector();
+            bench::escape(&v);
+        }
+    });
+    bench::run("var ctor make_map()", 1000000, [](std::size_t ops) {
+        for (std::size_t i = 0; i < ops; ++i) {
+            var v = make_map();
+            bench::escape(&v);
+        }
+    });
+}
+
+/// time assigning value to a var holding an int
+template <typename T>
+static void assign(const std::string& name, const T& value) {
+    bench::run("var operator=" + name, 1000000, [&value](std::size_t ops) {
+        var v(0);
+        for (std::size_t i = 0; i < ops; ++i) {
+            v = value;
+            bench::escape(&v);
+            v = 0;
+        }
+    });
+}
+
+BENCH_CASE(var_assign) {
+    assign("(bool)", true);
+    assign("(int)", 42);
+    assign("(double)", 3.14);
+    assign("(const std::string&)", std::string("hello, world"));
+    assign("(const char*)", "hello, world");
+    assign("(const std::wstring&)", std::wstring(L"hello, world"));
+    assign("(const wchar_t*)", L"hello, world");
+    assign("(const var&) string", var("hello, world"));
+    assign("(const var&) map", make_doc(10));
+}
+
+BENCH_CASE(var_index) {
+    for (std::size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s) {
+        const int n = shapes[s].size;
+        var list = make_list(n);
+        var doc = make_doc(n);
+        std::vector<std::string> keys;
+        for (int i = 0; i < n; ++i)
+            keys.push_back(key(i));
+
+        const var& clist = list;
+        bench::run(std::string("var operator[](int) const ") + shapes[s].name, 1000000, [&clist, n](std::size_t ops) {
+            int sum = 0;
+            for (std::size_t i = 0; i < ops; ++i)
+                sum += int(clist[int(i % n)]);
+            if (sum < 0) std::abort();
+        });
+        bench::run(std::string("var operator[](int) ") + shapes[s].name, 1000000, [&list, n](std::size_t ops) {
+            for (std::size_t i = 0; i < ops; ++i)
+                list[int(i % n)] = int(i);
+        });
+        const var& cdoc = doc;
+        bench::run(std::string("var operator[](string) const ") + shapes[s].name, 1000000, [&cdoc, &keys, n](std::size_t ops) {
+            for (std::size_t i = 0; i < ops; ++i)
+                bench::escape(&cdoc[keys[i % n]]);
+        });
+        bench::run(std::string("var operator[](string) ") + shapes[s].name, 1000000, [&doc, &keys, n](std::size_t ops) {
+            for (std::size_t i = 0; i < ops; ++i)
+                bench::escape(&doc[keys[i % n]]);
+        });
+    }
+}
+
+BENCH_CASE(var_path) {
+    const var doc = make_map("a", make_map("b", make_vector(0)(1)(2)(make_map("c", 42))));
+    bench::run("var operator[] chain /a/b/3/c", 1000000, [&doc](std::size_t ops) {
+        int sum = 0;
+        for (std::size_t i = 0; i < ops; ++i)
+            sum += int(doc["a"]["b"][3]["c"]);
+        if (sum == 0) std::abort();
+    });
+    const path p("/a/b/3/c");
+    bench::run("var path::find /a/b/3/c", 1000000, [&doc, &p](std::size_t ops) {
+        int sum = 0;
+        for (std::size_t i = 0; i < ops; ++i)
+            sum += int(*p.find(doc));
+        if (sum == 0) std::abort();
+    });
+    const path miss("/a/x/3/c");
+    bench::run("var path::find miss", 1000000, [&doc, &miss](std::size_t ops) {
+        std::size_t found = 0;
+        for (std::size_t i = 0; i < ops; ++i)
+            found += miss.find(doc) != 0;
+        if (found != 0) std::abort();
+    });
+}
+
+BENCH_CASE(var_query) {
+    // one batch of ops runs the query once over every item
+    const int n = 1000000 / bench::samples;
+    var items = make_vector();
+    for (int i = 0; i < n; ++i)
+        items(make_map("id", i)("price", i % 100 * 0.25)("name", "record")("tags", make_vector("a")("b")));
+    const var doc = make_map("items", items);
+    // ops are counted per input element
+    bench::run("var query hand-written loop", 1000000, [&doc, n](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; done += n) {
+            var result = make_vector();
+            const var& items = doc["items"];
+            for (var::const_iterator it = items.begin(); it != items.end(); ++it)
+                if (double((*it)["price"]) > 20)
+                    result(make_map("id", (*it)["id"])("price", (*it)["price"]));
+            bench::escape(&result);
+        }
+    });
+    const query q(".items[] | {id, price} | select(.price > 20)");
+    bench::run("var query 1 thread", 1000000, [&doc, &q, n](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; done += n) {
+            var result = q.run(doc, 1);
+            bench::escape(&result);
+        }
+    });
+    bench::run("var query all threads", 1000000, [&doc, &q, n](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; done += n) {
+            var result = q.run(doc);
+            bench::escape(&result);
+        }
+    });
+}
+
+BENCH_CASE(var_columnar) {
+    // one batch of ops converts or scans every record once
+    const int n = 1000000 / bench::samples;
+    var records = make_vector();
+    for (int i = 0; i < n; ++i)
+        records(make_map("id", i)("price", i % 100 * 0.25)("name", "record"));
+    // ops are counted per record
+    bench::run("var columnar to_columnar", 1000000, [&records, n](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; done += n) {
+            column_table table = to_columnar(records);
+            bench::escape(&table);
+        }
+    });
+    bench::run("var columnar filter+sum over var maps", 1000000, [&records, n](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; done += n) {
+            double total = 0;
+            for (var::const_iterator it = records.begin(); it != records.end(); ++it)
+                if (int((*it)["id"]) >= n / 2) total += double((*it)["price"]);
+            bench::escape(&total);
+        }
+    });
+    const column_table table = to_columnar(records);
+    const column& id = *table.find("id");
+    const column& price = *table.find("price");
+    bench::run("var columnar filter+sum kernels", 1000000, [&id, &price, n](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; done += n) {
+            const column::bitmap upper = id.filter(column::greater_equal, n / 2);
+            double total = price.sum(&upper);
+            bench::escape(&total);
+        }
+    });
+}
+
+BENCH_CASE(var_record_index) {
+    const int n = 10000;
+    var records = make_vector();
+    for (int i = 0; i < n; ++i)
+        records(make_map("id", i)("price", i % 100 * 0.25)("name", "record"));
+    bench::run("var record_index linear scan", 1000, [&records, n](std::size_t ops) {
+        std::size_t found = 0;
+        for (std::size_t i = 0; i < ops; ++i) {
+            const int id = int(i * 7919 % n);
+            for (var::const_iterator it = records.begin(); it != records.end(); ++it)
+                if ((*it)["id"] == id) {
+                    ++found;
+                    break;
+                }
+        }
+        if (found != ops) std::abort();
+    });
+    // ops are counted per record indexed
+    bench::run("var record_index build hash", 1000000, [&records, n](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; done += n) {
+            record_index index(records, "/id");
+            bench::escape(&index);
+        }
+    });
+    bench::run("var record_index build sorted", 1000000, [&records, n](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; done += n) {
+            record_index index(records, "/id", record_index::sorted);
+            bench::escape(&index);
+        }
+    });
+    const record_index by_id(records, "/id");
+    bench::run("var record_index hash first", 1000000, [&by_id, n](std::size_t ops) {
+        std::size_t found = 0;
+        for (std::size_t i = 0; i < ops; ++i)
+            found += by_id.first(int(i * 7919 % n)) != 0;
+        if (found != ops) std::abort();
+    });
+    const record_index sorted(records, "/id", record_index::sorted);
+    bench::run("var record_index sorted first", 1000000, [&sorted, n](std::size_t ops) {
+        std::size_t found = 0;
+        for (std::size_t i = 0; i < ops; ++i)
+            found += sorted.first(int(i * 7919 % n)) != 0;
+        if (found != ops) std::abort();
+    });
+}
+
+/// time passes runs of group over rows records, and report the time per record
+template <typename F>
+static void group(const std::string& name, const var& records, int passes, F group) {
+    std::vector<double> ns_per_op;
+    for (int i = 0; i <= passes; ++i) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        var result = group(records);
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        bench::escape(&result);
+        if (i > 0) ns_per_op.push_back(elapsed.count() / records.count()); // first run is warm-up
+    }
+    bench::report(name, 1, passes * records.count(), ns_per_op);
+}
+
+BENCH_CASE(var_group_by) {
+    static const char* regions[] = { "north", "south", "east", "west" };
+    const int rows = 1000000;
+    var sales = make_vector();
+    for (int i = 0; i < rows; ++i)
+        sales(make_map("region", regions[i % 4])("year", 2000 + i % 25)("price", i % 100 * 0.25));
+    // the stringified composite key approach group_by replaces
+    group("var group_by 1M rows string keys in make_map()", sales, 5, [](const var& records) {
+        var groups = make_map();
+        for (var::const_iterator it = records.begin(); it != records.end(); ++it) {
+            std::ostringstream key;
+            key << std::string((*it)["region"]) << '|' << int((*it)["year"]);
+            var& g = groups[key.str()];
+            if (g.is_null()) g = make_map("n", 0)("revenue", 0.0);
+            g["n"] = int(g["n"]) + 1;
+            g["revenue"] = double(g["revenue"]) + double((*it)["price"]);
+        }
+        return groups;
+    });
+    const group_by spec = group_by().key("region", "/region").key("year", "/year").count("n").sum("revenue", "/price");
+    group("var group_by 1M rows 1 thread", sales, 5, [&spec](const var& records) {
+        return spec.run(records, 1);
+    });
+    group("var group_by 1M rows all threads", sales, 5, [&spec](const var& records) {
+        return spec.run(records);
+    });
+}
+
+BENCH_CASE(var_view) {
+    // one batch of ops runs the pipeline once over every element
+    const int n = 1000000 / bench::samples;
+    const var list = make_list(n);
+    bench::run("var view materialized filter+transform", 1000000, [&list, n](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; done += n) {
+            var odd = make_vector();
+            for (var::const_iterator it = list.begin(); it != list.end(); ++it)
+                if (int(*it) % 2) odd(*it);
+            var squares = make_vector();
+            for (var::const_iterator it = odd.begin(); it != odd.end(); ++it)
+                squares(int(*it) * int(*it));
+            bench::escape(&squares);
+        }
+    });
+    bench::run("var view lazy filter+transform to_var()", 1000000, [&list, n](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; done += n) {
+            var squares = view(list).filter([](const var& v) { return int(v) % 2 != 0; })
+                                    .transform([](const var& v) { return int(v) * int(v); }).to_var();
+            bench::escape(&squares);
+        }
+    });
+    bench::run("var view lazy filter+transform sum", 1000000, [&list, n](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; done += n) {
+            long long sum = 0;
+            for (const var& v : view(list).filter([](const var& v) { return int(v) % 2 != 0; })
+                                          .transform([](const var& v) { return int(v) * int(v); }))
+                sum += int(v);
+            bench::escape(&sum);
+        }
+    });
+}
+
+BENCH_CASE(var_slice) {
+    // one op takes a 100-element page of a 10000-element vector and reads its last element
+    const int n = 10000, page = 100;
+    const var list = make_list(n);
+    bench::run("var page copied into make_vector()", 1000000, [&list](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; ++done) {
+            const int offset = int(done % (n / page)) * page;
+            var copy = make_vector();
+            for (int i = offset; i < offset + page; ++i)
+                copy(list[i]);
+            bench::escape(&copy[page - 1]);
+        }
+    });
+    bench::run("var page as slice()", 1000000, [&list](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; ++done) {
+            const var window = list.slice(var::size_type(done % (n / page)) * page, page);
+            bench::escape(&window[page - 1]);
+        }
+    });
+}
+
+BENCH_CASE(var_erase) {
+    // one op removes the middle item of a 1000-item vector and puts it back at the end
+    const int n = 1000;
+    var list = make_list(n);
+    bench::run("var erase by rebuilding the vector", 100000, [&list, n](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; ++done) {
+            const var item = list[n / 2];
+            var rebuilt = make_vector();
+            for (int i = 0; i < n; ++i)
+                if (i != n / 2) rebuilt(list[i]);
+            rebuilt(item);
+            list = rebuilt;
+        }
+    });
+    bench::run("var erase() and operator ()", 100000, [&list, n](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; ++done) {
+            const var item = list[n / 2];
+            list.erase(n / 2)(item);
+        }
+    });
+}
+
+BENCH_CASE(var_literal) {
+    // one op builds a small record literal
+    bench::run("var literal by chained make_map()", 1000000, [](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; ++done) {
+            var record = make_map("id", 1)("name", "record")("score", 0.5)("tags", make_vector("a")("b")("c"));
+            bench::escape(&record);
+        }
+    });
+    bench::run("var literal by initializer list", 1000000, [](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; ++done) {
+            var record = { { "id", 1 }, { "name", "record" }, { "score", 0.5 }, { "tags", { "a", "b", "c" } } };
+            bench::escape(&record);
+        }
+    });
+
+    // one op copies one item of a sorted std::map into a var map
+    const int n = 10000;
+    std::map<std::string, int> source;
+    for (int i = 0; i < n; ++i)
+        source[key(i)] = i;
+    bench::run("var map by operator () per entry", 1000000, [&source, n](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; done += n) {
+            var map = make_map();
+            for (std::map<std::string, int>::const_iterator it = source.begin(); it != source.end(); ++it)
+                map(it->first, it->second);
+            bench::escape(&map);
+        }
+    });
+    bench::run("var map by make_map(first, last)", 1000000, [&source, n](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; done += n) {
+            var map = make_map(source.begin(), source.end());
+            bench::escape(&map);
+        }
+    });
+}
+
+/// record converted by var_convert
+struct bench_record {
+    int id;
+    std::string name;
+    std::vector<double> scores;
+};
+
+DYNAMIC_CONVERT_STRUCT(bench_record, (id)(name)(scores))
+
+BENCH_CASE(var_convert) {
+    // one op converts one record of a 1000-record std::vector
+    const int n = 1000;
+    std::vector<bench_record> records(n);
+    for (int i = 0; i < n; ++i) {
+        records[i].id = i;
+        records[i].name = key(i);
+        records[i].scores.assign(8, i * 0.5);
+    }
+    bench::run("var convert by hand", 1000000, [&records, n](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; done += n) {
+            var list = make_vector();
+            for (std::vector<bench_record>::const_iterator r = records.begin(); r != records.end(); ++r) {
+                var scores = make_vector();
+                for (std::vector<double>::const_iterator s = r->scores.begin(); s != r->scores.end(); ++s)
+                    scores(*s);
+                list(make_map("id", r->id)("name", r->name)("scores", scores));
+            }
+            bench::escape(&list);
+        }
+    });
+    bench::run("var convert by to_var()", 1000000, [&records, n](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; done += n) {
+            var list = to_var(records);
+            bench::escape(&list);
+        }
+    });
+    const var list = to_var(records);
+    bench::run("var convert by from_var()", 1000000, [&list, n](std::size_t ops) {
+        for (std::size_t done = 0; done < ops; done += n) {
+            std::vector<bench_record> back = from_var<std::vector<bench_record> >(list);
+            bench::escape(&back);
+        }
+    });
+}
+
+BENCH_CASE(var_append) {
+    for (std::size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s) {
+        const int n = shapes[s].size;
+        // ops are counted per append, including building and destroying each collection
+        bench::run(std::string("var operator() vector ") + shapes[s].name, 1000000, [n](std::size_t ops) {
+            for (std::size_t done = 0; done < ops; done += n) {
+                var list = make_vector();
+                for (int i = 0; i < n; ++i)
+                    list(i);
+                bench::escape(&list);
+            }
+        });
+        bench::run(std::string("var operator(,) map ") + shapes[s].name, 1000000, [n](std::size_t ops) {
+            for (std::size_t done = 0; done < ops; done += n) {
+                var map = make_map();
+                for (int i = 0; i < n; ++i)
+                    map(i, i);
+                bench::escape(&map);
+            }
+        });
+    }
+}
+
+BENCH_CASE(var_iterate) {
+    for (std::size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s) {
+        const var list = make_list(shapes[s].size);
+        const var doc = make_doc(shapes[s].size);
+        // ops are counted per element visited
+        bench::run(std::string("var const_iterator vector ") + shapes[s].name, 1000000, [&list](std::size_t ops) {
+            std::size_t done = 0;
+            while (done < ops)
+                for (var::const_iterator it = list.begin(); it != list.end(); ++it, ++done)
+                    bench::escape(&*it);
+        });
+        bench::run(std::string("var const_iterator map ") + shapes[s].name, 1000000, [&doc](std::size_t ops) {
+            std::size_t done = 0;
+            while (done < ops)
+                for (var::const_iterator it = doc.begin(); it != doc.end(); ++it, ++done)
+                    bench::escape(&it.pair().second);
+        });
+    }
+}
+
+BENCH_CASE(var_compare) {
+    const var::less_var less;
+    const var ints[] = { var(1), var(2) };
+    const var strings[] = { var("hello, world 1"), var("hello, world 2") };
+    const var mixed[] = { var(1), var("hello, world") };
+    bench::run("var less_var int", 1000000, [&less, &ints](std::size_t ops) {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < ops; ++i)
+            n += less(ints[i & 1], ints[~i & 1]);
+        if (n == 0) std::abort();
+    });
+    bench::run("var less_var string", 1000000, [&less, &strings](std::size_t ops) {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < ops; ++i)
+            n += less(strings[i & 1], strings[~i & 1]);
+        if (n == 0) std::abort();
+    });
+    bench::run("var less_var mixed types", 1000000, [&less, &mixed](std::size_t ops) {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < ops; ++i)
+            n += less(mixed[i & 1], mixed[~i & 1]);
+        if (n == 0) std::abort();
+    });
+    bench::run("var operator== string", 1000000, [&strings](std::size_t ops) {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < ops; ++i)
+            n += strings[i & 1] == strings[0];
+        if (n == 0) std::abort();
+    });
+    for (std::size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s) {
+        // separate trees, so equality has to compare every element
+        const var lhs = make_doc(shapes[s].size);
+        const var rhs = make_doc(shapes[s].size);
+        bench::run(std::string("var operator== document ") + shapes[s].name, shapes[s].size < 100 ? 100000 : 1000, [&lhs, &rhs](std::size_t ops) {
+            std::size_t n = 0;
+            for (std::size_t i = 0; i < ops; ++i)
+                n += lhs == rhs;
+            if (n != ops) std::abort();
+        });
+        bench::run(std::string("var less_var document ") + shapes[s].name, shapes[s].size < 100 ? 100000 : 1000, [&less, &lhs, &rhs](std::size_t ops) {
+            std::size_t n = 0;
+            for (std::size_t i = 0; i < ops; ++i)
+                n += less(lhs, rhs);
+            if (n != 0) std::abort();
+        });
+        const var copy = lhs;
+        bench::run(std::string("var operator== shared copy ") + shapes[s].name, 1000000, [&lhs, &copy](std::size_t ops) {
+            std::size_t n = 0;
+            for (std::size_t i = 0; i < ops; ++i)
+                n += lhs == copy;
+            if (n != ops) std::abort();
+        });
+        // the last record differs, so every other element is compared first
+        var last = make_doc(shapes[s].size);
+        last[key(shapes[s].size - 1)]["score"] = -1.0;
+        bench::run(std::string("var operator== unequal last ") + shapes[s].name, shapes[s].size < 100 ? 100000 : 1000, [&lhs, &last](std::size_t ops) {
+            std::size_t n = 0;
+            for (std::size_t i = 0; i < ops; ++i)
+                n += lhs == last;
+            if (n != 0) std::abort();
+        });
+        var smaller = make_doc(shapes[s].size - 1);
+        bench::run(std::string("var operator== unequal size ") + shapes[s].name, 1000000, [&lhs, &smaller](std::size_t ops) {
+            std::size_t n = 0;
+            for (std::size_t i = 0; i < ops; ++i)
+                n += lhs == smaller;
+            if (n != 0) std::abort();
+        });
+        // frozen trees that have been fingerprinted are told apart by their memos
+        const var frozen_lhs = make_doc(shapes[s].size).freeze();
+        const var frozen_last = last.deep_clone().freeze();
+        fingerprint_of(frozen_lhs);
+        fingerprint_of(frozen_last);
+        bench::run(std::string("var operator== unequal fingerprinted ") + shapes[s].name, 1000000, [&frozen_lhs, &frozen_last](std::size_t ops) {
+            std::size_t n = 0;
+            for (std::size_t i = 0; i < ops; ++i)
+                n += frozen_lhs == frozen_last;
+            if (n != 0) std::abort();
+        });
+    }
+}
+
+BENCH_CASE(var_hash) {
+    const var string("hello, world");
+    bench::run("var hash string", 1000000, [&string](std::size_t ops) {
+        std::size_t h = 0;
+        for (std::size_t i = 0; i < ops; ++i)
+            h += hash(string);
+        bench::escape(&h);
+    });
+    for (std::size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s) {
+        const var doc = make_doc(shapes[s].size);
+        const var frozen = make_doc(shapes[s].size).freeze();
+        const std::size_t ops = shapes[s].size < 100 ? 100000 : 1000;
+        bench::run(std::string("var hash document ") + shapes[s].name, ops, [&doc](std::size_t ops) {
+            std::size_t h = 0;
+            for (std::size_t i = 0; i < ops; ++i)
+                h += hash(doc);
+            bench::escape(&h);
+        });
+        // every call after the first is answered by the memo in the root node
+        bench::run(std::string("var hash frozen document ") + shapes[s].name, ops, [&frozen](std::size_t ops) {
+            std::size_t h = 0;
+            for (std::size_t i = 0; i < ops; ++i)
+                h += hash(frozen);
+            bench::escape(&h);
+        });
+    }
+}
+
+BENCH_CASE(var_write) {
+    for (std::size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s) {
+        const var doc = make_doc(shapes[s].size);
+        const std::size_t ops = shapes[s].size < 100 ? 100000 : 1000;
+        bench::run(std::string("var _write_var ostream ") + shapes[s].name, ops, [&doc](std::size_t ops) {
+            for (std::size_t i = 0; i < ops; ++i) {
+                std::ostringstream os;
+                os << doc;
+                bench::escape(&os);
+            }
+        });
+        bench::run(std::string("var _write_var wostream ") + shapes[s].name, ops, [&doc](std::size_t ops) {
+            for (std::size_t i = 0; i < ops; ++i) {
+                std::wostringstream os;
+                os << doc;
+                bench::escape(&os);
+            }
+        });
+    }
+}
+
+/// time dropping the last reference to each of ops documents with release, and report the latency per drop
+template <typename F>
+static void dispose(const std::string& name, int size, std::size_t ops, F release) {
+    std::vector<double> ns_per_op;
+    for (std::size_t i = 0; i < ops; ++i) {
+        var doc = make_doc(size);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        release(doc);
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        ns_per_op.push_back(elapsed.count());
+    }
+    bench::report(name, 1, ops, ns_per_op);
+}
+
+BENCH_CASE(var_dispose) {
+    for (std::size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s) {
+        const std::size_t ops = shapes[s].size < 100 ? 10000 : 100;
+        dispose(std::string("var release inline ") + shapes[s].name, shapes[s].size, ops, [](var& doc) {
+            doc = none;
+        });
+        dispose(std::string("var release dispose_async ") + shapes[s].name, shapes[s].size, ops, [](var& doc) {
+            dispose_async(std::move(doc));
+        });
+        default_reclaimer().drain();
+    }
+}
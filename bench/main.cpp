@@ -0,0 +1,135 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace bench {
+
+typedef std::vector<std::pair<const char*, case_function> > case_list;
+
+static case_list& cases() {
+    static case_list list;
+    return list;
+}
+
+registrar::registrar(const char* name, case_function fn) {
+    cases().push_back(std::make_pair(name, fn));
+}
+
+/// output format selected by --format
+enum format_t { text, csv, json };
+static format_t format = text;
+static std::vector<result> results;
+
+/// @return s quoted for csv or json
+static std::string quote(const std::string& s) {
+    std::string quoted("\"");
+    for (std::string::const_iterator it = s.begin(); it != s.end(); ++it) {
+        if (*it == '"') quoted += format == csv ? "\"" : "\\";
+        else if (*it == '\\' && format == json) quoted += '\\';
+        quoted += *it;
+    }
+    return quoted + '"';
+}
+
+void report(const result& r) {
+    switch (format) {
+    case text :
+        std::cout << std::left << std::setw(56) << r.name
+                  << std::right << std::setw(4) << r.threads << " threads"
+                  << std::setw(12) << r.ops << " ops"
+                  << std::setw(12) << std::fixed << std::setprecision(1) << r.median_ns << " ns/op"
+                  << std::setw(12) << r.p99_ns << " p99"
+                  << std::endl;
+        break;
+    case csv :
+        std::cout << quote(r.name) << ',' << r.threads << ',' << r.ops << ','
+                  << std::fixed << std::setprecision(1) << r.median_ns << ',' << r.p99_ns << std::endl;
+        break;
+    case json :
+        // printed as one array once every case has run
+        results.push_back(r);
+        break;
+    }
+}
+
+static volatile const void* sink;
+
+void escape(const void* value) { sink = value; }
+
+}
+
+///
+/// run every registered case, or only those whose name contains one of the arguments
+///
+/// --format=text (default), --format=csv or --format=json selects the output.
+///
+int main(int argc, char* argv[]) {
+    std::vector<const char*> filters;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--format=text") == 0) bench::format = bench::text;
+        else if (std::strcmp(argv[i], "--format=csv") == 0) bench::format = bench::csv;
+        else if (std::strcmp(argv[i], "--format=json") == 0) bench::format = bench::json;
+        else if (std::strncmp(argv[i], "--", 2) == 0) {
+            std::cerr << "usage: bench [--format=text|csv|json] [case ...]" << std::endl;
+            return 1;
+        }
+        else filters.push_back(argv[i]);
+    }
+
+    if (bench::format == bench::csv)
+        std::cout << "name,threads,ops,median_ns,p99_ns" << std::endl;
+
+    const bench::case_list& cases = bench::cases();
+    for (bench::case_list::const_iterator it = cases.begin(); it != cases.end(); ++it) {
+        bool selected = filters.empty();
+        for (std::size_t i = 0; i < filters.size(); ++i)
+            if (std::strstr(it->first, filters[i])) selected = true;
+        if (selected) it->second();
+    }
+
+    if (bench::format == bench::json) {
+        std::cout << "[" << std::endl;
+        for (std::size_t i = 0; i < bench::results.size(); ++i) {
+            const bench::result& r = bench::results[i];
+            std::cout << "  { \"name\": " << bench::quote(r.name)
+                      << ", \"threads\": " << r.threads
+                      << ", \"ops\": " << r.ops
+                      << std::fixed << std::setprecision(1)
+                      << ", \"median_ns\": " << r.median_ns
+                      << ", \"p99_ns\": " << r.p99_ns << " }"
+                      << (i + 1 < bench::results.size() ? "," : "") << std::endl;
+        }
+        std::cout << "]" << std::endl;
+    }
+    return 0;
+}
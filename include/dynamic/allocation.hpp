@@ -0,0 +1,253 @@
+#ifndef DYNAMIC_ALLOCATION_HPP
+#define DYNAMIC_ALLOCATION_HPP
+
+/*
+    Copyright (C) 2009, Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+
+#include <boost/noncopyable.hpp>
+
+namespace dynamic {
+
+///
+/// kinds of storage allocated for var payloads
+///
+enum payload_kind {
+    payload_string = 0,     ///< string nodes
+    payload_wstring,        ///< wide string nodes
+    payload_vector,         ///< vector nodes and their item buffers
+    payload_map,            ///< map nodes and their tree nodes
+    payload_persistent,     ///< persistent vector and map nodes
+    payload_kind_count
+};
+
+///
+/// replaceable allocation functions for var payloads
+///
+/// Install a hook before creating the vars it should see and remove it after they are
+/// destroyed. Memory is always freed through the hook installed at that time, so a hook
+/// that does not forward to the global heap must not be swapped while its vars are alive.
+///
+class allocation_hook {
+public :
+    virtual ~allocation_hook() {}
+    virtual void* allocate(std::size_t bytes, payload_kind kind) = 0;
+    virtual void deallocate(void* p, std::size_t bytes, payload_kind kind) = 0;
+};
+
+///
+/// install hook for every later payload allocation, 0 restores the global heap
+///
+/// @return the previously installed hook
+///
+allocation_hook* set_allocation_hook(allocation_hook* hook);
+
+///
+/// allocation_hook that counts allocations, frees and live bytes per payload kind
+///
+/// Memory is passed on to next, or to the global heap if next is 0.
+///
+class allocation_counter : public allocation_hook {
+public :
+    explicit allocation_counter(allocation_hook* next = 0);
+
+    void* allocate(std::size_t bytes, payload_kind kind);
+    void deallocate(void* p, std::size_t bytes, payload_kind kind);
+
+    /// @return number of allocations of kind
+    std::size_t allocations(payload_kind kind) const { return _counters[kind].allocations.load(std::memory_order_relaxed); }
+    /// @return number of frees of kind
+    std::size_t frees(payload_kind kind) const { return _counters[kind].frees.load(std::memory_order_relaxed); }
+    /// @return bytes of kind allocated and not yet freed
+    std::size_t bytes_in_use(payload_kind kind) const { return _counters[kind].bytes.load(std::memory_order_relaxed); }
+    /// @return bytes of every kind allocated and not yet freed
+    std::size_t bytes_in_use() const;
+
+    /// set every counter to zero
+    void reset();
+
+private :
+    struct counters {
+        std::atomic<std::size_t> allocations;
+        std::atomic<std::size_t> frees;
+        std::atomic<std::size_t> bytes;
+    };
+
+    allocation_hook* _next;
+    counters _counters[payload_kind_count];
+};
+
+///
+/// @return the memory resource var payloads created on this thread are allocated from
+///
+/// 0, the default, allocates through the allocation hook or the global heap.
+///
+std::pmr::memory_resource* current_memory_resource();
+
+///
+/// allocate every var payload created on this thread from a memory resource while in scope
+///
+/// Strings, collection nodes and their buffers all come from the resource, so a tree built
+/// inside the scope lives entirely in it. Every node remembers its resource and returns its
+/// memory there when the last reference goes away, on any thread, so the resource has to
+/// outlive the vars built in it. Scopes nest, the innermost one wins.
+///
+class memory_resource_scope : boost::noncopyable {
+public :
+    explicit memory_resource_scope(std::pmr::memory_resource* resource);
+    ~memory_resource_scope();
+
+private :
+    std::pmr::memory_resource* _previous;
+};
+
+///
+/// bytes held by a var tree, see memory_usage()
+///
+struct memory_report {
+    memory_report();
+
+    /// @return sum of every kind of bytes
+    std::size_t total() const;
+
+    /// bytes of the root var itself
+    std::size_t inline_bytes;
+    /// heap bytes per payload kind
+    std::size_t bytes[payload_kind_count];
+    /// distinct nodes per payload kind
+    std::size_t nodes[payload_kind_count];
+};
+
+namespace detail {
+
+extern std::atomic<allocation_hook*> current_allocation_hook;
+
+/// allocate bytes for kind from resource, or through the current hook if resource is 0
+inline void* allocate(std::size_t bytes, std::size_t alignment, payload_kind kind, std::pmr::memory_resource* resource) {
+    if (resource) return resource->allocate(bytes, alignment);
+    allocation_hook* hook = current_allocation_hook.load(std::memory_order_acquire);
+    return hook ? hook->allocate(bytes, kind) : ::operator new(bytes);
+}
+
+/// free p, allocated by allocate(bytes, alignment, kind, resource)
+inline void deallocate(void* p, std::size_t bytes, std::size_t alignment, payload_kind kind, std::pmr::memory_resource* resource) {
+    if (resource) return resource->deallocate(p, bytes, alignment);
+    allocation_hook* hook = current_allocation_hook.load(std::memory_order_acquire);
+    if (hook) hook->deallocate(p, bytes, kind);
+    else ::operator delete(p);
+}
+
+///
+/// standard allocator that routes container storage to a memory resource or the allocation hook
+///
+/// A default constructed allocator takes the current_memory_resource() of the calling thread,
+/// and so does every copy of a container, so a copy made inside a memory_resource_scope lives
+/// in that scope's resource. Moves and swaps carry the resource along with the storage.
+///
+template <typename T, payload_kind Kind>
+struct payload_allocator {
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    template <typename U>
+    struct rebind { typedef payload_allocator<U, Kind> other; };
+
+    payload_allocator() : resource(current_memory_resource()) {}
+    template <typename U>
+    payload_allocator(const payload_allocator<U, Kind>& other) : resource(other.resource) {}
+
+    T* allocate(std::size_t n) { return static_cast<T*>(detail::allocate(n * sizeof(T), alignof(T), Kind, resource)); }
+    void deallocate(T* p, std::size_t n) { detail::deallocate(p, n * sizeof(T), alignof(T), Kind, resource); }
+
+    payload_allocator select_on_container_copy_construction() const { return payload_allocator(); }
+
+    /// 0 for the allocation hook
+    std::pmr::memory_resource* resource;
+};
+
+template <typename T, typename U, payload_kind Kind>
+bool operator == (const payload_allocator<T, Kind>& lhs, const payload_allocator<U, Kind>& rhs) { return lhs.resource == rhs.resource; }
+template <typename T, typename U, payload_kind Kind>
+bool operator != (const payload_allocator<T, Kind>& lhs, const payload_allocator<U, Kind>& rhs) { return lhs.resource != rhs.resource; }
+
+///
+/// base for nodes allocated from the current memory resource
+///
+/// The node remembers its resource, so release it with destroy() rather than delete.
+///
+template <payload_kind Kind>
+struct payload_node {
+    static const payload_kind kind = Kind;
+
+    payload_node() : node_resource(current_memory_resource()) {}
+    payload_node(const payload_node&) : node_resource(current_memory_resource()) {}
+    payload_node& operator = (const payload_node&) { return *this; }
+
+    // operator new runs on the thread and in the scope that constructs the node
+    static void* operator new(std::size_t bytes) { return detail::allocate(bytes, alignof(std::max_align_t), Kind, current_memory_resource()); }
+    // only reached when a constructor throws
+    static void operator delete(void* p, std::size_t bytes) { detail::deallocate(p, bytes, alignof(std::max_align_t), Kind, current_memory_resource()); }
+
+    /// resource the node was allocated from, 0 for the allocation hook
+    std::pmr::memory_resource* node_resource;
+};
+
+///
+/// destroy a node derived from payload_node and return its memory to its resource
+///
+template <typename Node>
+void destroy(const Node* p) {
+    std::pmr::memory_resource* resource = p->node_resource;
+    p->~Node();
+    detail::deallocate(const_cast<Node*>(p), sizeof(Node), alignof(std::max_align_t), Node::kind, resource);
+}
+
+///
+/// run destroy_node(node) now, or queue it if a teardown is already running on this thread
+///
+/// The outermost call drains the queue, so destroying a deeply nested tree takes a constant
+/// amount of stack instead of one destructor frame per level.
+///
+void destroy_iteratively(const void* node, void (*destroy_node)(const void*));
+
+template <typename Node>
+void destroy_erased(const void* p) { destroy(static_cast<const Node*>(p)); }
+
+///
+/// destroy a node that holds vars, without recursing into the collections below it
+///
+template <typename Node>
+void destroy_collection(const Node* p) { destroy_iteratively(p, &destroy_erased<Node>); }
+
+}
+}
+
+#endif // DYNAMIC_ALLOCATION_HPP
@@ -0,0 +1,108 @@
+#ifndef DYNAMIC_ATOMIC_DOCUMENT_HPP
+#define DYNAMIC_ATOMIC_DOCUMENT_HPP
+
+/*
+    Copyright (C) 2009, Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <boost/utility.hpp>
+
+#include <dynamic/var.hpp>
+
+namespace dynamic {
+
+///
+/// holder of a frozen var tree that readers load without locking while one writer replaces it
+///
+/// Readers take a snapshot, which pins the version they see until the snapshot is destroyed.
+/// Entering and leaving a snapshot is a pair of atomic stores, readers never wait and never
+/// lock. Replaced versions are freed by the writer, once no snapshot taken before the
+/// replacement is still alive (epoch-based reclamation).
+///
+class atomic_document : boost::noncopyable {
+    struct version;
+
+public :
+    ///
+    /// pinned, read-only view of one published version
+    ///
+    /// A snapshot must be destroyed on the thread that took it. Holding one delays the
+    /// release of every version published after it was taken, so keep it short.
+    ///
+    class snapshot {
+    public :
+        snapshot(snapshot&& other) : _version(other._version) { other._version = 0; }
+        ~snapshot();
+
+        /// @return the root of the pinned version
+        const var& root() const;
+        /// @return the root of the pinned version
+        operator const var& () const { return root(); }
+
+    private :
+        friend class atomic_document;
+        explicit snapshot(const version* v) : _version(v) {}
+        snapshot(const snapshot&) = delete;
+        snapshot& operator = (const snapshot&) = delete;
+
+        const version* _version;
+    };
+
+    explicit atomic_document(const var& root = var());
+    ~atomic_document();
+
+    snapshot read() const;
+    var load() const;
+
+    void publish(const var& root);
+    void publish(var&& root);
+    std::size_t reclaim();
+    std::size_t retired() const;
+
+private :
+    struct version {
+        explicit version(const var& v) : root(v), epoch(0) { root.freeze(); }
+        explicit version(var&& v) : root(std::move(v)), epoch(0) { root.freeze(); }
+
+        var root;
+        /// epoch in which the version was replaced
+        unsigned long long epoch;
+    };
+
+    void publish(version* next);
+    std::size_t reclaim_locked();
+
+    std::atomic<version*> _current;
+    mutable std::mutex _writer;
+    std::vector<version*> _retired;
+};
+
+}
+
+#endif // DYNAMIC_ATOMIC_DOCUMENT_HPP
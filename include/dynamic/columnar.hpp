@@ -0,0 +1,156 @@
+#ifndef DYNAMIC_COLUMNAR_HPP
+#define DYNAMIC_COLUMNAR_HPP
+
+/*
+    Copyright (C) 2009, Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <dynamic/var.hpp>
+
+namespace dynamic {
+
+class column_table;
+
+///
+/// one field of a column_table, packed into a contiguous array
+///
+/// Row i of an int, double or bool column is ints()[i], doubles()[i] or bools()[i]. Row i
+/// of a string column is chars() from offsets()[i] to offsets()[i + 1]. A column mixing
+/// ints and doubles is a double column, which remembers the rows that held an int so
+/// at() returns them as ints. A column whose values are not all of one of these types,
+/// or are collections or wide strings, keeps them as vars. Null rows hold 0 or "" in the
+/// packed array, and their bit in the null bitmap is clear.
+///
+/// The kernels run over the packed arrays and bitmaps, 64 rows at a time:
+///
+/// \code
+/// const column& price = *table.find("price");
+/// column::bitmap expensive = price.filter(column::greater, 10);
+/// double revenue = table.find("sold")->sum(&expensive);
+/// \endcode
+///
+class column {
+public :
+    enum type_t { type_null, type_bool, type_int, type_double, type_string, type_var };
+    enum compare_t { equal, not_equal, less, less_equal, greater, greater_equal };
+
+    /// one bit per row, row i in bit i % 64 of word i / 64
+    typedef std::vector<std::uint64_t> bitmap;
+
+    column();
+
+    /// @return field name
+    const var& name() const { return _name; }
+    /// @return type of the packed array
+    type_t type() const { return _type; }
+    /// @return number of rows
+    var::size_type size() const { return _size; }
+
+    /// @return true if row has a value other than null
+    bool is_valid(var::size_type row) const { return (_valid[row / 64] >> (row % 64)) & 1; }
+    /// @return true if the record in row has the field, even if it is null
+    bool has(var::size_type row) const { return _present.empty() || ((_present[row / 64] >> (row % 64)) & 1); }
+    var at(var::size_type row) const;
+    std::string_view string_at(var::size_type row) const;
+
+    /// @return bitmap of the rows with a value other than null
+    const bitmap& valid() const { return _valid; }
+    const std::vector<std::uint8_t>& bools() const { return _bools; }
+    const std::vector<int>& ints() const { return _ints; }
+    const std::vector<double>& doubles() const { return _doubles; }
+    const std::vector<var::size_type>& offsets() const { return _offsets; }
+    const std::string& chars() const { return _chars; }
+    const std::vector<var>& vars() const { return _vars; }
+
+    bitmap filter(compare_t op, const var& value) const;
+    double sum(const bitmap* selection = 0) const;
+    var min(const bitmap* selection = 0) const;
+    var max(const bitmap* selection = 0) const;
+    var::size_type count_distinct(const bitmap* selection = 0) const;
+
+    static var::size_type count(const bitmap& selection);
+
+private :
+    std::uint64_t selected(std::size_t word, const bitmap* selection) const;
+    var extreme(const bitmap* selection, int sign) const;
+
+    var _name;
+    type_t _type;
+    var::size_type _size;
+    bitmap _valid;
+    /// rows whose record has the field, empty if every record has it
+    bitmap _present;
+    /// rows of a double column that held an int, empty unless it mixes ints and doubles
+    bitmap _integral;
+    std::vector<std::uint8_t> _bools;
+    std::vector<int> _ints;
+    std::vector<double> _doubles;
+    std::vector<var::size_type> _offsets;
+    std::string _chars;
+    std::vector<var> _vars;
+
+    friend column_table to_columnar(const var& records);
+};
+
+///
+/// a vector of maps stored as one column per field
+///
+class column_table {
+public :
+    column_table() : _rows(0) {}
+
+    /// @return number of records
+    var::size_type rows() const { return _rows; }
+    /// @return columns in the order their field first appears in the records
+    const std::vector<column>& columns() const { return _columns; }
+    const column* find(const var& name) const;
+
+private :
+    var::size_type _rows;
+    std::vector<column> _columns;
+
+    friend column_table to_columnar(const var& records);
+};
+
+///
+/// convert a vector of maps to columns
+///
+/// The schema is inferred from the records: one column per key found in any of them, typed
+/// by the values it holds, with ints and doubles together making a double column. Records
+/// may be vectors or persistent vectors of maps or persistent maps.
+///
+column_table to_columnar(const var& records);
+
+///
+/// @return vector of maps equal to the records table was made from
+///
+var from_columnar(const column_table& table);
+
+}
+
+#endif // DYNAMIC_COLUMNAR_HPP
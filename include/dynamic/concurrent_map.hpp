@@ -0,0 +1,102 @@
+#ifndef DYNAMIC_CONCURRENT_MAP_HPP
+#define DYNAMIC_CONCURRENT_MAP_HPP
+
+/*
+    Copyright (C) 2009, Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <mutex>
+
+#include <boost/scoped_array.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/utility.hpp>
+
+#include <dynamic/var.hpp>
+
+namespace dynamic {
+
+///
+/// thread-safe map of vars, split into independently locked shards
+///
+/// Each key is assigned to a shard by hash_value(key), so threads working on keys in
+/// different shards never contend. Values are returned by copy; collections are
+/// copy-on-write, so modifying a returned value never affects the map.
+///
+class concurrent_map : boost::noncopyable {
+public :
+    typedef var::size_type size_type;
+
+    explicit concurrent_map(size_type shards = 16);
+
+    bool insert_or_assign(const var& key, const var& value);
+    bool find(const var& key, var& value) const;
+    bool contains(const var& key) const;
+    bool erase(const var& key);
+    void clear();
+
+    ///
+    /// get the value for a key, inserting f(key) first if the key is absent
+    ///
+    /// f is called with the shard locked, so it must not access this map.
+    ///
+    template <typename F>
+    var compute_if_absent(const var& key, F f) {
+        shard& s = shard_for(key);
+        std::lock_guard<std::mutex> guard(s.lock);
+        var::map_type::iterator it = s.map.lower_bound(key);
+        if ((it == s.map.end()) || (s.map.key_comp()(key, it->first)))
+            it = s.map.insert(it, var::pair_type(key, f(key)));
+        return it->second;
+    }
+
+    size_type count() const;
+    /// number of shards
+    size_type shards() const { return _mask + 1; }
+
+    var snapshot() const;
+
+private :
+    struct shard {
+        std::mutex lock;
+        var::map_type map;
+        // keep the locks of neighbouring shards on separate cache lines
+        char padding[64];
+    };
+
+    shard& shard_for(const var& key) const;
+
+    boost::scoped_array<shard> _shards;
+    size_type _mask;
+};
+
+/// shared handle to a concurrent_map
+typedef boost::shared_ptr<concurrent_map> concurrent_map_ptr;
+
+/// create an empty concurrent map with (at least) the given number of shards
+inline concurrent_map_ptr make_concurrent_map(var::size_type shards = 16) { return boost::make_shared<concurrent_map>(shards); }
+
+}
+
+#endif // DYNAMIC_CONCURRENT_MAP_HPP
@@ -0,0 +1,381 @@
+#ifndef DYNAMIC_CONVERT_HPP
+#define DYNAMIC_CONVERT_HPP
+
+/*
+    Copyright (C) 2009, Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <climits>
+#include <cstddef>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/preprocessor/seq/for_each.hpp>
+#include <boost/preprocessor/stringize.hpp>
+
+#include <dynamic/exception.hpp>
+#include <dynamic/var.hpp>
+
+namespace dynamic {
+
+///
+/// @file
+///
+/// Conversion between C++ values and vars. to_var(value) and from_var<T>(v) look up
+/// convert<T> at compile time, which is specialized here for the scalars var holds, other
+/// arithmetic types, std::vector, std::map, std::unordered_map, std::optional, std::pair
+/// and std::tuple, nesting freely. Conversions from an rvalue move the members of the
+/// value, and collections are sized once.
+///
+/// Specialize convert<T> for a type of your own with a static to_var(const T&) and a
+/// static from_var(const var&) returning T, or use DYNAMIC_CONVERT_STRUCT for a struct
+/// whose members should become the entries of a map:
+///
+/// \code
+/// struct point { int x; int y; std::optional<std::string> label; };
+/// DYNAMIC_CONVERT_STRUCT(point, (x)(y)(label))
+///
+/// var v = to_var(point{ 1, 2, std::nullopt });  // { "label" : null, "x" : 1, "y" : 2 }
+/// point p = from_var<point>(v);
+/// \endcode
+///
+
+///
+/// conversion between T and var, specialize it for types of your own
+///
+/// The second parameter is for specializations constrained with std::enable_if.
+///
+template <typename T, typename Enable = void>
+struct convert;
+
+/// @return value converted to a var, moving from its members if it is an rvalue
+template <typename T>
+var to_var(T&& value) {
+    return convert<typename std::decay<T>::type>::to_var(std::forward<T>(value));
+}
+
+/// @return v converted to a T
+template <typename T>
+T from_var(const var& v) {
+    return convert<T>::from_var(v);
+}
+
+namespace detail {
+
+///
+/// builds and reads the collections of a conversion without going through the var API
+///
+struct convert_access {
+    /// @return new vector with room for n items
+    static var vector(std::size_t n) {
+        var::vector_ptr items(new var::vector_node);
+        items->reserve(n);
+        return var(items);
+    }
+    /// append item to a vector made by vector()
+    static void push(var& vector, var&& item) {
+        boost::get<var::vector_ptr>(vector._var)->push_back(std::move(item));
+    }
+    /// @return new empty map
+    static var map() {
+        return var(var::map_ptr(new var::map_node));
+    }
+    /// add an entry to a map made by map(), sorted input should pass at_end
+    static void insert(var& map, var&& key, var&& value, bool at_end) {
+        var::map_node& entries = *boost::get<var::map_ptr>(map._var);
+        if (at_end) entries.emplace_hint(entries.end(), std::move(key), std::move(value));
+        else entries.emplace(std::move(key), std::move(value));
+    }
+    /// @return value of key in a map or persistent map, or none if it has no such key
+    static const var& find(const var& map, const var& key);
+    /// @return true for a vector, persistent vector or slice
+    static bool is_sequence(const var& v) { return v.is_vector() || v.is_persistent_vector() || v.is_slice(); }
+};
+
+/// item of a container passed as Container, moved from if the container is an rvalue
+template <typename Container, typename Item>
+typename std::conditional<std::is_lvalue_reference<Container>::value, const Item&, Item&&>::type forward_item(Item& item) {
+    return static_cast<typename std::conditional<std::is_lvalue_reference<Container>::value, const Item&, Item&&>::type>(item);
+}
+
+/// @return member name of map v converted to a T, from none if v has no such member
+template <typename T>
+T member_of(const var& v, const char* name) {
+    return from_var<T>(convert_access::find(v, name));
+}
+
+}
+
+/// a var converts to itself
+template <>
+struct convert<var> {
+    static var to_var(const var& v) { return v; }
+    static var to_var(var&& v) { return std::move(v); }
+    static var from_var(const var& v) { return v; }
+};
+
+template <>
+struct convert<bool> {
+    static var to_var(bool b) { return var(b); }
+    static bool from_var(const var& v) {
+        if (!v.is_bool()) throw exception("convert: expected a bool");
+        return bool(v);
+    }
+};
+
+///
+/// integer types other than bool, held as int
+///
+/// Values outside the range of int, or of T on the way back, throw.
+///
+template <typename T>
+struct convert<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+    static var to_var(T n) {
+        if constexpr (std::is_signed<T>::value) {
+            if ((long long)(n) < INT_MIN || (long long)(n) > INT_MAX) throw exception("convert: integer out of int range");
+        }
+        else {
+            if ((unsigned long long)(n) > (unsigned long long)(INT_MAX)) throw exception("convert: integer out of int range");
+        }
+        return var(int(n));
+    }
+    static T from_var(const var& v) {
+        if (!v.is_int()) throw exception("convert: expected an int");
+        const int n = int(v);
+        if constexpr (std::is_signed<T>::value) {
+            if ((long long)(n) < (long long)(std::numeric_limits<T>::min()) || (long long)(n) > (long long)(std::numeric_limits<T>::max()))
+                throw exception("convert: int out of range");
+        }
+        else {
+            if (n < 0 || (unsigned long long)(n) > (unsigned long long)(std::numeric_limits<T>::max()))
+                throw exception("convert: int out of range");
+        }
+        return T(n);
+    }
+};
+
+/// floating point types, held as double; an int var converts too
+template <typename T>
+struct convert<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static var to_var(T n) { return var(double(n)); }
+    static T from_var(const var& v) {
+        if (v.is_int()) return T(int(v));
+        if (!v.is_double()) throw exception("convert: expected a number");
+        return T(double(v));
+    }
+};
+
+template <>
+struct convert<std::string> {
+    static var to_var(const std::string& s) { return var(s); }
+    static std::string from_var(const var& v) {
+        if (!v.is_string()) throw exception("convert: expected a string");
+        return v;
+    }
+};
+
+template <>
+struct convert<std::wstring> {
+    static var to_var(const std::wstring& s) { return var(s); }
+    static std::wstring from_var(const var& v) {
+        if (!v.is_wstring()) throw exception("convert: expected a wstring");
+        return v;
+    }
+};
+
+/// string constants only convert to a var
+template <>
+struct convert<const char*> {
+    static var to_var(const char* s) { return var(s); }
+};
+
+template <>
+struct convert<const wchar_t*> {
+    static var to_var(const wchar_t* s) { return var(s); }
+};
+
+/// none stands for an empty optional
+template <typename T>
+struct convert<std::optional<T> > {
+    template <typename Optional>
+    static var to_var(Optional&& value) {
+        return value ? dynamic::to_var(*std::forward<Optional>(value)) : none;
+    }
+    static std::optional<T> from_var(const var& v) {
+        if (v.is_null()) return std::nullopt;
+        return dynamic::from_var<T>(v);
+    }
+};
+
+/// a vector of the converted items
+template <typename T, typename Allocator>
+struct convert<std::vector<T, Allocator> > {
+    template <typename Vector>
+    static var to_var(Vector&& items) {
+        var result = detail::convert_access::vector(items.size());
+        for (auto&& item : items)
+            detail::convert_access::push(result, convert<T>::to_var(detail::forward_item<Vector>(item)));
+        return result;
+    }
+    static std::vector<T, Allocator> from_var(const var& v) {
+        if (!detail::convert_access::is_sequence(v)) throw exception("convert: expected a vector");
+        std::vector<T, Allocator> result;
+        result.reserve(v.count());
+        for (var::const_iterator it = v.begin(); it != v.end(); ++it)
+            result.push_back(dynamic::from_var<T>(*it));
+        return result;
+    }
+};
+
+///
+/// a map of the converted entries
+///
+/// Keys are copied, the values are moved from an rvalue map.
+///
+template <typename Key, typename T, typename Compare, typename Allocator>
+struct convert<std::map<Key, T, Compare, Allocator> > {
+    template <typename Map>
+    static var to_var(Map&& entries) {
+        var result = detail::convert_access::map();
+        // most key types sort the same way as vars, which makes the end the right hint
+        for (auto&& entry : entries)
+            detail::convert_access::insert(result, convert<Key>::to_var(entry.first),
+                                           convert<T>::to_var(detail::forward_item<Map>(entry.second)), true);
+        return result;
+    }
+    static std::map<Key, T, Compare, Allocator> from_var(const var& v) {
+        if (!v.is_map() && !v.is_persistent_map()) throw exception("convert: expected a map");
+        std::map<Key, T, Compare, Allocator> result;
+        for (var::const_iterator it = v.begin(); it != v.end(); ++it)
+            result.emplace_hint(result.end(), dynamic::from_var<Key>(it.pair().first), dynamic::from_var<T>(it.pair().second));
+        return result;
+    }
+};
+
+template <typename Key, typename T, typename Hash, typename Equal, typename Allocator>
+struct convert<std::unordered_map<Key, T, Hash, Equal, Allocator> > {
+    template <typename Map>
+    static var to_var(Map&& entries) {
+        var result = detail::convert_access::map();
+        for (auto&& entry : entries)
+            detail::convert_access::insert(result, convert<Key>::to_var(entry.first),
+                                           convert<T>::to_var(detail::forward_item<Map>(entry.second)), false);
+        return result;
+    }
+    static std::unordered_map<Key, T, Hash, Equal, Allocator> from_var(const var& v) {
+        if (!v.is_map() && !v.is_persistent_map()) throw exception("convert: expected a map");
+        std::unordered_map<Key, T, Hash, Equal, Allocator> result;
+        result.reserve(v.count());
+        for (var::const_iterator it = v.begin(); it != v.end(); ++it)
+            result.emplace(dynamic::from_var<Key>(it.pair().first), dynamic::from_var<T>(it.pair().second));
+        return result;
+    }
+};
+
+/// a vector holding the converted elements in order
+template <typename... Ts>
+struct convert<std::tuple<Ts...> > {
+    template <typename Tuple>
+    static var to_var(Tuple&& value) {
+        return to_var(std::forward<Tuple>(value), std::index_sequence_for<Ts...>());
+    }
+    static std::tuple<Ts...> from_var(const var& v) {
+        return from_var(v, std::index_sequence_for<Ts...>());
+    }
+
+private :
+    template <typename Tuple, std::size_t... I>
+    static var to_var(Tuple&& value, std::index_sequence<I...>) {
+        var result = detail::convert_access::vector(sizeof...(Ts));
+        (detail::convert_access::push(result, dynamic::to_var(std::get<I>(std::forward<Tuple>(value)))), ...);
+        return result;
+    }
+    template <std::size_t... I>
+    static std::tuple<Ts...> from_var(const var& v, std::index_sequence<I...>) {
+        if (!detail::convert_access::is_sequence(v) || v.count() != sizeof...(Ts)) throw exception("convert: tuple size mismatch");
+        return std::tuple<Ts...>(dynamic::from_var<Ts>(v[int(I)])...);
+    }
+};
+
+/// a vector holding first and second
+template <typename First, typename Second>
+struct convert<std::pair<First, Second> > {
+    template <typename Pair>
+    static var to_var(Pair&& value) {
+        var result = detail::convert_access::vector(2);
+        detail::convert_access::push(result, dynamic::to_var(std::forward<Pair>(value).first));
+        detail::convert_access::push(result, dynamic::to_var(std::forward<Pair>(value).second));
+        return result;
+    }
+    static std::pair<First, Second> from_var(const var& v) {
+        if (!detail::convert_access::is_sequence(v) || v.count() != 2) throw exception("convert: pair size mismatch");
+        return std::pair<First, Second>(dynamic::from_var<First>(v[0]), dynamic::from_var<Second>(v[1]));
+    }
+};
+
+}
+
+/// @cond
+#define DYNAMIC_CONVERT_PUT(r, value, name) \
+    ::dynamic::detail::convert_access::insert(result, BOOST_PP_STRINGIZE(name), ::dynamic::to_var(value.name), false);
+#define DYNAMIC_CONVERT_GET(r, v, name) \
+    result.name = ::dynamic::detail::member_of<decltype(result.name)>(v, BOOST_PP_STRINGIZE(name));
+/// @endcond
+
+///
+/// specialize dynamic::convert for a struct, whose members become the entries of a map
+///
+/// members is a Boost.Preprocessor sequence of member names, (a)(b)(c). The struct must
+/// be default constructible. A member missing from the map converts from none, so only
+/// optional members may be left out. Use it at global namespace scope.
+///
+#define DYNAMIC_CONVERT_STRUCT(type, members) \
+    template <> \
+    struct dynamic::convert<type> { \
+        static ::dynamic::var to_var(const type& value) { \
+            ::dynamic::var result = ::dynamic::detail::convert_access::map(); \
+            BOOST_PP_SEQ_FOR_EACH(DYNAMIC_CONVERT_PUT, value, members) \
+            return result; \
+        } \
+        static ::dynamic::var to_var(type&& value) { \
+            ::dynamic::var result = ::dynamic::detail::convert_access::map(); \
+            BOOST_PP_SEQ_FOR_EACH(DYNAMIC_CONVERT_PUT, std::move(value), members) \
+            return result; \
+        } \
+        static type from_var(const ::dynamic::var& v) { \
+            if (!v.is_map() && !v.is_persistent_map()) throw ::dynamic::exception("convert: expected a map"); \
+            type result; \
+            BOOST_PP_SEQ_FOR_EACH(DYNAMIC_CONVERT_GET, v, members) \
+            return result; \
+        } \
+    };
+
+#endif // DYNAMIC_CONVERT_HPP
@@ -28,5 +28,17 @@
 
 #include <dynamic/exception.hpp>
 #include <dynamic/var.hpp>
+#include <dynamic/concurrent_map.hpp>
+#include <dynamic/frozen.hpp>
+#include <dynamic/atomic_document.hpp>
+#include <dynamic/traverse.hpp>
+#include <dynamic/reclaimer.hpp>
+#include <dynamic/path.hpp>
+#include <dynamic/query.hpp>
+#include <dynamic/columnar.hpp>
+#include <dynamic/record_index.hpp>
+#include <dynamic/group_by.hpp>
+#include <dynamic/view.hpp>
+#include <dynamic/convert.hpp>
 
 #endif // DYNAMIC_DYNAMIC_HPP
@@ -0,0 +1,106 @@
+#ifndef DYNAMIC_FINGERPRINT_HPP
+#define DYNAMIC_FINGERPRINT_HPP
+
+/*
+    Copyright (C) 2009, Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <atomic>
+#include <functional>
+#include <string>
+
+#include <boost/cstdint.hpp>
+
+namespace dynamic {
+
+///
+/// 128-bit digest of the content of a var, see fingerprint_of()
+///
+struct fingerprint {
+    fingerprint() : high(0), low(0) {}
+    fingerprint(boost::uint64_t h, boost::uint64_t l) : high(h), low(l) {}
+
+    bool operator == (const fingerprint& rhs) const { return high == rhs.high && low == rhs.low; }
+    bool operator != (const fingerprint& rhs) const { return !(*this == rhs); }
+    bool operator < (const fingerprint& rhs) const { return high < rhs.high || (high == rhs.high && low < rhs.low); }
+
+    /// @return 32 lowercase hex digits
+    std::string str() const;
+
+    boost::uint64_t high;
+    boost::uint64_t low;
+};
+
+namespace detail {
+
+///
+/// fingerprint of a frozen collection, computed on first use
+///
+/// Only frozen nodes fill it in, since nothing below them can change any more. Readers
+/// of a frozen tree may race to fill it in, they all store the same value. A copied
+/// node starts out empty, the copy may be modified.
+///
+class fingerprint_memo {
+public :
+    fingerprint_memo() : _high(0), _low(0), _valid(false) {}
+    fingerprint_memo(const fingerprint_memo&) : _high(0), _low(0), _valid(false) {}
+    fingerprint_memo& operator = (const fingerprint_memo&) { _valid.store(false, std::memory_order_relaxed); return *this; }
+
+    /// @return true and set f if the fingerprint is known
+    bool get(fingerprint& f) const {
+        if (!_valid.load(std::memory_order_acquire)) return false;
+        f.high = _high.load(std::memory_order_relaxed);
+        f.low = _low.load(std::memory_order_relaxed);
+        return true;
+    }
+
+    /// remember f
+    void set(const fingerprint& f) const {
+        _high.store(f.high, std::memory_order_relaxed);
+        _low.store(f.low, std::memory_order_relaxed);
+        _valid.store(true, std::memory_order_release);
+    }
+
+private :
+    mutable std::atomic<boost::uint64_t> _high;
+    mutable std::atomic<boost::uint64_t> _low;
+    mutable std::atomic<bool> _valid;
+};
+
+}
+}
+
+namespace std {
+
+///
+/// std::hash for fingerprint, a fingerprint is already well mixed
+///
+template <>
+struct hash<dynamic::fingerprint> {
+    std::size_t operator () (const dynamic::fingerprint& f) const { return std::size_t(f.low); }
+};
+
+}
+
+#endif // DYNAMIC_FINGERPRINT_HPP
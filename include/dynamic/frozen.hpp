@@ -0,0 +1,73 @@
+#ifndef DYNAMIC_FROZEN_HPP
+#define DYNAMIC_FROZEN_HPP
+
+/*
+    Copyright (C) 2009, Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <dynamic/var.hpp>
+
+namespace dynamic {
+
+///
+/// read-only handle to a frozen var tree
+///
+/// Share a frozen_var between threads by reference or pointer. Every accessor
+/// returns a reference into the tree, so readers never copy a var and never
+/// touch a reference count.
+///
+class frozen_var {
+public :
+    /// frozen null
+    frozen_var() {}
+    /// hold v frozen; nodes v shares with other vars are copied, so they stay mutable
+    explicit frozen_var(const var& v) : _root(v) { _root.freeze(); }
+
+    /// @return the frozen tree
+    const var& root() const { return _root; }
+    /// @return the frozen tree
+    operator const var& () const { return _root; }
+
+    /// index a frozen vector or map
+    const var& operator [] (int n) const { return _root[n]; }
+    /// look up a key in a frozen map
+    const var& operator [] (const var& key) const { return _root[key]; }
+
+    /// count of objects in the frozen collection
+    var::size_type count() const { return _root.count(); }
+    /// @return iterator to the first item in the frozen collection
+    var::const_iterator begin() const { return _root.begin(); }
+    /// @return iterator past the last item in the frozen collection
+    var::const_iterator end() const { return _root.end(); }
+
+private :
+    var _root;
+};
+
+/// freeze v and return a read-only handle to it
+inline frozen_var freeze(const var& v) { return frozen_var(v); }
+
+}
+
+#endif // DYNAMIC_FROZEN_HPP
@@ -0,0 +1,99 @@
+#ifndef DYNAMIC_GROUP_BY_HPP
+#define DYNAMIC_GROUP_BY_HPP
+
+/*
+    Copyright (C) 2009, Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+
+#include <dynamic/path.hpp>
+#include <dynamic/var.hpp>
+
+namespace dynamic {
+
+///
+/// group a vector of records by the values at one or more paths and aggregate each group
+///
+/// \code
+/// var report = group_by().key("region", "/region").key("year", "/date/year")
+///                        .count("orders").sum("revenue", "/price").avg("mean", "/price")
+///                        .run(orders);
+/// \endcode
+///
+/// run() returns a vector with one map per group, in the order each group first appears
+/// in the records. Each map has the keys and aggregates under their names. A record
+/// without a key path falls in the group whose key there is null. Aggregates other than
+/// count() skip records where their path leads nowhere or to null:
+///
+/// - count: records in the group
+/// - sum: an int while every value is an int and the total fits, else a double
+/// - min, max: least and greatest value in var::compare() order, with ints and doubles
+///   compared by value, null for none
+/// - avg: mean as a double, null for none
+/// - collect: vector of the values in record order
+///
+/// Groups live in an open-addressing hash table. Large inputs are split into chunks of at
+/// least min_chunk records, each aggregated into its own table on its own thread; the
+/// tables are merged in chunk order at the end.
+///
+class group_by {
+public :
+    group_by() {}
+
+    group_by& key(const std::string& name, const std::string& pointer);
+    group_by& count(const std::string& name);
+    group_by& sum(const std::string& name, const std::string& pointer);
+    group_by& min(const std::string& name, const std::string& pointer);
+    group_by& max(const std::string& name, const std::string& pointer);
+    group_by& avg(const std::string& name, const std::string& pointer);
+    group_by& collect(const std::string& name, const std::string& pointer);
+
+    var run(const var& records, std::size_t threads = 0) const;
+
+    /// fewest records per thread before run() splits its input
+    static const var::size_type min_chunk = 4096;
+
+private :
+    enum op_t { op_count, op_sum, op_min, op_max, op_avg, op_collect };
+
+    struct field {
+        field(const std::string& name, const std::string& pointer, op_t op) : name(name), at(pointer), op(op) {}
+        var name;
+        path at;
+        op_t op;
+    };
+
+    class table;
+
+    group_by& aggregate(const std::string& name, const std::string& pointer, op_t op);
+
+    std::vector<field> _keys;
+    std::vector<field> _aggregates;
+};
+
+}
+
+#endif // DYNAMIC_GROUP_BY_HPP
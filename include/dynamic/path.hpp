@@ -0,0 +1,89 @@
+#ifndef DYNAMIC_PATH_HPP
+#define DYNAMIC_PATH_HPP
+
+/*
+    Copyright (C) 2009, Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+
+#include <dynamic/var.hpp>
+
+namespace dynamic {
+
+///
+/// location in a var tree, written as a JSON Pointer (RFC 6901)
+///
+/// "/a/b/3/c" is doc["a"]["b"][3]["c"]. Within a segment "~1" stands for '/' and "~0" for
+/// '~'; "" is the whole document. The path is parsed once and every key is built up front,
+/// so evaluating it against many documents neither allocates nor throws.
+///
+/// A segment made of digits indexes vectors. In a map it names the string key, or the
+/// int key when the map has no such string key.
+///
+/// \code
+/// const path price("/items/0/price");
+/// for (...)
+///     if (const var* p = price.find(doc)) total += double(*p);
+/// \endcode
+///
+class path {
+public :
+    path();
+    explicit path(const std::string& pointer);
+    explicit path(const char* pointer);
+
+    const var* find(const var& doc) const;
+    var& set(var& doc, const var& value) const;
+
+    /// @return number of segments
+    var::size_type size() const { return _segments.size(); }
+    /// @return the path as a JSON Pointer
+    const std::string& str() const { return _pointer; }
+
+private :
+    struct segment {
+        /// the segment as a string key
+        var key;
+        /// the segment as an int key, if it is an index
+        var int_key;
+        /// vector index, or npos if the segment is not made of digits
+        var::size_type index;
+        /// true for "-", the position after the last item of a vector
+        bool append;
+    };
+
+    static const var::size_type npos = var::size_type(-1);
+
+    void parse();
+    static bool has_key(const var& map, const var& key);
+
+    std::string _pointer;
+    std::vector<segment> _segments;
+};
+
+}
+
+#endif // DYNAMIC_PATH_HPP
@@ -0,0 +1,86 @@
+#ifndef DYNAMIC_QUERY_HPP
+#define DYNAMIC_QUERY_HPP
+
+/*
+    Copyright (C) 2009, Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <dynamic/var.hpp>
+
+namespace dynamic {
+
+///
+/// compiled query over var documents, in a subset of jq syntax
+///
+/// A query is a pipeline of stages separated by '|', each turning every var it receives
+/// into zero or more vars for the next stage:
+///
+/// - `.`, `.a.b`, `.a[0]`, `."key"`: the value at a path, null if there is none
+/// - `.items[]`: every element of a vector (or value of a map) at a path, nothing if
+///   the path leads nowhere; `[]` may appear several times, as in `.a[].b[]`
+/// - `select(p)`: the input if predicate p holds. Predicates compare paths and
+///   literals (numbers, "strings", true, false, null) with == != < <= > >=, combine
+///   them with and, or, not and parentheses, or test a path alone for a value other
+///   than null and false. Ints and doubles compare by value.
+/// - `{id, price, name: .a.b}`: a map of the listed fields
+///
+/// \code
+/// const query q(".items[] | select(.price > 10) | {id, price}");
+/// var result = q.run(doc);
+/// \endcode
+///
+/// Paths are compiled once into dynamic::path objects. A select placed after a projection
+/// that only reads projected fields runs before it instead, on the unprojected input.
+/// run() splits a large vector at the head of the pipeline into chunks processed by
+/// several threads; the result keeps the input order.
+///
+class query {
+public :
+    explicit query(const std::string& expression);
+
+    var run(const var& input, std::size_t threads = 0) const;
+
+    /// @return the query text
+    const std::string& str() const { return _expression; }
+
+    /// fewest elements per thread before run() splits its input
+    static const var::size_type min_chunk = 4096;
+
+private :
+    struct expr;
+    struct stage;
+    class parser;
+
+    std::string _expression;
+    boost::shared_ptr<const stage> _first;
+};
+
+}
+
+#endif // DYNAMIC_QUERY_HPP
@@ -0,0 +1,93 @@
+#ifndef DYNAMIC_RECLAIMER_HPP
+#define DYNAMIC_RECLAIMER_HPP
+
+/*
+    Copyright (C) 2009, Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/utility.hpp>
+
+#include <dynamic/var.hpp>
+
+namespace dynamic {
+
+///
+/// background thread that destroys var trees handed to it
+///
+/// Dropping the last reference to a large collection frees every node below it before
+/// returning. dispose() moves the collection onto a bounded queue instead, and the
+/// reclaimer's thread frees it later, so the caller pays for a move and a lock
+/// regardless of the size of the tree. When the queue is full, or the var is not a
+/// collection, the var is released on the calling thread as before.
+///
+/// Nodes are freed on the reclaimer's thread, so the memory resources and allocation
+/// hook they were allocated through must be safe to use from another thread.
+///
+class reclaimer : boost::noncopyable {
+public :
+    explicit reclaimer(std::size_t capacity = 1024);
+    ~reclaimer();
+
+    bool dispose(var&& v);
+    void drain();
+
+    /// @return number of vars queued and not yet taken by the reclaimer's thread
+    std::size_t pending() const;
+    /// @return largest number of vars that can be queued at once
+    std::size_t capacity() const { return _capacity; }
+
+private :
+    void run();
+
+    const std::size_t _capacity;
+    mutable std::mutex _lock;
+    std::condition_variable _work;
+    std::condition_variable _idle;
+    std::vector<var> _queue;
+    /// true while the thread is destroying a batch taken off the queue
+    bool _busy;
+    bool _stop;
+    std::thread _thread;
+};
+
+///
+/// @return the process-wide reclaimer used by dispose_async(), started on first use
+///
+reclaimer& default_reclaimer();
+
+///
+/// hand v to the default reclaimer, leaving v null
+///
+/// @return true if v was queued, false if it was released on the calling thread
+///
+inline bool dispose_async(var&& v) { return default_reclaimer().dispose(std::move(v)); }
+
+}
+
+#endif // DYNAMIC_RECLAIMER_HPP
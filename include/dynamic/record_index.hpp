@@ -0,0 +1,119 @@
+#ifndef DYNAMIC_RECORD_INDEX_HPP
+#define DYNAMIC_RECORD_INDEX_HPP
+
+/*
+    Copyright (C) 2009, Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <dynamic/path.hpp>
+#include <dynamic/var.hpp>
+
+namespace dynamic {
+
+///
+/// secondary index over a vector of records, keyed by the value at a path in each record
+///
+/// A hash index answers equality lookups; a sorted index also answers range queries in key
+/// order. Keys match as var::operator == and order as var::compare(). Records without the
+/// key path are not indexed. Lookups return positions in the vector, ascending for equal
+/// keys, or the record itself.
+///
+/// The index keeps a pointer to the vector, which must outlive it. Appending through the
+/// index keeps both in step; records appended to the vector directly are picked up by
+/// update(). Any other change to the vector needs a rebuild().
+///
+/// \code
+/// record_index by_id(orders, "/id");
+/// if (const var* order = by_id.first(42)) ...
+/// by_id(make_map("id", 43)("price", 9.5));
+/// \endcode
+///
+class record_index {
+public :
+    enum kind_t { hash, sorted };
+
+    record_index(var& records, const std::string& key, kind_t kind = hash, std::size_t threads = 0);
+    record_index(var& records, const path& key, kind_t kind = hash, std::size_t threads = 0);
+
+    record_index& operator () (const var& record);
+    void update();
+    void rebuild(std::size_t threads = 0);
+
+    std::vector<var::size_type> find(const var& value) const;
+    std::vector<var::size_type> range(const var& low, const var& high) const;
+    const var* first(const var& value) const;
+    var::size_type count(const var& value) const;
+
+    /// @return kind of index
+    kind_t kind() const { return _kind; }
+    /// @return number of records indexed
+    var::size_type size() const { return _indexed; }
+    /// @return the indexed vector
+    const var& records() const { return *_records; }
+
+    /// fewest records per thread before a build splits its input
+    static const var::size_type min_chunk = 4096;
+
+private :
+    /// key with its hash, so shards and buckets share one hash computation
+    struct hashed_key {
+        std::size_t hash;
+        var value;
+        bool operator == (const hashed_key& other) const { return hash == other.hash && value == other.value; }
+    };
+    struct key_hash {
+        std::size_t operator () (const hashed_key& key) const { return key.hash; }
+    };
+    typedef std::unordered_map<hashed_key, std::vector<var::size_type>, key_hash> shard;
+    typedef std::pair<var, var::size_type> entry;
+
+    struct entry_less {
+        bool operator () (const entry& lhs, const entry& rhs) const {
+            const int c = var::compare(lhs.first, rhs.first);
+            return c < 0 || (c == 0 && lhs.second < rhs.second);
+        }
+    };
+
+    void add(const var& key, var::size_type position);
+    const std::vector<var::size_type>* bucket(const var& value) const;
+    std::pair<std::vector<entry>::const_iterator, std::vector<entry>::const_iterator> equal_range(const var& value) const;
+
+    var* _records;
+    path _key;
+    kind_t _kind;
+    var::size_type _indexed;
+    /// hash index, split by hash so each shard can be built on its own thread
+    std::vector<shard> _shards;
+    /// sorted index
+    std::vector<entry> _entries;
+};
+
+}
+
+#endif // DYNAMIC_RECORD_INDEX_HPP
@@ -0,0 +1,96 @@
+#ifndef DYNAMIC_REF_COUNTED_HPP
+#define DYNAMIC_REF_COUNTED_HPP
+
+/*
+    Copyright (C) 2009, Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstddef>
+
+#ifndef DYNAMIC_NON_ATOMIC_REFCOUNT
+#include <atomic>
+#endif
+
+namespace dynamic {
+namespace detail {
+
+///
+/// reference count embedded in every node a var points to
+///
+/// Nodes are held by boost::intrusive_ptr, so a copy of a var touches one word
+/// in the node instead of a separate control block. Counts are atomic unless
+/// DYNAMIC_NON_ATOMIC_REFCOUNT is defined (cmake -DDYNAMIC_ATOMIC_REFCOUNT=OFF).
+/// Non-atomic counts are only safe when no var tree is shared between threads,
+/// which rules out atomic_document, concurrent_map and frozen_var readers.
+///
+class ref_counted {
+public :
+    /// take a reference
+    void add_ref() const {
+#ifdef DYNAMIC_NON_ATOMIC_REFCOUNT
+        ++_refs;
+#else
+        _refs.fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+
+    /// drop a reference, @return true if it was the last one
+    bool release() const {
+#ifdef DYNAMIC_NON_ATOMIC_REFCOUNT
+        return --_refs == 0;
+#else
+        if (_refs.fetch_sub(1, std::memory_order_release) != 1) return false;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+#endif
+    }
+
+    /// @return true if exactly one reference exists
+    bool unique() const {
+#ifdef DYNAMIC_NON_ATOMIC_REFCOUNT
+        return _refs == 1;
+#else
+        return _refs.load(std::memory_order_acquire) == 1;
+#endif
+    }
+
+protected :
+    ref_counted() : _refs(0) {}
+    // a copied node starts out unreferenced
+    ref_counted(const ref_counted&) : _refs(0) {}
+    ref_counted& operator = (const ref_counted&) { return *this; }
+    ~ref_counted() {}
+
+private :
+#ifdef DYNAMIC_NON_ATOMIC_REFCOUNT
+    mutable std::size_t _refs;
+#else
+    mutable std::atomic<std::size_t> _refs;
+#endif
+};
+
+}
+}
+
+#endif // DYNAMIC_REF_COUNTED_HPP
@@ -0,0 +1,175 @@
+#ifndef DYNAMIC_TRAVERSE_HPP
+#define DYNAMIC_TRAVERSE_HPP
+
+/*
+    Copyright (C) 2009, Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <optional>
+
+#include <boost/container/small_vector.hpp>
+
+#include <dynamic/var.hpp>
+
+namespace dynamic {
+
+///
+/// position among the members of one collection
+///
+/// The members of a vector are its elements, the members of a map are each key
+/// followed by its value. A cursor starts before the first member.
+///
+class member_cursor {
+public :
+    explicit member_cursor(const var& collection);
+
+    /// move to the next member, @return false once past the last one
+    bool next();
+
+    /// @return the collection being walked
+    const var& collection() const { return *_collection; }
+    /// @return the current member
+    const var& member() const { return *_member; }
+    /// @return true if the collection is a map
+    bool is_map() const { return _type == var::type_map || _type == var::type_persistent_map; }
+    /// @return true if the current member is a map value
+    bool on_value() const { return _phase == 2; }
+    /// @return position of the current element, or map entry, in the collection
+    var::size_type index() const { return _index; }
+
+    /// @return true if v is a collection
+    static bool is_collection(const var& v) { return v._var.which() >= var::type_vector; }
+
+private :
+    const var* _collection;
+    const var* _member;
+    var::code _type;
+    /// 0 before the first member, 1 on a vector element or map key, 2 on a map value
+    int _phase;
+    var::size_type _index;
+    // vectors and maps are walked directly, persistent collections through const_iterator
+    const var* _item;
+    const var* _items_end;
+    var::map_type::const_iterator _entry;
+    var::map_type::const_iterator _entries_end;
+    std::optional<var::const_iterator> _it;
+    std::optional<var::const_iterator> _end;
+};
+
+///
+/// depth-first walk over a var tree with an explicit stack
+///
+/// Each call to next() produces one event: enter and leave around every collection,
+/// leaf for every other var. Members of a map are visited as a key followed by its
+/// value. The walk never recurses, so its stack use does not depend on the depth of
+/// the tree. The tree must not be modified during the walk.
+///
+/// \code
+/// for (tree_walker w(doc); w.next(); )
+///     if (w.event() == tree_walker::leaf) ...
+/// \endcode
+///
+class tree_walker {
+public :
+    enum event_t { enter, leave, leaf };
+    /// where the current var sits in its parent
+    enum role_t { root, element, key, value };
+
+    explicit tree_walker(const var& root);
+
+    /// move to the next event, @return false once the walk is over
+    bool next();
+    /// do not visit the members of the collection just entered, its leave event comes next
+    void skip();
+
+    /// @return the current event
+    event_t event() const { return _event; }
+    /// @return where the current var sits in its parent
+    role_t role() const { return _role; }
+    /// @return the var the current event is about
+    const var& node() const { return *_node; }
+    /// @return position of the current var (or map entry) in its parent
+    var::size_type index() const { return _index; }
+    /// @return number of collections enclosing the current var
+    var::size_type depth() const { return _stack.size(); }
+
+private :
+    const var* _root;
+    const var* _node;
+    event_t _event;
+    role_t _role;
+    var::size_type _index;
+    bool _started;
+    bool _skip;
+    // trees this shallow are walked without allocating
+    boost::container::small_vector<member_cursor, 8> _stack;
+};
+
+///
+/// move to the next member
+///
+inline bool member_cursor::next() {
+    switch (_type) {
+    case var::type_vector :
+        if (_phase) {
+            ++_item;
+            ++_index;
+        }
+        _phase = 1;
+        _member = _item;
+        return _item != _items_end;
+    case var::type_map :
+        if (_phase == 1) {
+            _phase = 2;
+            _member = &_entry->second;
+            return true;
+        }
+        if (_phase) {
+            ++_entry;
+            ++_index;
+        }
+        _phase = 1;
+        if (_entry == _entries_end) return false;
+        _member = &_entry->first;
+        return true;
+    default :
+        if (_phase == 1 && is_map()) {
+            _phase = 2;
+            _member = &(*_it).pair().second;
+            return true;
+        }
+        if (_phase) {
+            ++*_it;
+            ++_index;
+        }
+        _phase = 1;
+        if (*_it == *_end) return false;
+        _member = &**_it;
+        return true;
+    }
+}
+
+}
+
+#endif // DYNAMIC_TRAVERSE_HPP
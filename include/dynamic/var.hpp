@@ -26,20 +26,51 @@
     OTHER DEALINGS IN THE SOFTWARE.
 */
 
+#include <initializer_list>
+#include <iterator>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <map>
 
 #include <boost/variant.hpp>
-#include <boost/shared_ptr.hpp>
-#include <boost/make_shared.hpp>
+#include <boost/intrusive_ptr.hpp>
 #include <boost/utility.hpp>
 
+#include <dynamic/allocation.hpp>
+#include <dynamic/fingerprint.hpp>
+#include <dynamic/ref_counted.hpp>
+
 ///
 /// Dynamic C++ namespace
 ///
 namespace dynamic {
 
+struct dedupe_report;
+class column_table;
+class var;
+
+namespace detail {
+
+class literal;
+struct convert_access;
+
+/// var for an iterator type, so make_vector(first, last) does not take two scalars
+template <typename It, typename = void>
+struct range_of_items {};
+template <typename It>
+struct range_of_items<It, std::void_t<typename std::iterator_traits<It>::iterator_category> > { typedef var type; };
+
+/// var for an iterator over pairs, so make_map(first, last) does not take a key and a value
+template <typename It, typename = void>
+struct range_of_pairs {};
+template <typename It>
+struct range_of_pairs<It, std::void_t<typename std::iterator_traits<It>::iterator_category,
+                                      decltype(std::declval<It>()->first), decltype(std::declval<It>()->second)> > { typedef var type; };
+
+}
+
 ///
 /// the var class is the heart of Dynamic C++
 ///
@@ -47,7 +78,8 @@ class var {
 public :
     typedef std::size_t size_type;
     // Note to dynamic developer: Make sure that code and the variant list for var_t always match
-    enum code { type_null = 0, type_bool, type_int, type_double, type_string, type_wstring, type_vector, type_map };
+    enum code { type_null = 0, type_bool, type_int, type_double, type_string, type_wstring, type_vector, type_map,
+                type_persistent_vector, type_persistent_map, type_slice };
 
     var();
     var(bool);
@@ -58,6 +90,8 @@ public :
     var(const std::wstring& s);
     var(const wchar_t* s);
     var(const var& v);
+    var(var&& v);
+    var(std::initializer_list<detail::literal> items);
 
     var& operator = (bool);
     var& operator = (int n);
@@ -67,6 +101,7 @@ public :
     var& operator = (const std::wstring& s);
     var& operator = (const wchar_t* s);
     var& operator = (const var& v);
+    var& operator = (var&& v);
 
     operator bool() const;
     operator int() const;
@@ -151,8 +186,16 @@ public :
     bool is_vector() const { return type() == type_vector; }
     /// is var a map?
     bool is_map() const { return type() == type_map; }
+    /// is var a persistent vector?
+    bool is_persistent_vector() const { return type() == type_persistent_vector; }
+    /// is var a persistent map?
+    bool is_persistent_map() const { return type() == type_persistent_map; }
+    /// is var a persistent collection type?
+    bool is_persistent() const { return is_persistent_vector() || is_persistent_map(); }
+    /// is var a slice of a vector?
+    bool is_slice() const { return type() == type_slice; }
     /// is var a collection type?
-    bool is_collection() const { return is_vector() || is_map(); }
+    bool is_collection() const { return is_vector() || is_map() || is_persistent() || is_slice(); }
 
     var& operator () (bool);
     var& operator () (int n);
@@ -163,6 +206,23 @@ public :
     var& operator () (const wchar_t* s);
     var& operator () (const var& v);
     var& operator () (const var& k, const var& v);
+
+    var& freeze();
+    bool is_frozen() const;
+    var deep_clone() const;
+    var slice(size_type offset, size_type length) const;
+
+    var& erase(const var& key);
+    var& erase(size_type first, size_type last);
+    var& insert(size_type index, const var& v);
+    var& insert(size_type index, var&& v);
+    var& pop_back();
+    var& clear();
+    var& reserve(size_type n);
+    var& shrink_to_fit();
+    var& splice(var& source);
+    var& splice(var& source, const var& key);
+    var& splice(size_type index, var& source);
         
     std::ostream& _write_var(std::ostream& os) const;
     std::ostream& _write_string(std::ostream& os) const;
@@ -176,27 +236,80 @@ public :
         
     size_type count() const;
     var& operator [] (int n);
+    const var& operator [] (int n) const;
     var& operator [] (double n);
+    const var& operator [] (double n) const;
     var& operator [] (const std::string& s);
+    const var& operator [] (const std::string& s) const;
     var& operator [] (const char* s);
+    const var& operator [] (const char* s) const;
     var& operator [] (const std::wstring& s);
+    const var& operator [] (const std::wstring& s) const;
     var& operator [] (const wchar_t* s);
+    const var& operator [] (const wchar_t* s) const;
     var& operator [] (const var& v);
     const var& operator [] (const var& v) const;
 
-    /// var comparison functor
+    /// three-way comparison in less_var order, @return <0, 0 or >0
+    static int compare(const var& lhs, const var& rhs);
+
+    ///
+    /// var comparison functor: a total order consistent with operator ==
+    ///
+    /// Vars of different types order by type. Collections order lexicographically by their
+    /// members in iteration order, map entries as key then value, and a prefix comes first.
+    ///
     struct less_var {
         /// var comparison function
-        bool operator () (const var& lhs, const var& rhs);
+        bool operator () (const var& lhs, const var& rhs) const { return compare(lhs, rhs) < 0; }
     };
 
     /// vector type
-    typedef std::vector<var> vector_type;
+    typedef std::vector<var, detail::payload_allocator<var, payload_vector> > vector_type;
     /// map type
-    typedef std::map<var, var, less_var> map_type;
+    typedef std::map<var, var, less_var, detail::payload_allocator<std::pair<const var, var>, payload_map> > map_type;
     /// pair type
     typedef map_type::value_type pair_type;
 
+private :
+    struct pvector_node;
+    struct pmap_node;
+    struct hamt_node;
+
+    ///
+    /// position in a persistent vector, caching the leaf that holds it
+    ///
+    struct pvector_iterator {
+        pvector_iterator(const pvector_node* vec, size_type index);
+        /// same position
+        bool operator == (const pvector_iterator& rhs) const { return index == rhs.index && vec == rhs.vec; }
+        void next();
+        void prev();
+        const var& get() const;
+
+        const pvector_node* vec;
+        size_type index;
+        const var* leaf;
+    };
+
+    ///
+    /// position in a persistent map, caching the trie node that holds it
+    ///
+    struct pmap_iterator {
+        pmap_iterator(const pmap_node* map, size_type index);
+        /// same position
+        bool operator == (const pmap_iterator& rhs) const { return index == rhs.index && map == rhs.map; }
+        void next();
+        void prev();
+        const pair_type& get() const;
+
+        const pmap_node* map;
+        size_type index;
+        const hamt_node* leaf;
+        size_type offset;
+    };
+
+public :
     ///
     /// collection const_iterator class
     ///
@@ -207,9 +320,9 @@ public :
         const_iterator operator--();
         const_iterator operator--(int);
 
-        bool operator==(const_iterator rhs);
+        bool operator==(const_iterator rhs) const;
         /// iterator inequality
-        bool operator!=(const_iterator rhs) { return !(*this == rhs); }
+        bool operator!=(const_iterator rhs) const { return !(*this == rhs); }
 
         const var& operator*() const;
         const pair_type& pair() const;
@@ -217,20 +330,29 @@ public :
     private :
         friend class var;
         /// initialize from vector iterator
-        const_iterator(vector_type::iterator iter) : _iter(iter) {}
+        const_iterator(vector_type::iterator iter) : _iter(iter), _read_only(false) {}
         /// initialize from map iterator
-        const_iterator(map_type::iterator iter) : _iter(iter) {}
+        const_iterator(map_type::iterator iter) : _iter(iter), _read_only(false) {}
+        /// initialize from persistent vector position
+        const_iterator(pvector_iterator iter) : _iter(iter), _read_only(false) {}
+        /// initialize from persistent map position
+        const_iterator(pmap_iterator iter) : _iter(iter), _read_only(false) {}
 
         // make sure base_type and the variant list for iter_t always match
-        enum base_type { type_vector = 0, type_map };
-        typedef boost::variant<vector_type::iterator, map_type::iterator> iter_t;
+        enum base_type { type_vector = 0, type_map, type_persistent_vector, type_persistent_map };
+        typedef boost::variant<vector_type::iterator, map_type::iterator, pvector_iterator, pmap_iterator> iter_t;
 
         iter_t _iter;
+        /// set on an iterator into a frozen collection, which may only be read through it
+        bool _read_only;
     };
 
     ///
     /// collection iterator class
     ///
+    /// An iterator over a frozen collection still reads like a const_iterator, but
+    /// operator*() and pair() throw since they would let it be modified.
+    ///
     class iterator : public const_iterator {
     public:
         var& operator*();
@@ -242,6 +364,10 @@ public :
         iterator(vector_type::iterator iter) : const_iterator(iter) {}
         /// initialize from map iterator
         iterator(map_type::iterator iter) : const_iterator(iter) {}
+        /// initialize from persistent vector position
+        iterator(pvector_iterator iter) : const_iterator(iter) {}
+        /// initialize from persistent map position
+        iterator(pmap_iterator iter) : const_iterator(iter) {}
     };
 
     iterator begin();
@@ -255,9 +381,9 @@ public :
     class reverse_iterator {
     public :
         /// initialize from vector reverse iterator
-        reverse_iterator(vector_type::reverse_iterator riter) : _riter(riter) {}
+        reverse_iterator(vector_type::reverse_iterator riter) : _riter(riter.base()) {}
         /// initialize from map reverse iterator
-        reverse_iterator(map_type::reverse_iterator riter) : _riter(riter) {}
+        reverse_iterator(map_type::reverse_iterator riter) : _riter(riter.base()) {}
 
         reverse_iterator operator++();
         reverse_iterator operator++(int);
@@ -270,8 +396,11 @@ public :
 
     private :
         // make sure base_type and the variant list for riter_t always match
+        // riter_t holds the base() of the reverse iterator: a variant of std::reverse_iterator
+        // types cannot be constructed in C++11 and later because their converting constructors
+        // are not constrained.
         enum base_type { type_vector = 0, type_map };
-        typedef boost::variant<vector_type::reverse_iterator, map_type::reverse_iterator> riter_t;
+        typedef boost::variant<vector_type::iterator, map_type::iterator> riter_t;
 
         riter_t _riter;
     };
@@ -282,36 +411,130 @@ public :
 private :
     friend var make_vector();
     friend var make_map();
+    friend var make_vector(std::initializer_list<detail::literal> items);
+    friend var make_map(std::initializer_list<detail::literal> entries);
+    template <typename It>
+    friend typename detail::range_of_items<It>::type make_vector(It first, It last);
+    template <typename It>
+    friend typename detail::range_of_pairs<It>::type make_map(It first, It last);
+    friend var make_persistent_vector();
+    friend var make_persistent_map();
 
     typedef boost::blank null_t;
 
+    /// string characters, allocated from the node's memory resource
+    typedef std::basic_string<char, std::char_traits<char>, detail::payload_allocator<char, payload_string> > string_storage;
+    /// wide string characters, allocated from the node's memory resource
+    typedef std::basic_string<wchar_t, std::char_traits<wchar_t>, detail::payload_allocator<wchar_t, payload_wstring> > wstring_storage;
+
+    ///
+    /// shared string storage
+    ///
+    struct string_node : string_storage, detail::ref_counted, detail::payload_node<payload_string> {
+        string_node() {}
+        string_node(const std::string& s) : string_storage(s.data(), s.size()) {}
+        string_node(const char* s) : string_storage(s) {}
+    };
+
+    ///
+    /// shared wide string storage
+    ///
+    struct wstring_node : wstring_storage, detail::ref_counted, detail::payload_node<payload_wstring> {
+        wstring_node() {}
+        wstring_node(const std::wstring& s) : wstring_storage(s.data(), s.size()) {}
+        wstring_node(const wchar_t* s) : wstring_storage(s) {}
+    };
+
+    friend void intrusive_ptr_add_ref(const string_node* p) { p->add_ref(); }
+    friend void intrusive_ptr_release(const string_node* p) { if (p->release()) detail::destroy(p); }
+    friend void intrusive_ptr_add_ref(const wstring_node* p) { p->add_ref(); }
+    friend void intrusive_ptr_release(const wstring_node* p) { if (p->release()) detail::destroy(p); }
+
     struct string_t {
-        string_t() : ps(boost::make_shared<std::string>()) {}
-        string_t(const std::string& s) : ps(boost::make_shared<std::string>(s)) {}
-        string_t(const char* s) : ps(boost::make_shared<std::string>(s)) {}
+        string_t() : ps(new string_node) {}
+        string_t(const std::string& s) : ps(new string_node(s)) {}
+        string_t(const char* s) : ps(new string_node(s)) {}
 
-        boost::shared_ptr<std::string>  ps;
+        boost::intrusive_ptr<string_node>  ps;
     };
         
     struct wstring_t {
-        wstring_t() : ps(boost::make_shared<std::wstring>()) {}
-        wstring_t(const std::wstring& s) : ps(boost::make_shared<std::wstring>(s)) {}
-        wstring_t(const wchar_t* s) : ps(boost::make_shared<std::wstring>(s)) {}
+        wstring_t() : ps(new wstring_node) {}
+        wstring_t(const std::wstring& s) : ps(new wstring_node(s)) {}
+        wstring_t(const wchar_t* s) : ps(new wstring_node(s)) {}
 
-        boost::shared_ptr<std::wstring>  ps;
+        boost::intrusive_ptr<wstring_node>  ps;
     };
 
     typedef bool bool_t;
     typedef int int_t;
     typedef double double_t;
 
-    typedef boost::shared_ptr<vector_type> vector_ptr;
-    typedef boost::shared_ptr<map_type> map_ptr;
+    ///
+    /// shared vector storage
+    ///
+    struct vector_node : vector_type, detail::ref_counted, detail::payload_node<payload_vector> {
+        vector_node() : frozen(false), unshareable(false) {}
+
+        /// set by freeze(), rejects every later mutation
+        bool frozen;
+        /// set once a var& or iterator into the node has been handed out, see unshare()
+        bool unshareable;
+        /// filled in by fingerprint_of() once frozen
+        detail::fingerprint_memo memo;
+    };
+
+    ///
+    /// shared map storage
+    ///
+    struct map_node : map_type, detail::ref_counted, detail::payload_node<payload_map> {
+        map_node() : frozen(false), unshareable(false) {}
+
+        /// set by freeze(), rejects every later mutation
+        bool frozen;
+        /// set once a var& or iterator into the node has been handed out, see unshare()
+        bool unshareable;
+        /// filled in by fingerprint_of() once frozen
+        detail::fingerprint_memo memo;
+    };
+
+    friend void intrusive_ptr_add_ref(const vector_node* p) { p->add_ref(); }
+    friend void intrusive_ptr_release(const vector_node* p) { if (p->release()) detail::destroy_collection(p); }
+    friend void intrusive_ptr_add_ref(const map_node* p) { p->add_ref(); }
+    friend void intrusive_ptr_release(const map_node* p) { if (p->release()) detail::destroy_collection(p); }
+    // persistent nodes are incomplete here, these are defined in persistent.cpp
+    friend void intrusive_ptr_add_ref(const pvector_node* p);
+    friend void intrusive_ptr_release(const pvector_node* p);
+    friend void intrusive_ptr_add_ref(const pmap_node* p);
+    friend void intrusive_ptr_release(const pmap_node* p);
+
+    typedef boost::intrusive_ptr<vector_node> vector_ptr;
+    typedef boost::intrusive_ptr<map_node> map_ptr;
+    typedef boost::intrusive_ptr<pvector_node> pvector_ptr;
+    typedef boost::intrusive_ptr<pmap_node> pmap_ptr;
 
     var(vector_ptr _vector);
     var(map_ptr _map);
+    var(pvector_ptr _vector);
+    var(pmap_ptr _map);
 
-    typedef boost::variant<null_t, bool_t, int_t, double_t, string_t, wstring_t, vector_ptr, map_ptr> var_t;
+    ///
+    /// elements [offset, offset + length) of a vector, sharing its node
+    ///
+    struct slice_t {
+        vector_ptr parent;
+        size_type offset;
+        size_type length;
+    };
+
+    void detach();
+    void unshare();
+    void lend();
+    bool lent() const;
+    vector_node& vector_for_update(const char* invalid, const char* frozen);
+    map_node& map_for_update(const char* invalid, const char* frozen);
+
+    typedef boost::variant<null_t, bool_t, int_t, double_t, string_t, wstring_t, vector_ptr, map_ptr, pvector_ptr, pmap_ptr, slice_t> var_t;
 
     var_t _var;
 
@@ -322,6 +545,24 @@ private :
     struct append_value_visitor;
     struct append_key_value_visitor;
     struct equal_visitor;
+    struct compare_visitor;
+    struct freeze_visitor;
+    struct detach_visitor;
+    struct clone_frame;
+    static void clone_into(clone_frame& parent, const var& item, bool is_key);
+    struct memory_usage_visitor;
+    struct fingerprint_visitor;
+    struct fingerprint_memo_visitor;
+    struct dedupe_pass;
+
+    friend std::size_t hash_value(const var& v);
+    friend fingerprint fingerprint_of(const var& v);
+    friend dedupe_report dedupe(var& v);
+    friend class member_cursor;
+    friend class path;
+    friend memory_report memory_usage(const var& v);
+    friend column_table to_columnar(const var& records);
+    friend struct detail::convert_access;
 };
 
 ///
@@ -329,15 +570,79 @@ private :
 ///
 extern const var none;
 
+///
+/// hash a var, for use with boost::hash
+///
+/// Keys that are equivalent under var::less_var hash to the same value. Collections hash
+/// by content, like hash().
+///
+std::size_t hash_value(const var& v);
+
+///
+/// hash a var consistently with operator ==, for unordered containers
+///
+/// Unlike hash_value(), which boost::hash has to agree with, every var hashes through
+/// its fingerprint.
+///
+std::size_t hash(const var& v);
+
+///
+/// 128-bit digest of the content of a var
+///
+/// Equal vars have equal fingerprints, and the digest does not depend on the process, so
+/// it can key caches and find duplicates across runs on the same platform. The fingerprint
+/// of a frozen collection is kept in its node, so fingerprinting a tree that shares frozen
+/// subtrees with one fingerprinted before only walks what changed.
+///
+fingerprint fingerprint_of(const var& v);
+
+///
+/// outcome of dedupe()
+///
+struct dedupe_report {
+    dedupe_report() : shared(0), bytes_before(0), bytes_after(0) {}
+
+    /// @return bytes of payload the tree no longer holds
+    std::size_t bytes_saved() const { return bytes_before - bytes_after; }
+
+    /// number of collections and strings replaced by an equal instance found earlier
+    std::size_t shared;
+    /// memory_usage() of the tree before the pass
+    std::size_t bytes_before;
+    /// memory_usage() of the tree after the pass
+    std::size_t bytes_after;
+};
+
+///
+/// make equal subtrees and strings of a var tree share one instance
+///
+/// Every collection and string is fingerprinted, bottom up, and replaced by the first equal
+/// one found, so the tree becomes a DAG. Copy-on-write keeps this invisible: modifying a
+/// shared subtree through one path copies it first. Map keys are shared too.
+///
+/// Members of the tree's collections are rewritten in place with equal values, so the tree
+/// must not be read by other threads during the pass. Frozen and persistent collections
+/// are shared as a whole but their members are left alone; dedupe a tree before freezing it.
+///
+dedupe_report dedupe(var& v);
+
+///
+/// walk a var tree and report the bytes it holds by payload kind
+///
+/// A node shared by several vars in the tree is counted once. Sizes of map tree nodes
+/// and string buffers are estimates based on the standard library's layout.
+///
+memory_report memory_usage(const var& v);
+
 /// ostream << var
 inline std::ostream& operator << (std::ostream& os, const var& v) { return v._write_var(os); }
 /// wostream << var
 inline std::wostream& operator << (std::wostream& os, const var& v) { return v._write_var(os); }
 
 /// create empty vector
-inline var make_vector() { return var(boost::make_shared<var::vector_type>()); }
+inline var make_vector() { return var(var::vector_ptr(new var::vector_node)); }
 /// create empty map
-inline var make_map() { return var(boost::make_shared<var::map_type>()); }
+inline var make_map() { return var(var::map_ptr(new var::map_node)); }
 
 /// create vector with one item
 inline var make_vector(const var& v) { return dynamic::make_vector()(v); }
@@ -346,6 +651,84 @@ inline var make_map(const var& k) { return dynamic::make_map()(k); }
 /// create map with one item (a key,value pair)
 inline var make_map(const var& k, const var& v) { return dynamic::make_map()(k, v); }
 
+namespace detail {
+
+///
+/// item of a var literal: a value, or a nested braced list
+///
+/// Nested lists are kept as they are until the var is built, so a { "key", value }
+/// entry of a map literal never becomes a vector of its own.
+///
+class literal {
+public :
+    template <typename T, typename = typename std::enable_if<std::is_constructible<var, const T&>::value>::type>
+    literal(const T& value) : _value(value), _is_list(false) {}
+    literal(std::initializer_list<literal> items) : _items(items), _is_list(true) {}
+
+    bool is_list() const { return _is_list; }
+    const var& value() const { return _value; }
+    const std::initializer_list<literal>& items() const { return _items; }
+    /// @return true if this is a { "key", value } map entry
+    bool is_entry() const { return _is_list && _items.size() == 2 && !_items.begin()->_is_list && _items.begin()->_value.is_string_type(); }
+    /// @return the var this item stands for
+    var to_var() const { return _is_list ? var(_items) : _value; }
+
+private :
+    var _value;
+    std::initializer_list<literal> _items;
+    bool _is_list;
+};
+
+}
+
+var make_vector(std::initializer_list<detail::literal> items);
+var make_map(std::initializer_list<detail::literal> entries);
+
+///
+/// create vector holding the items of [first, last)
+///
+/// The vector is sized once when the distance can be taken without consuming the range.
+///
+template <typename It>
+typename detail::range_of_items<It>::type make_vector(It first, It last) {
+    var::vector_ptr items(new var::vector_node);
+    if (std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<It>::iterator_category>::value)
+        items->reserve(std::distance(first, last));
+    for (; first != last; ++first)
+        items->emplace_back(*first);
+    return var(items);
+}
+
+///
+/// create map holding the key, value pairs of [first, last)
+///
+/// Each entry is inserted with the end of the map as a hint, so sorted input such as a
+/// std::map costs constant time per entry. As with operator (), the first of several
+/// equal keys wins.
+///
+template <typename It>
+typename detail::range_of_pairs<It>::type make_map(It first, It last) {
+    var::map_ptr entries(new var::map_node);
+    for (; first != last; ++first)
+        entries->emplace_hint(entries->end(), first->first, first->second);
+    return var(entries);
+}
+
+var make_persistent_vector();
+var make_persistent_map();
+
+}
+
+namespace std {
+
+///
+/// std::hash for var, consistent with operator ==
+///
+template <>
+struct hash<dynamic::var> {
+    std::size_t operator () (const dynamic::var& v) const { return dynamic::hash(v); }
+};
+
 }
 
 #endif /* DYNAMIC_VAR_HPP */
@@ -0,0 +1,316 @@
+#ifndef DYNAMIC_VIEW_HPP
+#define DYNAMIC_VIEW_HPP
+
+/*
+    Copyright (C) 2009, Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstddef>
+#include <iterator>
+#include <ostream>
+
+#include <boost/optional.hpp>
+
+#include <dynamic/var.hpp>
+
+namespace dynamic {
+
+///
+/// @file
+///
+/// Lazy views over var collections. A view is a description of a sequence of vars: the
+/// elements, keys or values of a collection, passed through filter(), transform(), take()
+/// and drop(). Nothing is copied or allocated until the view is iterated, written to a
+/// stream or materialized with to_var().
+///
+/// \code
+/// std::cout << values(prices).filter([](const var& p) { return double(p) > 10; })
+///                            .transform([](const var& p) { return double(p) * 1.2; })
+///                            .take(100);
+/// \endcode
+///
+/// A view refers to the collection it was made from and to the views it adapts, which
+/// must outlive it. Each step runs once per element as the view is iterated, and again on
+/// every new iteration.
+///
+
+template <typename Cursor> class view_iterator;
+template <typename Base, typename Predicate> class filter_view;
+template <typename Base, typename Function> class transform_view;
+template <typename Base> class take_view;
+template <typename Base> class drop_view;
+
+///
+/// adaptors and iteration shared by every view
+///
+/// Derived provides cursor_type and cursor(). A cursor is positioned on its first var when
+/// made, and offers done(), get() and advance().
+///
+template <typename Derived>
+class view_adaptors {
+public :
+    /// @return view of the vars for which predicate(v) is true
+    template <typename Predicate>
+    filter_view<Derived, Predicate> filter(Predicate predicate) const { return filter_view<Derived, Predicate>(derived(), predicate); }
+    /// @return view of function(v) for every var v
+    template <typename Function>
+    transform_view<Derived, Function> transform(Function function) const { return transform_view<Derived, Function>(derived(), function); }
+    /// @return view of the first n vars
+    take_view<Derived> take(var::size_type n) const { return take_view<Derived>(derived(), n); }
+    /// @return view of every var after the first n
+    drop_view<Derived> drop(var::size_type n) const { return drop_view<Derived>(derived(), n); }
+
+    // auto, as Derived is incomplete where this base is instantiated
+    auto begin() const { return view_iterator<typename Derived::cursor_type>(derived().cursor()); }
+    auto end() const { return view_iterator<typename Derived::cursor_type>(); }
+
+    /// @return true if the view has no vars
+    bool empty() const { return derived().cursor().done(); }
+
+    /// @return number of vars in the view, found by iterating it
+    var::size_type count() const {
+        var::size_type n = 0;
+        for (typename Derived::cursor_type c = derived().cursor(); !c.done(); c.advance()) ++n;
+        return n;
+    }
+
+    /// @return a vector of the vars in the view
+    var to_var() const {
+        var result = make_vector();
+        for (typename Derived::cursor_type c = derived().cursor(); !c.done(); c.advance()) result(c.get());
+        return result;
+    }
+
+private :
+    const Derived& derived() const { return static_cast<const Derived&>(*this); }
+};
+
+///
+/// forward iterator over a view
+///
+/// A default-constructed view_iterator is the end of every view.
+///
+template <typename Cursor>
+class view_iterator {
+public :
+    typedef std::forward_iterator_tag iterator_category;
+    typedef var value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const var* pointer;
+    typedef const var& reference;
+
+    view_iterator() {}
+    explicit view_iterator(const Cursor& cursor) : _cursor(cursor) {}
+
+    const var& operator * () const { return _cursor->get(); }
+    const var* operator -> () const { return &_cursor->get(); }
+    view_iterator& operator ++ () { _cursor->advance(); return *this; }
+    view_iterator operator ++ (int) { view_iterator before(*this); _cursor->advance(); return before; }
+
+    /// iterators are equal when both are at the end, or both are on the same var
+    bool operator == (const view_iterator& other) const {
+        if (done() || other.done()) return done() == other.done();
+        return &**this == &*other;
+    }
+    bool operator != (const view_iterator& other) const { return !(*this == other); }
+
+private :
+    bool done() const { return !_cursor || _cursor->done(); }
+
+    boost::optional<Cursor> _cursor;
+};
+
+///
+/// view of the elements, keys or values of a collection
+///
+class collection_view : public view_adaptors<collection_view> {
+public :
+    /// members of a map to visit
+    enum part_t { elements, keys, values };
+
+    class cursor_type {
+    public :
+        cursor_type(const var& collection, part_t part) : _it(collection.begin()), _end(collection.end()), _part(part) {}
+        bool done() const { return _it == _end; }
+        const var& get() const { return _part == values ? _it.pair().second : *_it; }
+        void advance() { ++_it; }
+
+    private :
+        var::const_iterator _it;
+        var::const_iterator _end;
+        part_t _part;
+    };
+
+    collection_view(const var& collection, part_t part) : _collection(&collection), _part(part) {}
+    cursor_type cursor() const { return cursor_type(*_collection, _part); }
+
+private :
+    const var* _collection;
+    part_t _part;
+};
+
+///
+/// @return view of the elements of a vector, or the keys of a map
+///
+inline collection_view view(const var& collection) { return collection_view(collection, collection_view::elements); }
+/// @return view of the keys of a map
+inline collection_view keys(const var& map) { return collection_view(map, collection_view::keys); }
+/// @return view of the values of a map
+inline collection_view values(const var& map) { return collection_view(map, collection_view::values); }
+
+///
+/// view of the vars of Base that satisfy Predicate
+///
+template <typename Base, typename Predicate>
+class filter_view : public view_adaptors<filter_view<Base, Predicate> > {
+public :
+    class cursor_type {
+    public :
+        cursor_type(const typename Base::cursor_type& base, const Predicate* predicate) : _base(base), _predicate(predicate) { skip(); }
+        bool done() const { return _base.done(); }
+        const var& get() const { return _base.get(); }
+        void advance() { _base.advance(); skip(); }
+
+    private :
+        void skip() { while (!_base.done() && !(*_predicate)(_base.get())) _base.advance(); }
+
+        typename Base::cursor_type _base;
+        const Predicate* _predicate;
+    };
+
+    filter_view(const Base& base, Predicate predicate) : _base(base), _predicate(predicate) {}
+    cursor_type cursor() const { return cursor_type(_base.cursor(), &_predicate); }
+
+private :
+    Base _base;
+    Predicate _predicate;
+};
+
+///
+/// view of Function applied to every var of Base
+///
+/// The result for the current var is computed when it is first read and kept until the
+/// cursor advances.
+///
+template <typename Base, typename Function>
+class transform_view : public view_adaptors<transform_view<Base, Function> > {
+public :
+    class cursor_type {
+    public :
+        cursor_type(const typename Base::cursor_type& base, const Function* function) : _base(base), _function(function), _ready(false) {}
+        bool done() const { return _base.done(); }
+        const var& get() const {
+            if (!_ready) {
+                _value = (*_function)(_base.get());
+                _ready = true;
+            }
+            return _value;
+        }
+        void advance() { _base.advance(); _ready = false; }
+
+    private :
+        typename Base::cursor_type _base;
+        const Function* _function;
+        mutable var _value;
+        mutable bool _ready;
+    };
+
+    transform_view(const Base& base, Function function) : _base(base), _function(function) {}
+    cursor_type cursor() const { return cursor_type(_base.cursor(), &_function); }
+
+private :
+    Base _base;
+    Function _function;
+};
+
+///
+/// view of the first vars of Base
+///
+template <typename Base>
+class take_view : public view_adaptors<take_view<Base> > {
+public :
+    class cursor_type {
+    public :
+        cursor_type(const typename Base::cursor_type& base, var::size_type left) : _base(base), _left(left) {}
+        bool done() const { return _left == 0 || _base.done(); }
+        const var& get() const { return _base.get(); }
+        void advance() { if (--_left) _base.advance(); }
+
+    private :
+        typename Base::cursor_type _base;
+        var::size_type _left;
+    };
+
+    take_view(const Base& base, var::size_type n) : _base(base), _n(n) {}
+    cursor_type cursor() const { return cursor_type(_base.cursor(), _n); }
+
+private :
+    Base _base;
+    var::size_type _n;
+};
+
+///
+/// view of Base without its first vars
+///
+template <typename Base>
+class drop_view : public view_adaptors<drop_view<Base> > {
+public :
+    typedef typename Base::cursor_type cursor_type;
+
+    drop_view(const Base& base, var::size_type n) : _base(base), _n(n) {}
+    cursor_type cursor() const {
+        cursor_type c = _base.cursor();
+        for (var::size_type i = 0; i < _n && !c.done(); ++i) c.advance();
+        return c;
+    }
+
+private :
+    Base _base;
+    var::size_type _n;
+};
+
+///
+/// write the vars of a view as a vector, one at a time
+///
+template <typename Stream, typename Derived>
+Stream& write_view(Stream& os, const view_adaptors<Derived>& view) {
+    // the layout of var::_write_collection for vectors
+    os << "[ ";
+    bool first = true;
+    for (typename Derived::cursor_type c = static_cast<const Derived&>(view).cursor(); !c.done(); c.advance()) {
+        if (!first) os << ", ";
+        os << c.get();
+        first = false;
+    }
+    return os << " ]";
+}
+
+template <typename Derived>
+std::ostream& operator << (std::ostream& os, const view_adaptors<Derived>& view) { return write_view(os, view); }
+template <typename Derived>
+std::wostream& operator << (std::wostream& os, const view_adaptors<Derived>& view) { return write_view(os, view); }
+
+}
+
+#endif // DYNAMIC_VIEW_HPP
@@ -0,0 +1,176 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <vector>
+
+#include <dynamic/allocation.hpp>
+
+namespace dynamic {
+
+namespace detail {
+
+std::atomic<allocation_hook*> current_allocation_hook(0);
+
+}
+
+namespace {
+
+thread_local std::pmr::memory_resource* current_resource = 0;
+
+/// node waiting to be destroyed
+struct pending_node {
+    const void* node;
+    void (*destroy_node)(const void*);
+};
+
+/// nodes queued by the teardown running on this thread, 0 if none is running
+thread_local std::vector<pending_node>* pending_nodes = 0;
+
+}
+
+namespace detail {
+
+///
+/// run destroy_node(node) now, or queue it if a teardown is already running on this thread
+///
+void destroy_iteratively(const void* node, void (*destroy_node)(const void*)) {
+    if (pending_nodes) {
+        try {
+            pending_nodes->push_back(pending_node { node, destroy_node });
+            return;
+        } catch (const std::bad_alloc&) {
+            // fall back to destroying this subtree recursively
+        }
+        destroy_node(node);
+        return;
+    }
+    std::vector<pending_node> nodes;
+    pending_nodes = &nodes;
+    destroy_node(node);
+    while (!nodes.empty()) {
+        const pending_node next = nodes.back();
+        nodes.pop_back();
+        next.destroy_node(next.node);
+    }
+    pending_nodes = 0;
+}
+
+}
+
+///
+/// @return the memory resource var payloads created on this thread are allocated from
+///
+std::pmr::memory_resource* current_memory_resource() { return current_resource; }
+
+///
+/// make resource current on this thread
+///
+memory_resource_scope::memory_resource_scope(std::pmr::memory_resource* resource) : _previous(current_resource) {
+    current_resource = resource;
+}
+
+///
+/// restore the previous resource
+///
+memory_resource_scope::~memory_resource_scope() {
+    current_resource = _previous;
+}
+
+///
+/// install hook for every later payload allocation
+///
+allocation_hook* set_allocation_hook(allocation_hook* hook) {
+    return detail::current_allocation_hook.exchange(hook, std::memory_order_acq_rel);
+}
+
+///
+/// counter forwarding to next, or to the global heap
+///
+allocation_counter::allocation_counter(allocation_hook* next) : _next(next) {
+    reset();
+}
+
+///
+/// count and allocate bytes
+///
+void* allocation_counter::allocate(std::size_t bytes, payload_kind kind) {
+    void* p = _next ? _next->allocate(bytes, kind) : ::operator new(bytes);
+    _counters[kind].allocations.fetch_add(1, std::memory_order_relaxed);
+    _counters[kind].bytes.fetch_add(bytes, std::memory_order_relaxed);
+    return p;
+}
+
+///
+/// count and free p
+///
+void allocation_counter::deallocate(void* p, std::size_t bytes, payload_kind kind) {
+    _counters[kind].frees.fetch_add(1, std::memory_order_relaxed);
+    _counters[kind].bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    if (_next) _next->deallocate(p, bytes, kind);
+    else ::operator delete(p);
+}
+
+///
+/// @return bytes of every kind allocated and not yet freed
+///
+std::size_t allocation_counter::bytes_in_use() const {
+    std::size_t bytes = 0;
+    for (int kind = 0; kind < payload_kind_count; ++kind)
+        bytes += bytes_in_use(payload_kind(kind));
+    return bytes;
+}
+
+///
+/// set every counter to zero
+///
+void allocation_counter::reset() {
+    for (int kind = 0; kind < payload_kind_count; ++kind) {
+        _counters[kind].allocations.store(0, std::memory_order_relaxed);
+        _counters[kind].frees.store(0, std::memory_order_relaxed);
+        _counters[kind].bytes.store(0, std::memory_order_relaxed);
+    }
+}
+
+///
+/// empty report
+///
+memory_report::memory_report() : inline_bytes(0) {
+    for (int kind = 0; kind < payload_kind_count; ++kind) {
+        bytes[kind] = 0;
+        nodes[kind] = 0;
+    }
+}
+
+///
+/// @return sum of every kind of bytes
+///
+std::size_t memory_report::total() const {
+    std::size_t sum = inline_bytes;
+    for (int kind = 0; kind < payload_kind_count; ++kind)
+        sum += bytes[kind];
+    return sum;
+}
+
+}
@@ -23,6 +23,8 @@
     OTHER DEALINGS IN THE SOFTWARE.
 */
 
+#include <utility>
+
 #include <dynamic/var.hpp>
 
 namespace dynamic {
@@ -83,10 +85,27 @@ var& var::operator = (const wchar_t* s) {
 }
 
 ///
-/// assign var to var
+/// assign var to var, copying the nodes that references were handed out into
 ///
 var& var::operator = (const var& v) {
-    _var = v._var;
+    // assigning a var to itself keeps its nodes, and the references handed out into them
+    if (this != &v) {
+        _var = v._var;
+        if (_var.which() >= type_vector) unshare();
+    }
+    return *this;
+}
+
+///
+/// move var to var, leaving v null
+///
+var& var::operator = (var&& v) {
+    if (this != &v) {
+        // v may live inside the value being replaced
+        var_t moved(std::move(v._var));
+        v._var = null_t();
+        _var = std::move(moved);
+    }
     return *this;
 }
 
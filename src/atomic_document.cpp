@@ -0,0 +1,209 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <limits>
+
+#include <dynamic/atomic_document.hpp>
+
+namespace dynamic {
+
+namespace {
+
+///
+/// a reader thread's announcement of the epoch it entered in, 0 while it holds no snapshot
+///
+/// Slots are never freed: a thread releases its slot when it exits and the next new
+/// reader thread reuses it.
+///
+struct reader_slot {
+    reader_slot() : epoch(0), in_use(true), next(0), depth(0) {}
+
+    std::atomic<unsigned long long> epoch;
+    std::atomic<bool> in_use;
+    reader_slot* next;
+    /// snapshot nesting, only touched by the owning thread
+    unsigned depth;
+};
+
+std::atomic<unsigned long long> global_epoch(1);
+std::atomic<reader_slot*> reader_slots(0);
+
+///
+/// @return a free slot, claimed without locking
+///
+reader_slot* claim_slot() {
+    for (reader_slot* s = reader_slots.load(); s; s = s->next) {
+        bool expected = false;
+        if (!s->in_use.load(std::memory_order_relaxed) && s->in_use.compare_exchange_strong(expected, true))
+            return s;
+    }
+    reader_slot* s = new reader_slot;
+    reader_slot* head = reader_slots.load();
+    do {
+        s->next = head;
+    } while (!reader_slots.compare_exchange_weak(head, s));
+    return s;
+}
+
+///
+/// owns the calling thread's slot
+///
+struct thread_slot {
+    thread_slot() : slot(0) {}
+    ~thread_slot() { if (slot) slot->in_use.store(false); }
+
+    reader_slot* get() { return slot ? slot : (slot = claim_slot()); }
+
+    reader_slot* slot;
+};
+
+thread_local thread_slot this_thread_slot;
+
+///
+/// @return the oldest epoch announced by a reader holding a snapshot
+///
+unsigned long long oldest_reader_epoch() {
+    unsigned long long oldest = std::numeric_limits<unsigned long long>::max();
+    for (reader_slot* s = reader_slots.load(); s; s = s->next) {
+        unsigned long long e = s->epoch.load();
+        if (e != 0 && e < oldest) oldest = e;
+    }
+    return oldest;
+}
+
+}
+
+///
+/// leave the reader's epoch
+///
+atomic_document::snapshot::~snapshot() {
+    if (!_version) return;
+    reader_slot* slot = this_thread_slot.get();
+    if (--slot->depth == 0) slot->epoch.store(0, std::memory_order_release);
+}
+
+///
+/// @return the root of the pinned version
+///
+const var& atomic_document::snapshot::root() const {
+    return _version->root;
+}
+
+///
+/// ctor: publish the initial root
+///
+atomic_document::atomic_document(const var& root) : _current(new version(root)) {}
+
+///
+/// dtor: no snapshot may outlive the document
+///
+atomic_document::~atomic_document() {
+    delete _current.load();
+    for (std::vector<version*>::iterator it = _retired.begin(); it != _retired.end(); ++it)
+        delete *it;
+}
+
+///
+/// @return snapshot of the current version
+///
+/// Wait-free apart from the first call on each thread, which claims a reader slot.
+///
+atomic_document::snapshot atomic_document::read() const {
+    reader_slot* slot = this_thread_slot.get();
+    // nested snapshots are covered by the outermost one's epoch
+    if (slot->depth++ == 0) slot->epoch.store(global_epoch.load());
+    return snapshot(_current.load());
+}
+
+///
+/// @return the current root, which stays valid after the next publish()
+///
+var atomic_document::load() const {
+    return read().root();
+}
+
+///
+/// make a frozen copy of root the current version
+///
+/// Readers see either the previous or the new version, never a mix. Versions that
+/// no reader can see any more are freed before returning. The nodes root shares with
+/// the caller are copied before they are frozen, so the caller's vars stay mutable and
+/// never write into what readers see; moving root in avoids the copy.
+///
+void atomic_document::publish(const var& root) {
+    publish(new version(root));
+}
+
+///
+/// freeze root in place and make it the current version
+///
+void atomic_document::publish(var&& root) {
+    publish(new version(std::move(root)));
+}
+
+void atomic_document::publish(version* next) {
+    std::lock_guard<std::mutex> guard(_writer);
+    version* previous = _current.exchange(next);
+    // any reader that can still see previous announced an epoch no later than this one
+    previous->epoch = global_epoch.fetch_add(1);
+    _retired.push_back(previous);
+    reclaim_locked();
+}
+
+///
+/// free the replaced versions no reader can see any more
+///
+/// @return number of versions freed
+///
+std::size_t atomic_document::reclaim() {
+    std::lock_guard<std::mutex> guard(_writer);
+    return reclaim_locked();
+}
+
+std::size_t atomic_document::reclaim_locked() {
+    const unsigned long long oldest = oldest_reader_epoch();
+    std::size_t freed = 0;
+    std::vector<version*>::iterator keep = _retired.begin();
+    for (std::vector<version*>::iterator it = _retired.begin(); it != _retired.end(); ++it) {
+        if ((*it)->epoch < oldest) {
+            delete *it;
+            ++freed;
+        } else {
+            *keep++ = *it;
+        }
+    }
+    _retired.erase(keep, _retired.end());
+    return freed;
+}
+
+///
+/// @return number of replaced versions still waiting for readers to leave
+///
+std::size_t atomic_document::retired() const {
+    std::lock_guard<std::mutex> guard(_writer);
+    return _retired.size();
+}
+
+}
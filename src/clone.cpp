@@ -0,0 +1,315 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include <dynamic/exception.hpp>
+#include <dynamic/traverse.hpp>
+#include <dynamic/var.hpp>
+
+#include "persistent.hpp"
+
+namespace dynamic {
+
+///
+/// copy a shared collection so it can be modified without affecting other vars
+///
+struct var::detach_visitor : public boost::static_visitor<void>
+{
+    template <typename T>
+    result_type operator () (T&) const {}
+    // a frozen node stays shared: the modification that follows rejects it anyway, and
+    // copying it first would cost a whole node and leave this var with a private copy
+    result_type operator () (vector_ptr& ptr) const
+    {
+        if (!ptr->unique() && !ptr->frozen) ptr = new vector_node(*ptr);
+    }
+    result_type operator () (map_ptr& ptr) const
+    {
+        if (!ptr->unique() && !ptr->frozen) ptr = new map_node(*ptr);
+    }
+    // a persistent collection only copies its root here, its nodes are copied as they are modified
+    result_type operator () (pvector_ptr& ptr) const
+    {
+        if (!ptr->unique() && !ptr->frozen) ptr = new pvector_node(*ptr);
+    }
+    result_type operator () (pmap_ptr& ptr) const
+    {
+        if (!ptr->unique() && !ptr->frozen) ptr = new pmap_node(*ptr);
+    }
+};
+
+///
+/// copy-on-write: called before every modification of a collection
+///
+/// The copy is shallow. Its items still share their own storage, which is copied in
+/// turn if it is modified through this var, so only the modified path is ever copied.
+/// A slice becomes a vector of its own holding the elements it covers. A frozen
+/// collection is never copied, so a rejected modification leaves the sharing intact.
+///
+void var::detach() {
+    if (type() == type_slice) {
+        const slice_t& s = boost::get<slice_t>(_var);
+        const vector_type::const_iterator first = s.parent->begin() + s.offset;
+        vector_ptr items(new vector_node);
+        items->assign(first, first + s.length);
+        _var = items;
+        return;
+    }
+    boost::apply_visitor(detach_visitor(), _var);
+}
+
+///
+/// remember that a var& or iterator into this vector or map has been handed out
+///
+/// The reference outlives later copies of this var, which would see writes through it
+/// if they shared the node, so unshare() gives them a copy instead. Persistent
+/// collections mark the path to the item in update().
+///
+void var::lend() {
+    switch (type()) {
+    case type_vector :  boost::get<vector_ptr>(_var)->unshareable = true; break;
+    case type_map :     boost::get<map_ptr>(_var)->unshareable = true; break;
+    default :           break;
+    }
+}
+
+///
+/// @return true if lend() or update() marked the collection at the top of this var
+///
+bool var::lent() const {
+    switch (type()) {
+    case type_vector :  return boost::get<vector_ptr>(_var)->unshareable;
+    case type_map :     return boost::get<map_ptr>(_var)->unshareable;
+    case type_persistent_vector :   return boost::get<pvector_ptr>(_var)->unshareable;
+    case type_persistent_map :      return boost::get<pmap_ptr>(_var)->unshareable;
+    default :           return false;
+    }
+}
+
+///
+/// copy-on-write for a var just copied from another: copy the nodes lend() marked
+///
+/// The copies are shallow and unmarked. Their members share storage in turn, except for
+/// marked nodes, which are copied the same way; for a persistent collection that is the
+/// marked path to each item handed out. The walk uses an explicit stack, as references
+/// can be handed out arbitrarily deep.
+///
+void var::unshare() {
+    // most copies share every node, so the walk only starts at a marked one
+    if (!lent()) return;
+    std::vector<var*> pending(1, this);
+    while (!pending.empty()) {
+        var& v = *pending.back();
+        pending.pop_back();
+        switch (v.type()) {
+        case type_vector : {
+            vector_ptr& ptr = boost::get<vector_ptr>(v._var);
+            if (!ptr->unshareable) break;
+            vector_ptr copy(new vector_node);
+            copy->resize(ptr->size());
+            for (size_type i = 0; i < ptr->size(); ++i) {
+                (*copy)[i]._var = (*ptr)[i]._var;
+                pending.push_back(&(*copy)[i]);
+            }
+            copy->frozen = ptr->frozen;
+            ptr = copy;
+            break;
+        }
+        case type_map : {
+            map_ptr& ptr = boost::get<map_ptr>(v._var);
+            if (!ptr->unshareable) break;
+            map_ptr copy(new map_node);
+            for (map_type::const_iterator it = ptr->begin(); it != ptr->end(); ++it) {
+                var& value = copy->emplace_hint(copy->end(), it->first, none)->second;
+                value._var = it->second._var;
+                pending.push_back(&value);
+            }
+            copy->frozen = ptr->frozen;
+            ptr = copy;
+            break;
+        }
+        case type_persistent_vector : {
+            pvector_ptr& ptr = boost::get<pvector_ptr>(v._var);
+            if (!ptr->unshareable) break;
+            ptr = new pvector_node(*ptr);
+            ptr->unshareable = false;
+            std::vector<pvector_node::node_ptr*> path;
+            path.push_back(&ptr->root);
+            path.push_back(&ptr->tail);
+            while (!path.empty()) {
+                pvector_node::node_ptr& n = *path.back();
+                path.pop_back();
+                if (!n->unshareable) continue;
+                pvector_node::node_ptr copy(new pvector_node::node);
+                copy->children = n->children;
+                copy->items.resize(n->items.size());
+                for (size_type i = 0; i < n->items.size(); ++i) {
+                    copy->items[i]._var = n->items[i]._var;
+                    pending.push_back(&copy->items[i]);
+                }
+                n = copy;
+                for (size_type i = 0; i < n->children.size(); ++i)
+                    path.push_back(&n->children[i]);
+            }
+            break;
+        }
+        case type_persistent_map : {
+            pmap_ptr& ptr = boost::get<pmap_ptr>(v._var);
+            if (!ptr->unshareable) break;
+            ptr = new pmap_node(*ptr);
+            ptr->unshareable = false;
+            std::vector<pmap_node::node_ptr*> path(1, &ptr->root);
+            while (!path.empty()) {
+                pmap_node::node_ptr& n = *path.back();
+                path.pop_back();
+                if (!n->unshareable) continue;
+                pmap_node::node_ptr copy(new hamt_node);
+                copy->datamap = n->datamap;
+                copy->nodemap = n->nodemap;
+                copy->count = n->count;
+                copy->children = n->children;
+                copy->entries.reserve(n->entries.size());
+                for (size_type i = 0; i < n->entries.size(); ++i) {
+                    copy->entries.push_back(pair_type(n->entries[i].first, none));
+                    copy->entries.back().second._var = n->entries[i].second._var;
+                }
+                for (size_type i = 0; i < copy->entries.size(); ++i)
+                    pending.push_back(&copy->entries[i].second);
+                n = copy;
+                for (size_type i = 0; i < n->children.size(); ++i)
+                    path.push_back(&n->children[i]);
+            }
+            break;
+        }
+        default :
+            break;
+        }
+    }
+}
+
+///
+/// @return slice of up to length elements of a vector or slice, starting at offset
+///
+/// The slice shares the vector's node instead of copying the elements, and reads like a
+/// vector: count(), const operator [] and iteration. The first modification through the
+/// slice copies the elements it covers into a vector of its own. Modifying the vector
+/// after taking a slice copies the vector, as for any other var sharing it, so the slice
+/// keeps the elements it was taken from.
+///
+var var::slice(size_type offset, size_type length) const {
+    slice_t s;
+    if (type() == type_vector) {
+        // a var& handed out into the vector could write into the slice, which gets a copy
+        s.parent = boost::get<vector_ptr>(_var);
+        if (s.parent->unshareable) {
+            var copy(*this);
+            s.parent = boost::get<vector_ptr>(copy._var);
+        }
+        s.offset = 0;
+        s.length = s.parent->size();
+    }
+    else if (type() == type_slice) {
+        s = boost::get<slice_t>(_var);
+    }
+    else {
+        throw exception("slice() needs a vector or slice");
+    }
+    if (offset > s.length) throw exception("slice() offset out of range");
+    s.offset += offset;
+    s.length = std::min(length, s.length - offset);
+    var result;
+    result._var = s;
+    return result;
+}
+
+///
+/// collection being rebuilt by deep_clone()
+///
+struct var::clone_frame {
+    var collection;
+    /// key of the map entry whose value is being cloned
+    var key;
+};
+
+///
+/// add a finished clone to the collection being rebuilt
+///
+void var::clone_into(clone_frame& parent, const var& item, bool is_key) {
+    switch (parent.collection.type()) {
+    case type_vector :  boost::get<vector_ptr>(parent.collection._var)->push_back(item); break;
+    case type_persistent_vector :   boost::get<pvector_ptr>(parent.collection._var)->push_back(item); break;
+    case type_map : {
+        if (is_key) { parent.key = item; break; }
+        map_type& items = *boost::get<map_ptr>(parent.collection._var);
+        items.insert(items.end(), pair_type(parent.key, item));
+        break;
+    }
+    case type_persistent_map :
+        if (is_key) parent.key = item;
+        else boost::get<pmap_ptr>(parent.collection._var)->insert(parent.key, item);
+        break;
+    default : assert(false);
+    }
+}
+
+///
+/// @return copy of a var that shares no collection with it
+///
+/// Strings are immutable and stay shared. The copy is never frozen, and slices become
+/// vectors.
+///
+var var::deep_clone() const {
+    std::vector<clone_frame> stack;
+    var result;
+    for (tree_walker w(*this); w.next(); ) {
+        if (w.event() == tree_walker::enter) {
+            clone_frame frame;
+            switch (w.node().type()) {
+            case type_vector :
+            case type_slice :   frame.collection = make_vector(); break;
+            case type_map :     frame.collection = make_map(); break;
+            case type_persistent_vector :   frame.collection = make_persistent_vector(); break;
+            case type_persistent_map :      frame.collection = make_persistent_map(); break;
+            default : assert(false);
+            }
+            stack.push_back(frame);
+            continue;
+        }
+        var item;
+        if (w.event() == tree_walker::leave) {
+            item = stack.back().collection;
+            stack.pop_back();
+        }
+        else item = w.node();
+        if (stack.empty()) result = item;
+        else clone_into(stack.back(), item, w.role() == tree_walker::key);
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,459 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <dynamic/columnar.hpp>
+#include <dynamic/exception.hpp>
+
+namespace dynamic {
+
+namespace {
+
+#ifdef __GNUC__
+unsigned lowest_bit(std::uint64_t bits) { return __builtin_ctzll(bits); }
+std::size_t popcount(std::uint64_t bits) { return __builtin_popcountll(bits); }
+#else
+unsigned lowest_bit(std::uint64_t bits) { unsigned i = 0; while (!((bits >> i) & 1)) ++i; return i; }
+std::size_t popcount(std::uint64_t bits) { std::size_t n = 0; for (; bits; bits &= bits - 1) ++n; return n; }
+#endif
+
+std::size_t words(var::size_type rows) { return (rows + 63) / 64; }
+
+void set_bit(column::bitmap& bits, var::size_type row) { bits[row / 64] |= std::uint64_t(1) << (row % 64); }
+
+/// number of rows in word w of a bitmap over rows rows
+std::size_t rows_in(std::size_t w, var::size_type rows) { return std::min<var::size_type>(64, rows - w * 64); }
+
+///
+/// set out[w] to the bits of the rows in data for which test holds, masked by valid
+///
+template <typename T, typename Test>
+void scan(const T* data, var::size_type rows, const column::bitmap& valid, column::bitmap& out, Test test) {
+    for (std::size_t w = 0; w < out.size(); ++w) {
+        const T* block = data + w * 64;
+        const std::size_t n = rows_in(w, rows);
+        std::uint64_t bits = 0;
+        for (std::size_t i = 0; i < n; ++i)
+            bits |= std::uint64_t(test(block[i])) << i;
+        out[w] = bits & valid[w];
+    }
+}
+
+///
+/// scan with the comparison op against value
+///
+template <typename T, typename V>
+void compare(const T* data, var::size_type rows, const column::bitmap& valid, column::bitmap& out,
+             column::compare_t op, const V& value) {
+    switch (op) {
+    case column::equal :            scan(data, rows, valid, out, [&value](const T& x) { return x == value; }); break;
+    case column::not_equal :        scan(data, rows, valid, out, [&value](const T& x) { return x != value; }); break;
+    case column::less :             scan(data, rows, valid, out, [&value](const T& x) { return x < value; }); break;
+    case column::less_equal :       scan(data, rows, valid, out, [&value](const T& x) { return x <= value; }); break;
+    case column::greater :          scan(data, rows, valid, out, [&value](const T& x) { return x > value; }); break;
+    case column::greater_equal :    scan(data, rows, valid, out, [&value](const T& x) { return x >= value; }); break;
+    }
+}
+
+/// @return true if c, the result of var::compare, satisfies op
+bool satisfies(column::compare_t op, int c) {
+    switch (op) {
+    case column::equal :            return c == 0;
+    case column::not_equal :        return c != 0;
+    case column::less :             return c < 0;
+    case column::less_equal :       return c <= 0;
+    case column::greater :          return c > 0;
+    case column::greater_equal :    return c >= 0;
+    }
+    return false;
+}
+
+/// @return the column type for a value, with type_null for null
+column::type_t type_of(const var& v) {
+    switch (v.type()) {
+    case var::type_null :   return column::type_null;
+    case var::type_bool :   return column::type_bool;
+    case var::type_int :    return column::type_int;
+    case var::type_double : return column::type_double;
+    case var::type_string : return column::type_string;
+    default :               return column::type_var;
+    }
+}
+
+}
+
+column::column() : _type(type_null), _size(0) {}
+
+///
+/// @return the value in row, null if there is none
+///
+var column::at(var::size_type row) const {
+    if (!is_valid(row)) return none;
+    switch (_type) {
+    case type_bool :    return var(_bools[row] != 0);
+    case type_int :     return var(_ints[row]);
+    case type_double :
+        if (!_integral.empty() && ((_integral[row / 64] >> (row % 64)) & 1)) return var(int(_doubles[row]));
+        return var(_doubles[row]);
+    case type_string :  return var(std::string(string_at(row)));
+    case type_var :     return _vars[row];
+    default :           return none;
+    }
+}
+
+///
+/// @return the chars of row in a string column
+///
+std::string_view column::string_at(var::size_type row) const {
+    if (_type != type_string) throw exception("not a string column");
+    return std::string_view(_chars.data() + _offsets[row], _offsets[row + 1] - _offsets[row]);
+}
+
+///
+/// @return bitmap of the rows whose value v satisfies v op value
+///
+/// Null rows never match. Rows of a packed column compare with a value of the same type
+/// without building a var; ints and doubles compare by value. Other combinations compare
+/// as var::compare() orders them.
+///
+column::bitmap column::filter(compare_t op, const var& value) const {
+    bitmap out(words(_size));
+    if (_type == type_int && value.is_int()) {
+        compare(_ints.data(), _size, _valid, out, op, int(value));
+    }
+    else if (_type == type_int && value.is_double()) {
+        compare(_ints.data(), _size, _valid, out, op, double(value));
+    }
+    else if (_type == type_double && value.is_numeric()) {
+        compare(_doubles.data(), _size, _valid, out, op, value.is_int() ? int(value) : double(value));
+    }
+    else if (_type == type_bool && value.is_bool()) {
+        compare(_bools.data(), _size, _valid, out, op, std::uint8_t(bool(value)));
+    }
+    else if (_type == type_string && value.is_string()) {
+        const std::string s = value;
+        const std::string_view key(s);
+        for (std::size_t w = 0; w < out.size(); ++w) {
+            std::uint64_t bits = _valid[w];
+            std::uint64_t matched = 0;
+            for (; bits; bits &= bits - 1) {
+                const unsigned i = lowest_bit(bits);
+                const int c = string_at(w * 64 + i).compare(key);
+                matched |= std::uint64_t(satisfies(op, c)) << i;
+            }
+            out[w] = matched;
+        }
+    }
+    else {
+        for (var::size_type row = 0; row < _size; ++row)
+            if (is_valid(row) && satisfies(op, op == equal || op == not_equal ? !(at(row) == value) : var::compare(at(row), value)))
+                set_bit(out, row);
+    }
+    return out;
+}
+
+///
+/// @return rows of word that are valid and, if there is a selection, selected
+///
+std::uint64_t column::selected(std::size_t word, const bitmap* selection) const {
+    return selection ? _valid[word] & (*selection)[word] : _valid[word];
+}
+
+///
+/// @return sum of the selected values of an int, double or bool column
+///
+/// Null rows hold 0, so without a selection the packed array is summed as is.
+///
+double column::sum(const bitmap* selection) const {
+    if (selection && selection->size() != _valid.size()) throw exception("selection does not match the column");
+    double total = 0;
+    switch (_type) {
+    case type_null :
+        return 0;
+    case type_int : {
+        long long n = 0;
+        for (std::size_t w = 0; w < _valid.size(); ++w) {
+            const int* block = _ints.data() + w * 64;
+            const std::uint64_t bits = selection ? (*selection)[w] : ~std::uint64_t(0);
+            for (std::size_t i = 0, end = rows_in(w, _size); i < end; ++i)
+                n += block[i] & -int((bits >> i) & 1);
+        }
+        return double(n);
+    }
+    case type_double :
+        for (std::size_t w = 0; w < _valid.size(); ++w) {
+            const double* block = _doubles.data() + w * 64;
+            const std::uint64_t bits = selection ? (*selection)[w] : ~std::uint64_t(0);
+            for (std::size_t i = 0, end = rows_in(w, _size); i < end; ++i)
+                total += (bits >> i) & 1 ? block[i] : 0.0;
+        }
+        return total;
+    case type_bool :
+        for (std::size_t w = 0; w < _valid.size(); ++w) {
+            std::uint64_t bits = 0;
+            const std::uint8_t* block = _bools.data() + w * 64;
+            for (std::size_t i = 0, end = rows_in(w, _size); i < end; ++i)
+                bits |= std::uint64_t(block[i]) << i;
+            total += popcount(bits & selected(w, selection));
+        }
+        return total;
+    default :
+        throw exception("sum needs an int, double or bool column");
+    }
+}
+
+///
+/// @return least selected value, null if no value other than null is selected
+///
+var column::min(const bitmap* selection) const {
+    return extreme(selection, -1);
+}
+
+///
+/// @return greatest selected value, null if no value other than null is selected
+///
+var column::max(const bitmap* selection) const {
+    return extreme(selection, 1);
+}
+
+///
+/// @return the selected value v for which sign * compare(v, other) > 0 against every other one
+///
+var column::extreme(const bitmap* selection, int sign) const {
+    if (selection && selection->size() != _valid.size()) throw exception("selection does not match the column");
+    var::size_type best = _size;
+    for (std::size_t w = 0; w < _valid.size(); ++w) {
+        for (std::uint64_t bits = selected(w, selection); bits; bits &= bits - 1) {
+            const var::size_type row = w * 64 + lowest_bit(bits);
+            if (best == _size) {
+                best = row;
+                continue;
+            }
+            int c;
+            switch (_type) {
+            case type_bool :    c = int(_bools[row]) - int(_bools[best]); break;
+            case type_int :     c = _ints[row] < _ints[best] ? -1 : _ints[best] < _ints[row]; break;
+            case type_double :  c = _doubles[row] < _doubles[best] ? -1 : _doubles[best] < _doubles[row]; break;
+            case type_string :  c = string_at(row).compare(string_at(best)); break;
+            default :           c = var::compare(_vars[row], _vars[best]); break;
+            }
+            if (c * sign > 0) best = row;
+        }
+    }
+    return best == _size ? none : at(best);
+}
+
+///
+/// @return number of distinct selected values, not counting null
+///
+var::size_type column::count_distinct(const bitmap* selection) const {
+    if (selection && selection->size() != _valid.size()) throw exception("selection does not match the column");
+    switch (_type) {
+    case type_null :
+        return 0;
+    case type_bool : {
+        bool seen[2] = { false, false };
+        for (std::size_t w = 0; w < _valid.size(); ++w)
+            for (std::uint64_t bits = selected(w, selection); bits; bits &= bits - 1)
+                seen[_bools[w * 64 + lowest_bit(bits)]] = true;
+        return seen[0] + seen[1];
+    }
+    case type_int : {
+        std::unordered_set<int> seen;
+        for (std::size_t w = 0; w < _valid.size(); ++w)
+            for (std::uint64_t bits = selected(w, selection); bits; bits &= bits - 1)
+                seen.insert(_ints[w * 64 + lowest_bit(bits)]);
+        return seen.size();
+    }
+    case type_double : {
+        std::unordered_set<double> seen;
+        for (std::size_t w = 0; w < _valid.size(); ++w)
+            for (std::uint64_t bits = selected(w, selection); bits; bits &= bits - 1)
+                seen.insert(_doubles[w * 64 + lowest_bit(bits)]);
+        return seen.size();
+    }
+    case type_string : {
+        std::unordered_set<std::string_view> seen;
+        for (std::size_t w = 0; w < _valid.size(); ++w)
+            for (std::uint64_t bits = selected(w, selection); bits; bits &= bits - 1)
+                seen.insert(string_at(w * 64 + lowest_bit(bits)));
+        return seen.size();
+    }
+    default : {
+        std::unordered_set<var> seen;
+        for (std::size_t w = 0; w < _valid.size(); ++w)
+            for (std::uint64_t bits = selected(w, selection); bits; bits &= bits - 1)
+                seen.insert(_vars[w * 64 + lowest_bit(bits)]);
+        return seen.size();
+    }
+    }
+}
+
+///
+/// @return number of rows in selection
+///
+var::size_type column::count(const bitmap& selection) {
+    var::size_type n = 0;
+    for (std::size_t w = 0; w < selection.size(); ++w)
+        n += popcount(selection[w]);
+    return n;
+}
+
+///
+/// @return the column for field name, or 0 if there is none
+///
+const column* column_table::find(const var& name) const {
+    for (std::vector<column>::const_iterator it = _columns.begin(); it != _columns.end(); ++it)
+        if (it->name() == name) return &*it;
+    return 0;
+}
+
+///
+/// convert a vector of maps to columns
+///
+/// One pass infers the schema, a second fills the columns. Records usually list their
+/// fields in the same order, so each key is first checked against the column at its
+/// position before falling back to a lookup.
+///
+column_table to_columnar(const var& records) {
+    if (!records.is_vector() && !records.is_persistent_vector() && !records.is_slice()) throw exception("to_columnar needs a vector of maps");
+    column_table table;
+    table._rows = records.count();
+    std::unordered_map<var, std::size_t> index;
+    std::vector<var::size_type> present;
+    std::vector<bool> has_ints;
+
+    // the column of key, the field at position in its record
+    auto column_of = [&table, &index](const var& key, std::size_t position) -> std::size_t {
+        if (position < table._columns.size() && table._columns[position]._name == key) return position;
+        std::unordered_map<var, std::size_t>::const_iterator found = index.find(key);
+        if (found != index.end()) return found->second;
+        index.emplace(key, table._columns.size());
+        table._columns.push_back(column());
+        table._columns.back()._name = key;
+        return table._columns.size() - 1;
+    };
+
+    for (var::const_iterator record = records.begin(); record != records.end(); ++record) {
+        if (!(*record).is_map() && !(*record).is_persistent_map()) throw exception("to_columnar needs a vector of maps");
+        std::size_t position = 0;
+        for (var::const_iterator it = (*record).begin(); it != (*record).end(); ++it, ++position) {
+            const std::size_t c = column_of(*it, position);
+            if (c == present.size()) {
+                present.push_back(0);
+                has_ints.push_back(false);
+            }
+            ++present[c];
+            column& col = table._columns[c];
+            const column::type_t type = type_of(it.pair().second);
+            if (type == column::type_int) has_ints[c] = true;
+            if (type == column::type_null || type == col._type) continue;
+            if (col._type == column::type_null)
+                col._type = type;
+            // JSON numbers mix ints and doubles, which are packed as doubles
+            else if ((col._type == column::type_int && type == column::type_double) || (col._type == column::type_double && type == column::type_int))
+                col._type = column::type_double;
+            else
+                col._type = column::type_var;
+        }
+    }
+
+    const var::size_type rows = table._rows;
+    for (std::size_t c = 0; c < table._columns.size(); ++c) {
+        column& col = table._columns[c];
+        col._size = rows;
+        col._valid.assign(words(rows), 0);
+        if (present[c] != rows) col._present.assign(words(rows), 0);
+        if (col._type == column::type_double && has_ints[c]) col._integral.assign(words(rows), 0);
+        switch (col._type) {
+        case column::type_bool :    col._bools.assign(rows, 0); break;
+        case column::type_int :     col._ints.assign(rows, 0); break;
+        case column::type_double :  col._doubles.assign(rows, 0); break;
+        case column::type_string :  col._offsets.assign(rows + 1, 0); break;
+        case column::type_var :     col._vars.resize(rows); break;
+        default :                   break;
+        }
+    }
+
+    var::size_type row = 0;
+    for (var::const_iterator record = records.begin(); record != records.end(); ++record, ++row) {
+        std::size_t position = 0;
+        for (var::const_iterator it = (*record).begin(); it != (*record).end(); ++it, ++position) {
+            column& col = table._columns[column_of(*it, position)];
+            const var& value = it.pair().second;
+            if (!col._present.empty()) set_bit(col._present, row);
+            if (value.is_null()) continue;
+            set_bit(col._valid, row);
+            switch (col._type) {
+            case column::type_bool :    col._bools[row] = boost::get<var::bool_t>(value._var); break;
+            case column::type_int :     col._ints[row] = boost::get<var::int_t>(value._var); break;
+            case column::type_double :
+                if (value.is_int()) {
+                    col._doubles[row] = boost::get<var::int_t>(value._var);
+                    set_bit(col._integral, row);
+                }
+                else {
+                    col._doubles[row] = boost::get<var::double_t>(value._var);
+                }
+                break;
+            case column::type_string : {
+                const var::string_node& s = *boost::get<var::string_t>(value._var).ps;
+                col._chars.append(s.data(), s.size());
+                col._offsets[row + 1] = col._chars.size();
+                break;
+            }
+            default :                   col._vars[row] = value; break;
+            }
+        }
+    }
+
+    // rows without a string end where the row before them does
+    for (std::size_t c = 0; c < table._columns.size(); ++c) {
+        std::vector<var::size_type>& offsets = table._columns[c]._offsets;
+        for (std::size_t i = 1; i < offsets.size(); ++i)
+            offsets[i] = std::max(offsets[i], offsets[i - 1]);
+    }
+    return table;
+}
+
+///
+/// @return vector of maps equal to the records table was made from
+///
+var from_columnar(const column_table& table) {
+    var records = make_vector();
+    const std::vector<column>& columns = table.columns();
+    for (var::size_type row = 0; row < table.rows(); ++row) {
+        var record = make_map();
+        for (std::vector<column>::const_iterator col = columns.begin(); col != columns.end(); ++col)
+            if (col->has(row)) record(col->name(), col->at(row));
+        records(record);
+    }
+    return records;
+}
+
+}
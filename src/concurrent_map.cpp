@@ -0,0 +1,158 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <dynamic/exception.hpp>
+#include <dynamic/concurrent_map.hpp>
+
+namespace dynamic {
+
+///
+/// ctor: the shard count is rounded up to a power of two
+///
+concurrent_map::concurrent_map(size_type shards) {
+    if (shards == 0) throw exception("concurrent_map requires at least one shard");
+    size_type n = 1;
+    while (n < shards) n <<= 1;
+    _shards.reset(new shard[n]);
+    _mask = n - 1;
+}
+
+///
+/// @return shard that owns key
+///
+concurrent_map::shard& concurrent_map::shard_for(const var& key) const {
+    std::size_t h = hash_value(key);
+    // fold the high bits in, boost::hash leaves small ints nearly unchanged
+    h ^= h >> 16;
+    return _shards[h & _mask];
+}
+
+///
+/// insert key,value or replace the value of an existing key
+///
+/// @return true if the key was inserted, false if it was assigned
+///
+bool concurrent_map::insert_or_assign(const var& key, const var& value) {
+    shard& s = shard_for(key);
+    std::lock_guard<std::mutex> guard(s.lock);
+    var::map_type::iterator it = s.map.lower_bound(key);
+    if ((it == s.map.end()) || (s.map.key_comp()(key, it->first))) {
+        s.map.insert(it, var::pair_type(key, value));
+        return true;
+    }
+    it->second = value;
+    return false;
+}
+
+///
+/// look up a key
+///
+/// @return true and copy the value into value if the key exists
+///
+bool concurrent_map::find(const var& key, var& value) const {
+    shard& s = shard_for(key);
+    std::lock_guard<std::mutex> guard(s.lock);
+    var::map_type::const_iterator it = s.map.find(key);
+    if (it == s.map.end()) return false;
+    value = it->second;
+    return true;
+}
+
+///
+/// @return true if the key exists
+///
+bool concurrent_map::contains(const var& key) const {
+    shard& s = shard_for(key);
+    std::lock_guard<std::mutex> guard(s.lock);
+    return s.map.find(key) != s.map.end();
+}
+
+///
+/// remove a key
+///
+/// @return true if the key existed
+///
+bool concurrent_map::erase(const var& key) {
+    shard& s = shard_for(key);
+    var removed;
+    {
+        std::lock_guard<std::mutex> guard(s.lock);
+        var::map_type::iterator it = s.map.find(key);
+        if (it == s.map.end()) return false;
+        // release the value outside the lock, it may be a large tree
+        removed = it->second;
+        s.map.erase(it);
+    }
+    return true;
+}
+
+///
+/// remove all keys
+///
+void concurrent_map::clear() {
+    for (size_type i = 0; i <= _mask; ++i) {
+        var::map_type removed;
+        {
+            std::lock_guard<std::mutex> guard(_shards[i].lock);
+            removed.swap(_shards[i].map);
+        }
+    }
+}
+
+///
+/// @return number of keys
+///
+/// Shards are counted one at a time, so the result is approximate while other threads write.
+///
+concurrent_map::size_type concurrent_map::count() const {
+    size_type n = 0;
+    for (size_type i = 0; i <= _mask; ++i) {
+        std::lock_guard<std::mutex> guard(_shards[i].lock);
+        n += _shards[i].map.size();
+    }
+    return n;
+}
+
+///
+/// @return var map holding a copy of the contents
+///
+/// Each shard is locked only while it is copied, so writers to other shards are never
+/// blocked. Iterate the returned map freely: it is not affected by later writes.
+///
+var concurrent_map::snapshot() const {
+    var result = make_map();
+    for (size_type i = 0; i <= _mask; ++i) {
+        var::map_type copy;
+        {
+            std::lock_guard<std::mutex> guard(_shards[i].lock);
+            copy = _shards[i].map;
+        }
+        for (var::map_type::const_iterator it = copy.begin(); it != copy.end(); ++it)
+            result(it->first, it->second);
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,48 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <dynamic/convert.hpp>
+
+#include "persistent.hpp"
+
+namespace dynamic {
+namespace detail {
+
+///
+/// find: one tree lookup for a map, one trie lookup for a persistent map
+///
+const var& convert_access::find(const var& map, const var& key) {
+    if (map.is_map()) {
+        const var::map_type& entries = *boost::get<var::map_ptr>(map._var);
+        var::map_type::const_iterator it = entries.find(key);
+        return it == entries.end() ? none : it->second;
+    }
+    if (!map.is_persistent_map()) throw exception("convert: expected a map");
+    const var::pair_type* entry = boost::get<var::pmap_ptr>(map._var)->find(key);
+    return entry ? entry->second : none;
+}
+
+}
+}
@@ -23,6 +23,9 @@
     OTHER DEALINGS IN THE SOFTWARE.
 */
 
+#include <utility>
+
+#include <dynamic/exception.hpp>
 #include <dynamic/var.hpp>
 
 namespace dynamic {
@@ -68,9 +71,32 @@ var::var(const std::wstring& s) : _var(wstring_t(s)) {}
 var::var(const wchar_t* s) : _var(wstring_t(s)) {}
 
 ///
-/// ctor: init with var
+/// ctor: init with var, copying the nodes that references were handed out into
 ///
-var::var(const var& v) : _var(v._var) {}
+var::var(const var& v) : _var(v._var) {
+    if (_var.which() >= type_vector) unshare();
+}
+
+///
+/// ctor: take over the value of v, leaving v null
+///
+var::var(var&& v) : _var(std::move(v._var)) { v._var = null_t(); }
+
+///
+/// ctor: init with a literal collection
+///
+/// The list becomes a map if every item is a { "key", value } pair, and a vector
+/// otherwise, so { { "a", 1 }, { "b", { 1, 2, 3 } } } is a map holding a vector.
+/// Use make_vector({ ... }) for a vector of pairs, and make_map({ ... }) for a map with
+/// keys that are not strings. Note that braces around a single var make a vector of it;
+/// copy a var with parentheses.
+///
+var::var(std::initializer_list<detail::literal> items) : _var() {
+    bool entries = items.size() > 0;
+    for (std::initializer_list<detail::literal>::const_iterator it = items.begin(); entries && it != items.end(); ++it)
+        entries = it->is_entry();
+    *this = entries ? make_map(items) : make_vector(items);
+}
 
 ///
 /// ctor: init with vector
@@ -82,4 +108,41 @@ var::var(vector_ptr _vector) : _var(_vector) {}
 ///
 var::var(map_ptr _map) : _var(_map) {}
 
+///
+/// ctor: init with persistent vector
+///
+var::var(pvector_ptr _vector) : _var(_vector) {}
+
+///
+/// ctor: init with persistent map
+///
+var::var(pmap_ptr _map) : _var(_map) {}
+
+///
+/// create vector holding items, sized once
+///
+var make_vector(std::initializer_list<detail::literal> items) {
+    var::vector_ptr vector(new var::vector_node);
+    vector->reserve(items.size());
+    for (std::initializer_list<detail::literal>::const_iterator it = items.begin(); it != items.end(); ++it)
+        vector->push_back(it->to_var());
+    return var(vector);
+}
+
+///
+/// create map from { key, value } pairs
+///
+/// The entries are inserted with the end of the map as a hint, so keys listed in order
+/// cost constant time each. As with operator (), the first of several equal keys wins.
+///
+var make_map(std::initializer_list<detail::literal> entries) {
+    var::map_ptr map(new var::map_node);
+    for (std::initializer_list<detail::literal>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        if (!it->is_list() || it->items().size() != 2) throw exception("make_map() needs { key, value } pairs");
+        const detail::literal* entry = it->items().begin();
+        map->emplace_hint(map->end(), entry[0].to_var(), entry[1].to_var());
+    }
+    return var(map);
+}
+
 }
@@ -0,0 +1,206 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+#include <dynamic/var.hpp>
+
+#include "digest.hpp"
+
+namespace dynamic {
+
+///
+/// state of one dedupe() run
+///
+struct var::dedupe_pass {
+    ///
+    /// vector or map whose members are being deduped
+    ///
+    struct frame {
+        explicit frame(var& c) : collection(&c), type(c.type()), index(0), phase(0) {
+            d.add(type);
+            d.add(c.count());
+            if (type == type_map) {
+                entries = boost::get<map_ptr>(c._var).get();
+                entry = entries->begin();
+            }
+        }
+
+        var* collection;
+        code type;
+        detail::digest d;
+        /// next vector element
+        size_type index;
+        map_type* entries;
+        map_type::iterator entry;
+        /// 0 before entry's key, 1 on its key, 2 on its value
+        int phase;
+    };
+
+    dedupe_pass() : shared(0) {}
+
+    /// @return the node behind a collection
+    static const void* node_of(const var& v) {
+        switch (v.type()) {
+        case type_vector :  return boost::get<vector_ptr>(v._var).get();
+        case type_map :     return boost::get<map_ptr>(v._var).get();
+        case type_persistent_vector :   return boost::get<pvector_ptr>(v._var).get();
+        case type_persistent_map :      return boost::get<pmap_ptr>(v._var).get();
+        case type_string :  return boost::get<string_t>(v._var).ps.get();
+        case type_wstring : return boost::get<wstring_t>(v._var).ps.get();
+        default :           return 0;
+        }
+    }
+
+    ///
+    /// @return the member after the current one, 0 past the last; set is_key on a map key
+    ///
+    static var* next(frame& f, bool& is_key) {
+        is_key = false;
+        if (f.type == type_vector) {
+            vector_type& items = *boost::get<vector_ptr>(f.collection->_var);
+            return f.index < items.size() ? &items[f.index++] : 0;
+        }
+        if (f.phase == 2) ++f.entry;
+        if (f.phase == 1) {
+            f.phase = 2;
+            return &f.entry->second;
+        }
+        if (f.entry == f.entries->end()) return 0;
+        f.phase = 1;
+        is_key = true;
+        // only read through this, keys are replaced by share_key()
+        return const_cast<var*>(&f.entry->first);
+    }
+
+    ///
+    /// replace v by the first var seen with fingerprint fp, if that one is equal to it
+    ///
+    /// @return the var to keep in v
+    ///
+    const var* canonical(const var& v, const fingerprint& fp) {
+        std::pair<std::unordered_map<fingerprint, var>::iterator, bool> found = first.emplace(fp, v);
+        if (found.second) return 0;
+        const var& c = found.first->second;
+        if (node_of(c) == node_of(v) || c.is_frozen() != v.is_frozen() || !(c == v)) return 0;
+        ++shared;
+        return &c;
+    }
+
+    /// share a string member
+    void share_string(frame& f, var& member, bool is_key) {
+        detail::digest d;
+        boost::apply_visitor(fingerprint_visitor(d), member._var);
+        const var* c = canonical(member, d.finish());
+        if (!c) return;
+        if (!is_key) {
+            member = *c;
+            return;
+        }
+        // map keys are const, so the entry is taken out of the map to change its key
+        map_type::iterator following = std::next(f.entry);
+        map_type::node_type entry = f.entries->extract(f.entry);
+        entry.key() = *c;
+        f.entry = f.entries->insert(following, std::move(entry));
+    }
+
+    /// dedupe the members of root
+    void run(var& root) {
+        std::vector<frame> stack;
+        stack.emplace_back(root);
+        for (;;) {
+            frame& top = stack.back();
+            bool is_key;
+            var* member = next(top, is_key);
+            if (member) {
+                if (boost::apply_visitor(fingerprint_visitor(top.d), member->_var)) {
+                    if (member->is_string() || member->is_wstring()) share_string(top, *member, is_key);
+                    continue;
+                }
+                // a slice is a view into a node it does not own, so it is hashed but not walked
+                if (member->is_slice()) {
+                    const fingerprint fp = fingerprint_of(*member);
+                    detail::add_nested(top.d, fp);
+                    const var* c = canonical(*member, fp);
+                    if (c && !is_key) *member = *c;
+                    continue;
+                }
+                const void* node = node_of(*member);
+                std::unordered_map<const void*, fingerprint>::const_iterator done = seen.find(node);
+                if (done != seen.end()) {
+                    detail::add_nested(top.d, done->second);
+                    const var* c = canonical(*member, done->second);
+                    if (c && !is_key) *member = *c;
+                    continue;
+                }
+                // collection keys are rare enough not to be rewritten
+                if (is_key || member->is_frozen() || member->is_persistent()) {
+                    const fingerprint fp = fingerprint_of(*member);
+                    detail::add_nested(top.d, fp);
+                    seen.emplace(node, fp);
+                    const var* c = canonical(*member, fp);
+                    if (c && !is_key) *member = *c;
+                    continue;
+                }
+                stack.emplace_back(*member);
+                continue;
+            }
+
+            const fingerprint fp = top.d.finish();
+            var& collection = *top.collection;
+            stack.pop_back();
+            if (stack.empty()) return;
+            seen.emplace(node_of(collection), fp);
+            detail::add_nested(stack.back().d, fp);
+            const var* c = canonical(collection, fp);
+            if (c) collection = *c;
+        }
+    }
+
+    /// first var seen with each fingerprint
+    std::unordered_map<fingerprint, var> first;
+    /// fingerprints of the collections already walked, which may be reached again in a DAG
+    std::unordered_map<const void*, fingerprint> seen;
+    std::size_t shared;
+};
+
+///
+/// make equal subtrees and strings of a var tree share one instance
+///
+dedupe_report dedupe(var& v) {
+    dedupe_report report;
+    report.bytes_before = memory_usage(v).total();
+    if ((v.is_vector() || v.is_map()) && !v.is_frozen()) {
+        var::dedupe_pass pass;
+        pass.run(v);
+        report.shared = pass.shared;
+    }
+    report.bytes_after = memory_usage(v).total();
+    return report;
+}
+
+}
@@ -0,0 +1,168 @@
+#ifndef DYNAMIC_DIGEST_HPP
+#define DYNAMIC_DIGEST_HPP
+
+/*
+    Copyright (C) 2009, Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Private to the library: the hash behind fingerprint_of() and dedupe().
+
+#include <cstring>
+
+#include <boost/cstdint.hpp>
+
+#include <dynamic/var.hpp>
+
+namespace dynamic {
+namespace detail {
+
+const boost::uint64_t digest_c1 = 0x87c37b91114253d5ULL;
+const boost::uint64_t digest_c2 = 0x4cf5ad432745937fULL;
+
+inline boost::uint64_t rotl(boost::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+/// MurmurHash3 finalizer
+inline boost::uint64_t fmix(boost::uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+///
+/// 128-bit hash fed one 64-bit word at a time, after MurmurHash3_x64_128
+///
+class digest {
+public :
+    digest() : _h1(0x9e3779b97f4a7c15ULL), _h2(0x6a09e667f3bcc908ULL), _words(0) {}
+
+    void add(boost::uint64_t k) {
+        boost::uint64_t k1 = rotl(k * digest_c1, 31) * digest_c2;
+        _h1 = rotl(_h1 ^ k1, 27) + _h2;
+        _h1 = _h1 * 5 + 0x52dce729;
+        boost::uint64_t k2 = rotl(k * digest_c2, 33) * digest_c1;
+        _h2 = rotl(_h2 ^ k2, 31) + _h1;
+        _h2 = _h2 * 5 + 0x38495ab5;
+        ++_words;
+    }
+
+    /// add n bytes, then their count
+    void add_bytes(const char* p, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            boost::uint64_t k;
+            std::memcpy(&k, p + i, 8);
+            add(k);
+        }
+        if (i < n) {
+            boost::uint64_t k = 0;
+            std::memcpy(&k, p + i, n - i);
+            add(k);
+        }
+        add(n);
+    }
+
+    /// add n wide characters as 32-bit code units, then their count
+    void add_units(const wchar_t* p, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + 2 <= n; i += 2)
+            add(boost::uint64_t(boost::uint32_t(p[i])) | (boost::uint64_t(boost::uint32_t(p[i + 1])) << 32));
+        if (i < n) add(boost::uint32_t(p[i]));
+        add(n);
+    }
+
+    fingerprint finish() const {
+        boost::uint64_t h1 = _h1 ^ _words, h2 = _h2 ^ _words;
+        h1 += h2;
+        h2 += h1;
+        h1 = fmix(h1);
+        h2 = fmix(h2);
+        h1 += h2;
+        h2 += h1;
+        return fingerprint(h1, h2);
+    }
+
+private :
+    boost::uint64_t _h1;
+    boost::uint64_t _h2;
+    boost::uint64_t _words;
+};
+
+/// marks a member digested as the fingerprint of a collection
+const boost::uint64_t nested = 0xff;
+
+/// add the fingerprint of a member collection
+inline void add_nested(digest& d, const fingerprint& f) {
+    d.add(nested);
+    d.add(f.high);
+    d.add(f.low);
+}
+
+}
+
+///
+/// add the type and value of a scalar to a digest, @return false for a collection
+///
+struct var::fingerprint_visitor : public boost::static_visitor<bool>
+{
+    explicit fingerprint_visitor(detail::digest& d) : d(d) {}
+
+    result_type operator () (const null_t&) const { d.add(type_null); return true; }
+    result_type operator () (const bool_t& n) const { d.add(type_bool); d.add(n); return true; }
+    result_type operator () (const int_t& n) const { d.add(type_int); d.add(boost::uint64_t(boost::int64_t(n))); return true; }
+    result_type operator () (const double_t& n) const
+    {
+        // 0.0 == -0.0
+        const double value = n == 0 ? 0.0 : n;
+        boost::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        d.add(type_double);
+        d.add(bits);
+        return true;
+    }
+    result_type operator () (const string_t& s) const { d.add(type_string); d.add_bytes(s.ps->data(), s.ps->size()); return true; }
+    result_type operator () (const wstring_t& s) const { d.add(type_wstring); d.add_units(s.ps->data(), s.ps->size()); return true; }
+    template <typename T>
+    result_type operator () (const boost::intrusive_ptr<T>&) const { return false; }
+    result_type operator () (const slice_t&) const { return false; }
+
+    detail::digest& d;
+};
+
+///
+/// @return the fingerprint memo of a frozen collection, 0 for anything else
+///
+struct var::fingerprint_memo_visitor : public boost::static_visitor<const detail::fingerprint_memo*>
+{
+    template <typename T>
+    result_type operator () (const T&) const { return 0; }
+    template <typename T>
+    result_type operator () (const boost::intrusive_ptr<T>& ptr) const { return ptr->frozen ? &ptr->memo : 0; }
+};
+
+}
+
+#endif // DYNAMIC_DIGEST_HPP
@@ -29,32 +29,15 @@
 #include <iomanip>
 
 #include <dynamic/exception.hpp>
+#include <dynamic/traverse.hpp>
 #include <dynamic/var.hpp>
 
+#include "persistent.hpp"
+
 namespace dynamic {
 
 const var none;
 
-bool var::less_var::operator () (const var& lhs, const var& rhs) {
-    // if the two vars are of different types, order by type
-    code lht = lhs.type(), rht = rhs.type();
-    if (lht != rht) return lht < rht;
-
-    // they are of the same type, order by value
-    switch (lht) {
-    case type_null : return false;
-    case type_bool : return boost::get<bool_t>(lhs._var) < boost::get<bool_t>(rhs._var);
-    case type_int : return boost::get<int_t>(lhs._var) < boost::get<int_t>(rhs._var);
-    case type_double : return boost::get<double_t>(lhs._var) < boost::get<double_t>(rhs._var);
-    case type_string : return *(boost::get<string_t>(lhs._var).ps) < *(boost::get<string_t>(rhs._var).ps);
-    case type_wstring : return *(boost::get<wstring_t>(lhs._var).ps) < *(boost::get<wstring_t>(rhs._var).ps);
-    case type_vector :
-    case type_map :
-        return false;
-    default : throw exception("unhandled type");
-    }
-}
-
 ///
 /// append a bool to a collection
 ///
@@ -104,10 +87,35 @@ struct var::append_value_visitor : public boost::static_visitor<var&>
     result_type operator () (const double_t&) const { throw exception("invalid () operation on double"); }
     result_type operator () (const string_t& value) const { throw exception("invalid () operation on string"); }
     result_type operator () (const wstring_t& value) const { throw exception("invalid () operation on wstring"); }
-    result_type operator () (const vector_ptr& ptr) const { ptr->push_back(value); return self; }
-    result_type operator () (const map_ptr& ptr) const { ptr->insert(map_type::value_type(value, none)); return self; }
+    result_type operator () (const vector_ptr& ptr) const
+    {
+        if (ptr->frozen) throw exception("invalid () operation on frozen vector");
+        ptr->push_back(value);
+        return self;
+    }
+    result_type operator () (const map_ptr& ptr) const
+    {
+        if (ptr->frozen) throw exception("invalid () operation on frozen map");
+        ptr->insert(map_type::value_type(value, none));
+        return self;
+    }
+    result_type operator () (const pvector_ptr& ptr) const
+    {
+        if (ptr->frozen) throw exception("invalid () operation on frozen persistent vector");
+        ptr->push_back(value);
+        return self;
+    }
+    result_type operator () (const pmap_ptr& ptr) const
+    {
+        if (ptr->frozen) throw exception("invalid () operation on frozen persistent map");
+        ptr->insert(value, none);
+        return self;
+    }
+    // detach() has turned a slice into a vector by now
+    result_type operator () (const slice_t&) const { throw exception("invalid () operation on slice"); }
 };
-var& var::operator () (const var& v) {    
+var& var::operator () (const var& v) {
+    detach();
     return boost::apply_visitor(append_value_visitor(*this, v), _var);
 }
 
@@ -126,10 +134,24 @@ struct var::append_key_value_visitor : public boost::static_visitor<var&>
     result_type operator () (const double_t&) const { throw exception("invalid (,) operation on double"); }
     result_type operator () (const string_t& value) const { throw exception("invalid (,) operation on string"); }
     result_type operator () (const wstring_t& value) const { throw exception("invalid (,) operation on wstring"); }
-    result_type operator () (const vector_ptr& ptr) const { throw exception("invalid (,) operation on vector"); }
-    result_type operator () (const map_ptr& ptr) const { ptr->insert(map_type::value_type(key, value)); return self; }
+    result_type operator () (const vector_ptr&) const { throw exception("invalid (,) operation on vector"); }
+    result_type operator () (const map_ptr& ptr) const
+    {
+        if (ptr->frozen) throw exception("invalid (,) operation on frozen map");
+        ptr->insert(map_type::value_type(key, value));
+        return self;
+    }
+    result_type operator () (const pvector_ptr&) const { throw exception("invalid (,) operation on persistent vector"); }
+    result_type operator () (const pmap_ptr& ptr) const
+    {
+        if (ptr->frozen) throw exception("invalid (,) operation on frozen persistent map");
+        ptr->insert(key, value);
+        return self;
+    }
+    result_type operator () (const slice_t&) const { throw exception("invalid (,) operation on slice"); }
 };
 var& var::operator () (const var& key, const var& value) {
+    detach();
     return boost::apply_visitor(append_key_value_visitor(*this, key, value), _var);
 }
 
@@ -146,6 +168,9 @@ struct var::count_visitor : public boost::static_visitor<size_type>
     result_type operator () (const wstring_t& value) const { return value.ps->length(); }
     result_type operator () (const vector_ptr& ptr) const { return static_cast<result_type>(ptr->size()); }
     result_type operator () (const map_ptr& ptr) const { return static_cast<result_type>(ptr->size()); }
+    result_type operator () (const pvector_ptr& ptr) const { return ptr->size; }
+    result_type operator () (const pmap_ptr& ptr) const { return ptr->size(); }
+    result_type operator () (const slice_t& slice) const { return slice.length; }
 };
 var::size_type var::count() const {
     return boost::apply_visitor(count_visitor(), _var);
@@ -156,8 +181,9 @@ var::size_type var::count() const {
 ///
 struct var::index_int_visitor : public boost::static_visitor<var&>
 {
-    index_int_visitor(int n) : n(n) {}
+    index_int_visitor(int n, bool update) : n(n), update(update) {}
     int n;
+    bool update;
     result_type operator () (const null_t&) const { throw exception("cannot apply [int] to none"); }
     result_type operator () (const bool_t&) const { throw exception("cannot apply [int] to bool"); }
     result_type operator () (const int_t&) const { throw exception("cannot apply [int] to int"); }
@@ -166,64 +192,115 @@ struct var::index_int_visitor : public boost::static_visitor<var&>
     result_type operator () (const wstring_t&) const { throw exception("cannot apply [int] to wstring"); }
     result_type operator () (const vector_ptr& ptr) const
     {
+        if (update && ptr->frozen)
+            throw exception("cannot apply [int] to frozen vector");
         if (n < 0 || n >= int(ptr->size()))
             throw exception("[int] out of range in vector");
         return (*ptr)[n];
     }
     result_type operator () (const map_ptr& ptr) const
     {
+        if (update && ptr->frozen)
+            throw exception("cannot apply [int] to frozen map");
         var key(n);
         map_type::iterator it = ptr->find(key);
         if (it == ptr->end())
             throw exception("[int] not found in map");
         return it->second;
     }
+    result_type operator () (const pvector_ptr& ptr) const
+    {
+        if (update && ptr->frozen)
+            throw exception("cannot apply [int] to frozen persistent vector");
+        if (n < 0 || n >= int(ptr->size))
+            throw exception("[int] out of range in persistent vector");
+        return update ? ptr->update(n) : const_cast<var&>(ptr->at(n));
+    }
+    result_type operator () (const pmap_ptr& ptr) const
+    {
+        if (update && ptr->frozen)
+            throw exception("cannot apply [int] to frozen persistent map");
+        var key(n);
+        var* value = 0;
+        if (update) value = ptr->update(key);
+        else if (const pair_type* entry = ptr->find(key)) value = const_cast<var*>(&entry->second);
+        if (!value)
+            throw exception("[int] not found in persistent map");
+        return *value;
+    }
+    // only reached by const operator [], detach() has turned a slice into a vector before any update
+    result_type operator () (const slice_t& slice) const
+    {
+        if (n < 0 || size_type(n) >= slice.length)
+            throw exception("[int] out of range in slice");
+        return (*slice.parent)[slice.offset + n];
+    }
 };
 var& var::operator [] (int n) {
-    return boost::apply_visitor(index_int_visitor(n), _var);
+    detach();
+    var& item = boost::apply_visitor(index_int_visitor(n, true), _var);
+    lend();
+    return item;
+}
+
+const var& var::operator [] (int n) const {
+    return boost::apply_visitor(index_int_visitor(n, false), _var);
 }
 
 ///
 /// index a collection with a double
 ///
 var& var::operator [] (double n) { return operator[] (var(n)); }
+const var& var::operator [] (double n) const { return operator[] (var(n)); }
 
 ///
 /// index a collection with a string
 ///
 var& var::operator [] (const std::string& s) { return operator[] (var(s)); }
+const var& var::operator [] (const std::string& s) const { return operator[] (var(s)); }
 
 ///
 /// index a collection with a string constant
 ///
 var& var::operator [] (const char* s) { return operator[] (var(s)); }
+const var& var::operator [] (const char* s) const { return operator[] (var(s)); }
 
 ///
 /// index a collection with a wide string
 ///
 var& var::operator [] (const std::wstring& s) { return operator[] (var(s)); }
+const var& var::operator [] (const std::wstring& s) const { return operator[] (var(s)); }
 
 ///
 /// index a collection with a wide string constant
 ///
 var& var::operator [] (const wchar_t* s) { return operator[] (var(s)); }
+const var& var::operator [] (const wchar_t* s) const { return operator[] (var(s)); }
     
 ///
 /// index a collection
 ///
 struct var::index_var_visitor : public boost::static_visitor<var&>
 {
-    index_var_visitor(const var& key) : key(key) {}
+    index_var_visitor(const var& key, bool update) : key(key), update(update) {}
     const var& key;
+    bool update;
     result_type operator () (const null_t&) const { throw exception("cannot apply [var] to none"); }
     result_type operator () (const bool_t&) const { throw exception("cannot apply [var] to bool"); }
     result_type operator () (const int_t&) const { throw exception("cannot apply [var] to int"); }
     result_type operator () (const double_t&) const { throw exception("cannot apply [var] to double"); }
     result_type operator () (const string_t&) const { throw exception("cannot apply [var] to string"); }
     result_type operator () (const wstring_t&) const { throw exception("cannot apply [var] to wstring"); }
-    result_type operator () (const vector_ptr& ptr) const { throw exception("vector[] requires int"); }
+    result_type operator () (const vector_ptr&) const { throw exception("vector[] requires int"); }
     result_type operator () (const map_ptr& ptr) const
     {
+        if (!update) {
+            // never insert through a const var, its map may be shared
+            map_type::iterator it = ptr->find(key);
+            if (it == ptr->end()) throw exception("[var] not found in map");
+            return it->second;
+        }
+        if (ptr->frozen) throw exception("cannot apply [var] to frozen map");
         // See Effective STL (Meyers) item 45
         map_type::iterator it = ptr->lower_bound(key);
         if ((it == ptr->end()) || (ptr->key_comp()(key, it->first)))
@@ -232,13 +309,54 @@ struct var::index_var_visitor : public boost::static_visitor<var&>
         }
         return it->second;
     }
+    result_type operator () (const pvector_ptr&) const { throw exception("persistent vector[] requires int"); }
+    result_type operator () (const pmap_ptr& ptr) const
+    {
+        if (!update) {
+            const pair_type* entry = ptr->find(key);
+            if (!entry) throw exception("[var] not found in persistent map");
+            return const_cast<var&>(entry->second);
+        }
+        if (ptr->frozen) throw exception("cannot apply [var] to frozen persistent map");
+        // update() marks the path to the value it hands out
+        ptr->insert(key, none);
+        return *ptr->update(key);
+    }
+    result_type operator () (const slice_t&) const { throw exception("slice[] requires int"); }
 };
 var& var::operator [] (const var& v) {
-    return boost::apply_visitor(index_var_visitor(v), _var);
+    detach();
+    var& item = boost::apply_visitor(index_var_visitor(v, true), _var);
+    lend();
+    return item;
 }
 
 const var& var::operator [] (const var& v) const {
-    return boost::apply_visitor(index_var_visitor(v), _var);
+    return boost::apply_visitor(index_var_visitor(v, false), _var);
+}
+
+namespace {
+
+///
+/// write a collection and everything below it to an ostream or wostream, without recursion
+///
+template <typename Stream>
+Stream& write_tree(const var& root, Stream& os) {
+    for (tree_walker w(root); w.next(); ) {
+        if (w.event() != tree_walker::leave) {
+            if (w.role() == tree_walker::value) os << " : ";
+            else if (w.role() != tree_walker::root && w.index() > 0) os << ", ";
+        }
+        const bool map = w.node().is_map() || w.node().is_persistent_map();
+        switch (w.event()) {
+        case tree_walker::enter :   os << (map ? "{ " : "[ "); break;
+        case tree_walker::leave :   os << (map ? " }" : " ]"); break;
+        case tree_walker::leaf :    w.node()._write_var(os); break;
+        }
+    }
+    return os;
+}
+
 }
 
 ///
@@ -253,7 +371,10 @@ std::ostream& var::_write_var(std::ostream& os) const {
     case type_string :  return _write_string(os);
     case type_wstring : return _write_wstring(os);
     case type_vector :
-    case type_map :     return _write_collection(os);
+    case type_map :
+    case type_persistent_vector :
+    case type_persistent_map :
+    case type_slice :   return _write_collection(os);
     default :           throw exception("var::_write_var(ostream) unhandled type");
     }
 }
@@ -311,37 +432,7 @@ std::ostream& var::_write_wstring(std::ostream& os) const {
 ///
 std::ostream& var::_write_collection(std::ostream& os) const {
     assert(is_collection());
-    const code current = type();
-    switch (current)
-    {
-    case type_vector : os << "[ "; break;
-    case type_map : os << "{ "; break;
-    default : assert(false);
-    }
-    for (var::const_iterator vi = begin(); vi != end(); ++vi) {
-        switch (current)
-        {
-        case type_vector:
-            if (vi != begin()) os << ", ";
-            (*vi)._write_var(os);
-            break;
-        case type_map:
-            if (vi != begin()) os << ", ";
-            (*vi)._write_var(os);
-            os << " : ";
-            (*this)[*vi]._write_var(os);
-            break;
-        default:
-            assert(false);
-        }
-    }
-    switch (current)
-    {
-    case type_vector : os << " ]"; break;
-    case type_map : os << " }"; break;
-    default : assert(false);
-    }
-    return os;
+    return write_tree(*this, os);
 }
 
 ///
@@ -356,7 +447,10 @@ std::wostream& var::_write_var(std::wostream& os) const {
     case type_string :  return _write_string(os);
     case type_wstring : return _write_wstring(os);
     case type_vector :
-    case type_map :     return _write_collection(os);
+    case type_map :
+    case type_persistent_vector :
+    case type_persistent_map :
+    case type_slice :   return _write_collection(os);
     default :           throw exception("var::_write_var(wostream) unhandled type");
     }
 }
@@ -412,37 +506,7 @@ std::wostream& var::_write_wstring(std::wostream& os) const {
 ///
 std::wostream& var::_write_collection(std::wostream& os) const {
     assert(is_collection());
-    const code current = type();
-    switch (current)
-    {
-    case type_vector : os << L"[ "; break;
-    case type_map : os << L"{ "; break;
-    default : assert(false);
-    }
-    for (var::const_iterator vi = begin(); vi != end(); ++vi) {
-        switch (current)
-        {
-        case type_vector:
-            if (vi != begin()) os << L", ";
-            (*vi)._write_var(os);
-            break;
-        case type_map:
-            if (vi != begin()) os << L", ";
-            (*vi)._write_var(os);
-            os << L" : ";
-            (*this)[*vi]._write_var(os);
-            break;
-        default:
-            assert(false);
-        }
-    }
-    switch (current)
-    {
-    case type_vector : os << L" ]"; break;
-    case type_map : os << L" }"; break;
-    default : assert(false);
-    }
-    return os;
+    return write_tree(*this, os);
 }
 
 }
@@ -0,0 +1,98 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <dynamic/exception.hpp>
+#include <dynamic/traverse.hpp>
+#include <dynamic/var.hpp>
+
+#include "persistent.hpp"
+
+namespace dynamic {
+
+///
+/// mark one collection immutable, @return false if it already was
+///
+struct var::freeze_visitor : public boost::static_visitor<bool>
+{
+    template <typename T>
+    result_type operator () (const T&) const { return false; }
+    template <typename T>
+    result_type operator () (const boost::intrusive_ptr<T>& ptr) const
+    {
+        if (ptr->frozen) return false;
+        ptr->frozen = true;
+        return true;
+    }
+};
+
+///
+/// deep-freeze a var
+///
+/// Every collection in the tree is marked immutable. Collections this var shares with
+/// other vars are copied first, on the way down, so the other vars keep their mutable
+/// nodes and only this tree is frozen; subtrees that are already frozen stay shared.
+/// Afterwards operator() and non-const operator[] throw, non-const iterators read but
+/// throw when dereferenced for writing, and const operator[] never inserts, so any number
+/// of threads may read the tree.
+///
+/// A slice is turned into a vector first. Slices below it are left as they are: they
+/// cannot be modified through a frozen collection, and freezing them would freeze the
+/// whole vector they share. The members of a persistent collection are not walked
+/// either, they sit in nodes it may share with other versions of itself.
+///
+var& var::freeze() {
+    if (type() == type_slice) detach();
+    // a frozen vector or map only ever holds frozen children, so frozen subtrees are skipped
+    for (tree_walker w(*this); w.next(); ) {
+        if (w.event() != tree_walker::enter) continue;
+        // the collection holding node was copied before its members are walked, so only
+        // this tree sees node; a map key keeps its order, as a copy compares equal
+        var& node = const_cast<var&>(w.node());
+        if (node.is_slice() || node.is_frozen()) {
+            w.skip();
+            continue;
+        }
+        node.detach();
+        boost::apply_visitor(freeze_visitor(), node._var);
+        if (node.is_persistent()) w.skip();
+    }
+    return *this;
+}
+
+///
+/// @return true if a collection has been frozen; other types are immutable values and always frozen
+///
+bool var::is_frozen() const {
+    switch (type()) {
+    case type_vector :  return boost::get<vector_ptr>(_var)->frozen;
+    case type_map :     return boost::get<map_ptr>(_var)->frozen;
+    case type_persistent_vector :   return boost::get<pvector_ptr>(_var)->frozen;
+    case type_persistent_map :      return boost::get<pmap_ptr>(_var)->frozen;
+    case type_slice :   return false;
+    default :           return true;
+    }
+}
+
+}
@@ -0,0 +1,363 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include <climits>
+#include <exception>
+#include <thread>
+
+#include <dynamic/exception.hpp>
+#include <dynamic/group_by.hpp>
+
+namespace dynamic {
+
+namespace {
+
+/// less_var order, with ints and doubles compared by value as sum and avg treat them
+int order(const var& lhs, const var& rhs) {
+    if ((lhs.is_int() || lhs.is_double()) && (rhs.is_int() || rhs.is_double())) {
+        const double l = lhs.is_int() ? int(lhs) : double(lhs), r = rhs.is_int() ? int(rhs) : double(rhs);
+        return l < r ? -1 : r < l ? 1 : 0;
+    }
+    return var::compare(lhs, rhs);
+}
+
+}
+
+///
+/// groups and their running aggregates, found through an open-addressing hash table
+///
+class group_by::table {
+public :
+    explicit table(const group_by& spec) : _spec(spec), _slots(16) {}
+
+    void add(const var& record);
+    void merge(const table& other);
+    var result() const;
+
+private :
+    struct accumulator {
+        accumulator() : n(0), int_total(0), double_total(0), doubles(false) {}
+
+        /// values seen, or records for count
+        var::size_type n;
+        long long int_total;
+        double double_total;
+        bool doubles;
+        /// least or greatest value so far
+        var best;
+        std::vector<var> values;
+    };
+
+    struct group {
+        std::size_t hash;
+        std::vector<var> keys;
+        std::vector<accumulator> accumulators;
+    };
+
+    /// hash of the group and its position in _groups, so probing does not touch the groups
+    struct slot {
+        slot() : hash(0), group(npos) {}
+        std::size_t hash;
+        std::size_t group;
+    };
+
+    static const std::size_t npos = std::size_t(-1);
+
+    template <typename Key>
+    group& find_or_insert(std::size_t hash, const std::vector<Key>& keys);
+    void grow();
+    void accumulate(const field& f, accumulator& a, const var& record) const;
+    static void merge(const field& f, accumulator& into, const accumulator& from);
+
+    static const var& deref(const var* v) { return *v; }
+    static const var& deref(const var& v) { return v; }
+
+    const group_by& _spec;
+    std::vector<slot> _slots;
+    std::vector<group> _groups;
+    /// key lookups of the record being added
+    std::vector<const var*> _lookup;
+};
+
+///
+/// @return group with keys, inserted with empty aggregates if there is none
+///
+template <typename Key>
+group_by::table::group& group_by::table::find_or_insert(std::size_t hash, const std::vector<Key>& keys) {
+    const std::size_t mask = _slots.size() - 1;
+    for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+        slot& s = _slots[i];
+        if (s.group == npos) {
+            s.hash = hash;
+            s.group = _groups.size();
+            _groups.push_back(group());
+            group& g = _groups.back();
+            g.hash = hash;
+            for (typename std::vector<Key>::const_iterator it = keys.begin(); it != keys.end(); ++it)
+                g.keys.push_back(deref(*it));
+            g.accumulators.resize(_spec._aggregates.size());
+            if (_groups.size() * 2 > _slots.size()) grow();
+            return g;
+        }
+        if (s.hash != hash) continue;
+        group& g = _groups[s.group];
+        bool same = true;
+        for (std::size_t k = 0; same && k < keys.size(); ++k)
+            same = g.keys[k] == deref(keys[k]);
+        if (same) return g;
+    }
+}
+
+///
+/// double the hash table
+///
+void group_by::table::grow() {
+    std::vector<slot> slots(_slots.size() * 2);
+    const std::size_t mask = slots.size() - 1;
+    for (std::size_t g = 0; g < _groups.size(); ++g) {
+        std::size_t i = _groups[g].hash & mask;
+        while (slots[i].group != npos) i = (i + 1) & mask;
+        slots[i].hash = _groups[g].hash;
+        slots[i].group = g;
+    }
+    _slots.swap(slots);
+}
+
+///
+/// add record to its group
+///
+void group_by::table::add(const var& record) {
+    _lookup.clear();
+    std::size_t hash = 0;
+    for (std::vector<field>::const_iterator key = _spec._keys.begin(); key != _spec._keys.end(); ++key) {
+        const var* v = key->at.find(record);
+        if (!v) v = &none;
+        _lookup.push_back(v);
+        hash = hash * 31 + dynamic::hash(*v);
+    }
+    group& g = find_or_insert(hash, _lookup);
+    for (std::size_t a = 0; a < _spec._aggregates.size(); ++a)
+        accumulate(_spec._aggregates[a], g.accumulators[a], record);
+}
+
+///
+/// update aggregate f of a group with record
+///
+void group_by::table::accumulate(const field& f, accumulator& a, const var& record) const {
+    if (f.op == op_count) {
+        ++a.n;
+        return;
+    }
+    const var* v = f.at.find(record);
+    if (!v || v->is_null()) return;
+    switch (f.op) {
+    case op_sum :
+    case op_avg :
+        if (v->is_int()) a.int_total += int(*v);
+        else if (v->is_double()) a.double_total += double(*v), a.doubles = true;
+        else throw exception("sum and avg need numbers");
+        break;
+    case op_min :
+        if (a.n == 0 || order(*v, a.best) < 0) a.best = *v;
+        break;
+    case op_max :
+        if (a.n == 0 || order(*v, a.best) > 0) a.best = *v;
+        break;
+    case op_collect :
+        a.values.push_back(*v);
+        break;
+    default :
+        break;
+    }
+    ++a.n;
+}
+
+///
+/// fold the groups of other, aggregated over later records, into this table
+///
+void group_by::table::merge(const table& other) {
+    for (std::vector<group>::const_iterator from = other._groups.begin(); from != other._groups.end(); ++from) {
+        group& into = find_or_insert(from->hash, from->keys);
+        for (std::size_t a = 0; a < _spec._aggregates.size(); ++a)
+            merge(_spec._aggregates[a], into.accumulators[a], from->accumulators[a]);
+    }
+}
+
+///
+/// fold aggregate f of a group over later records into the same aggregate of into
+///
+void group_by::table::merge(const field& f, accumulator& into, const accumulator& from) {
+    if (from.n == 0) return;
+    if ((f.op == op_min && (into.n == 0 || order(from.best, into.best) < 0)) ||
+        (f.op == op_max && (into.n == 0 || order(from.best, into.best) > 0)))
+        into.best = from.best;
+    into.n += from.n;
+    into.int_total += from.int_total;
+    into.double_total += from.double_total;
+    into.doubles = into.doubles || from.doubles;
+    into.values.insert(into.values.end(), from.values.begin(), from.values.end());
+}
+
+///
+/// @return vector with a map of keys and aggregates per group
+///
+var group_by::table::result() const {
+    var groups = make_vector();
+    for (std::vector<group>::const_iterator g = _groups.begin(); g != _groups.end(); ++g) {
+        var row = make_map();
+        for (std::size_t k = 0; k < _spec._keys.size(); ++k)
+            row(_spec._keys[k].name, g->keys[k]);
+        for (std::size_t i = 0; i < _spec._aggregates.size(); ++i) {
+            const field& f = _spec._aggregates[i];
+            const accumulator& a = g->accumulators[i];
+            var value;
+            switch (f.op) {
+            case op_count :
+                value = int(a.n);
+                break;
+            case op_sum :
+                if (!a.doubles && a.int_total >= INT_MIN && a.int_total <= INT_MAX) value = int(a.int_total);
+                else value = double(a.int_total) + a.double_total;
+                break;
+            case op_avg :
+                if (a.n) value = (double(a.int_total) + a.double_total) / a.n;
+                break;
+            case op_min :
+            case op_max :
+                value = a.best;
+                break;
+            case op_collect :
+                value = make_vector();
+                for (std::vector<var>::const_iterator it = a.values.begin(); it != a.values.end(); ++it)
+                    value(*it);
+                break;
+            }
+            row(f.name, value);
+        }
+        groups(row);
+    }
+    return groups;
+}
+
+///
+/// group by the value at pointer, named name in the result
+///
+group_by& group_by::key(const std::string& name, const std::string& pointer) {
+    _keys.push_back(field(name, pointer, op_count));
+    return *this;
+}
+
+///
+/// count the records of each group
+///
+group_by& group_by::count(const std::string& name) {
+    return aggregate(name, "", op_count);
+}
+
+///
+/// sum the numbers at pointer
+///
+group_by& group_by::sum(const std::string& name, const std::string& pointer) {
+    return aggregate(name, pointer, op_sum);
+}
+
+///
+/// keep the least value at pointer
+///
+group_by& group_by::min(const std::string& name, const std::string& pointer) {
+    return aggregate(name, pointer, op_min);
+}
+
+///
+/// keep the greatest value at pointer
+///
+group_by& group_by::max(const std::string& name, const std::string& pointer) {
+    return aggregate(name, pointer, op_max);
+}
+
+///
+/// average the numbers at pointer
+///
+group_by& group_by::avg(const std::string& name, const std::string& pointer) {
+    return aggregate(name, pointer, op_avg);
+}
+
+///
+/// collect the values at pointer into a vector
+///
+group_by& group_by::collect(const std::string& name, const std::string& pointer) {
+    return aggregate(name, pointer, op_collect);
+}
+
+group_by& group_by::aggregate(const std::string& name, const std::string& pointer, op_t op) {
+    _aggregates.push_back(field(name, pointer, op));
+    return *this;
+}
+
+///
+/// @return vector with a map of keys and aggregates per group, in order of first appearance
+///
+/// threads is the most threads to use, 0 for one per hardware thread.
+///
+var group_by::run(const var& records, std::size_t threads) const {
+    if (!records.is_vector() && !records.is_persistent_vector() && !records.is_slice()) throw exception("group_by needs a vector");
+    const var::size_type n = records.count();
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+#ifdef DYNAMIC_NON_ATOMIC_REFCOUNT
+    // groups share nodes with the records, which needs atomic counts across threads
+    threads = 1;
+#endif
+    threads = std::max<std::size_t>(1, std::min<std::size_t>(threads, n / min_chunk));
+
+    std::vector<table> tables(threads, table(*this));
+    if (threads == 1) {
+        for (var::size_type i = 0; i < n; ++i)
+            tables[0].add(records[int(i)]);
+        return tables[0].result();
+    }
+
+    // contiguous chunks, so merging in chunk order keeps the order of first appearance
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < threads; ++t)
+        workers.push_back(std::thread([&records, &tables, &errors, threads, n, t] {
+            try {
+                for (var::size_type i = n * t / threads, end = n * (t + 1) / threads; i < end; ++i)
+                    tables[t].add(records[int(i)]);
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        }));
+    for (std::size_t t = 0; t < threads; ++t)
+        workers[t].join();
+    for (std::size_t t = 0; t < threads; ++t)
+        if (errors[t]) std::rethrow_exception(errors[t]);
+    for (std::size_t t = 1; t < threads; ++t)
+        tables[0].merge(tables[t]);
+    return tables[0].result();
+}
+
+}
@@ -0,0 +1,139 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <boost/container/small_vector.hpp>
+#include <boost/functional/hash.hpp>
+
+#include <dynamic/exception.hpp>
+#include <dynamic/traverse.hpp>
+#include <dynamic/var.hpp>
+
+#include "digest.hpp"
+#include "persistent.hpp"
+
+namespace dynamic {
+
+///
+/// hash a var
+///
+/// Collections hash by content, since less_var orders them by their members.
+///
+std::size_t hash_value(const var& v) {
+    // a slice equals the vector of its elements
+    std::size_t seed = boost::hash_value(int(v.is_slice() ? var::type_vector : v.type()));
+    switch (v.type()) {
+    case var::type_null :       break;
+    case var::type_bool :       boost::hash_combine(seed, boost::get<var::bool_t>(v._var)); break;
+    case var::type_int :        boost::hash_combine(seed, boost::get<var::int_t>(v._var)); break;
+    case var::type_double :     boost::hash_combine(seed, boost::get<var::double_t>(v._var)); break;
+    case var::type_string :     boost::hash_combine(seed, *boost::get<var::string_t>(v._var).ps); break;
+    case var::type_wstring :    boost::hash_combine(seed, *boost::get<var::wstring_t>(v._var).ps); break;
+    case var::type_vector :
+    case var::type_map :
+    case var::type_persistent_vector :
+    case var::type_persistent_map :
+    case var::type_slice :      boost::hash_combine(seed, hash(v)); break;
+    default :                   throw exception("unhandled type");
+    }
+    return seed;
+}
+
+///
+/// @return fingerprint as 32 hex digits
+///
+std::string fingerprint::str() const {
+    static const char digits[] = "0123456789abcdef";
+    std::string s(32, '0');
+    for (int i = 0; i < 16; ++i) {
+        s[15 - i] = digits[(high >> (i * 4)) & 0xf];
+        s[31 - i] = digits[(low >> (i * 4)) & 0xf];
+    }
+    return s;
+}
+
+namespace {
+
+///
+/// digest of one collection whose members are being added
+///
+struct digest_frame {
+    digest_frame(const var& collection, const detail::fingerprint_memo* m) : members(collection), memo(m) {
+        d.add(collection.is_slice() ? var::type_vector : collection.type());
+        d.add(collection.count());
+    }
+
+    member_cursor members;
+    const detail::fingerprint_memo* memo;
+    detail::digest d;
+};
+
+}
+
+///
+/// digest the content of a var
+///
+/// A collection digests its type, its size and its members in iteration order, then
+/// contributes its own fingerprint to its parent, so a frozen subtree whose fingerprint
+/// is already known costs its parent no more than a scalar.
+///
+fingerprint fingerprint_of(const var& v) {
+    {
+        detail::digest d;
+        if (boost::apply_visitor(var::fingerprint_visitor(d), v._var)) return d.finish();
+    }
+    fingerprint f;
+    const detail::fingerprint_memo* memo = boost::apply_visitor(var::fingerprint_memo_visitor(), v._var);
+    if (memo && memo->get(f)) return f;
+
+    boost::container::small_vector<digest_frame, 8> stack;
+    stack.emplace_back(v, memo);
+    for (;;) {
+        digest_frame& top = stack.back();
+        if (top.members.next()) {
+            const var& member = top.members.member();
+            if (boost::apply_visitor(var::fingerprint_visitor(top.d), member._var)) continue;
+            memo = boost::apply_visitor(var::fingerprint_memo_visitor(), member._var);
+            if (memo && memo->get(f))
+                detail::add_nested(top.d, f);
+            else
+                stack.emplace_back(member, memo);
+            continue;
+        }
+        f = top.d.finish();
+        if (top.memo) top.memo->set(f);
+        stack.pop_back();
+        if (stack.empty()) return f;
+        detail::add_nested(stack.back().d, f);
+    }
+}
+
+///
+/// hash a var consistently with operator ==
+///
+std::size_t hash(const var& v) {
+    return std::size_t(fingerprint_of(v).low);
+}
+
+}
@@ -26,6 +26,8 @@
 #include <dynamic/exception.hpp>
 #include <dynamic/var.hpp>
 
+#include "persistent.hpp"
+
 namespace dynamic {
     
 ///
@@ -40,13 +42,26 @@ var::const_iterator var::begin() const {
     case type_wstring : throw exception("invalid .begin() operation on wstring");
     case type_vector :  return boost::get<vector_ptr>(_var)->begin();
     case type_map :     return boost::get<map_ptr>(_var)->begin();
+    case type_persistent_vector :   return pvector_iterator(boost::get<pvector_ptr>(_var).get(), 0);
+    case type_persistent_map :      return pmap_iterator(boost::get<pmap_ptr>(_var).get(), 0);
+    case type_slice : {
+        const slice_t& window = boost::get<slice_t>(_var);
+        return window.parent->begin() + window.offset;
+    }
     default :           throw exception("unhandled .begin() operation");
     }
 }
 
+///
+/// detach() leaves a frozen collection shared, so the iterator reads it in place and throws
+/// when it is dereferenced for writing; v.begin() still works as a const_iterator on it.
+///
 var::iterator var::begin() {
+    detach();
     // iterator is implemented via object slicing, so we need to do const casting
     const_iterator result = const_cast<const var*>(this)->begin(); // Call begin() const
+    result._read_only = is_collection() && is_frozen();
+    if (!result._read_only) lend();
     return static_cast<var::iterator&>(result);
 }
 
@@ -62,12 +77,27 @@ var::const_iterator var::end() const {
     case type_wstring : throw exception("invalid .end() operation on wstring");
     case type_vector :  return boost::get<vector_ptr>(_var)->end();
     case type_map :     return boost::get<map_ptr>(_var)->end();
+    case type_persistent_vector : {
+        const pvector_node* vec = boost::get<pvector_ptr>(_var).get();
+        return pvector_iterator(vec, vec->size);
+    }
+    case type_persistent_map : {
+        const pmap_node* map = boost::get<pmap_ptr>(_var).get();
+        return pmap_iterator(map, map->size());
+    }
+    case type_slice : {
+        const slice_t& window = boost::get<slice_t>(_var);
+        return window.parent->begin() + window.offset + window.length;
+    }
     default :           throw exception("unhandled .end() operation");
     }
 }
 
 var::iterator var::end() {
+    detach();
     const_iterator result = const_cast<const var*>(this)->end(); // Call end() const
+    result._read_only = is_collection() && is_frozen();
+    if (!result._read_only) lend();
     return static_cast<var::iterator&>(result);
 }
 
@@ -78,6 +108,8 @@ var::const_iterator var::const_iterator::operator++() {
     switch (_iter.which()) {
     case type_vector :  return ++boost::get<vector_type::iterator&>(_iter);
     case type_map :     return ++boost::get<map_type::iterator&>(_iter);
+    case type_persistent_vector :   boost::get<pvector_iterator&>(_iter).next(); return *this;
+    case type_persistent_map :      boost::get<pmap_iterator&>(_iter).next(); return *this;
     default :           throw exception("unhandled ++iter");
     }
 }
@@ -89,6 +121,12 @@ var::const_iterator var::const_iterator::operator++(int) {
     switch (_iter.which()) {
     case type_vector :  return boost::get<vector_type::iterator&>(_iter)++;
     case type_map :     return boost::get<map_type::iterator&>(_iter)++;
+    case type_persistent_vector :
+    case type_persistent_map : {
+        const_iterator result(*this);
+        ++*this;
+        return result;
+    }
     default :           throw exception("unhandled iter++");
     }
 }
@@ -100,6 +138,8 @@ var::const_iterator var::const_iterator::operator--() {
     switch (_iter.which()) {
     case type_vector :  return --boost::get<vector_type::iterator&>(_iter);
     case type_map :     return --boost::get<map_type::iterator&>(_iter);
+    case type_persistent_vector :   boost::get<pvector_iterator&>(_iter).prev(); return *this;
+    case type_persistent_map :      boost::get<pmap_iterator&>(_iter).prev(); return *this;
     default :           throw exception("unhandled --iter");
     }
 }
@@ -111,6 +151,12 @@ var::const_iterator var::const_iterator::operator--(int) {
     switch (_iter.which()) {
     case type_vector :  return boost::get<vector_type::iterator&>(_iter)--;
     case type_map :     return boost::get<map_type::iterator&>(_iter)++;
+    case type_persistent_vector :
+    case type_persistent_map : {
+        const_iterator result(*this);
+        --*this;
+        return result;
+    }
     default :           throw exception("unhandled iter--");
     }
 }
@@ -128,7 +174,7 @@ struct are_strict_equals : public boost::static_visitor<bool> {
 ///
 /// test two vars for equality
 ///
-bool var::const_iterator::operator==(var::const_iterator rhs) {
+bool var::const_iterator::operator==(var::const_iterator rhs) const {
     return boost::apply_visitor(are_strict_equals(), _iter, rhs._iter);
 }
 
@@ -139,11 +185,18 @@ const var& var::const_iterator::operator*() const {
     switch (_iter.which()) {
     case type_vector :  return *boost::get<vector_type::iterator>(_iter);
     case type_map :     return const_cast<var&>(boost::get<map_type::iterator>(_iter)->first);
+    case type_persistent_vector :   return boost::get<pvector_iterator>(_iter).get();
+    case type_persistent_map :      return boost::get<pmap_iterator>(_iter).get().first;
     default :           throw exception("invalid operator*() operation");
     }
 }
 
 var& var::iterator::operator*() {
+    // readers may share a frozen collection, so nothing is written into it
+    if (_read_only) throw exception("cannot modify a frozen collection through an iterator");
+    // persistent nodes may be shared with other versions, so they are never modified through an iterator
+    if (_iter.which() == const_iterator::type_persistent_vector)
+        throw exception("cannot modify a persistent vector through an iterator");
     const var& result = static_cast<var::const_iterator *>(this)->operator*();  // Call const_iterator::operator*()
     return const_cast<var&>(result);
 }
@@ -154,11 +207,15 @@ var& var::iterator::operator*() {
 const var::pair_type& var::const_iterator::pair() const {
     switch (_iter.which()) {
     case type_map : return *boost::get<map_type::iterator>(_iter);
+    case type_persistent_map : return boost::get<pmap_iterator>(_iter).get();
     default : throw exception("invalid .value() operation");
     }
 }
 
 var::pair_type& var::iterator::pair() {
+    if (_read_only) throw exception("cannot modify a frozen collection through an iterator");
+    if (_iter.which() == const_iterator::type_persistent_map)
+        throw exception("cannot modify a persistent map through an iterator");
     const var::pair_type& result = static_cast<var::const_iterator *>(this)->pair();  // Call const_iterator::pair())
     return const_cast<var::pair_type&>(result);
 }
@@ -167,6 +224,8 @@ var::pair_type& var::iterator::pair() {
 /// @return reverse_iterator to last item in collection
 ///
 var::reverse_iterator var::rbegin() {
+    // a reverse_iterator only marks a position, so a frozen collection needs no check
+    detach();
     switch (type()) {
     case type_null :    throw exception("invalid .rbegin() operation on none");
     case type_int :     throw exception("invalid .rbegin() operation on int");
@@ -175,6 +234,8 @@ var::reverse_iterator var::rbegin() {
     case type_wstring : throw exception("invalid .rbegin() operation on wstring");
     case type_vector :  return boost::get<vector_ptr>(_var)->rbegin();
     case type_map :     return boost::get<map_ptr>(_var)->rbegin();
+    case type_persistent_vector :   throw exception("invalid .rbegin() operation on persistent vector");
+    case type_persistent_map :      throw exception("invalid .rbegin() operation on persistent map");
     default :           throw exception("unhandled .rbegin() operation");
     }
 }
@@ -183,6 +244,7 @@ var::reverse_iterator var::rbegin() {
 /// @return reverse_iterator preceding first item in collection
 ///
 var::reverse_iterator var::rend() {
+    detach();
     switch (type()) {
     case type_null :    throw exception("invalid .rend() operation on none");
     case type_int :     throw exception("invalid .rend() operation on int");
@@ -191,6 +253,8 @@ var::reverse_iterator var::rend() {
     case type_wstring : throw exception("invalid .rend() operation on wstring");
     case type_vector :  return boost::get<vector_ptr>(_var)->rend();
     case type_map :     return boost::get<map_ptr>(_var)->rend();
+    case type_persistent_vector :   throw exception("invalid .rend() operation on persistent vector");
+    case type_persistent_map :      throw exception("invalid .rend() operation on persistent map");
     default :           throw exception("unhandled .rend() operation");
     }
 }
@@ -200,8 +264,8 @@ var::reverse_iterator var::rend() {
 ///
 var::reverse_iterator var::reverse_iterator::operator++() {
     switch (_riter.which()) {
-    case type_vector :  return ++boost::get<vector_type::reverse_iterator&>(_riter);
-    case type_map :     return ++boost::get<map_type::reverse_iterator&>(_riter);
+    case type_vector :  --boost::get<vector_type::iterator&>(_riter); return *this;
+    case type_map :     --boost::get<map_type::iterator&>(_riter); return *this;
     default :           throw exception("unhandled ++riter");
     }
 }
@@ -210,11 +274,9 @@ var::reverse_iterator var::reverse_iterator::operator++() {
 /// post-increment reverse_iterator
 ///
 var::reverse_iterator var::reverse_iterator::operator++(int) {
-    switch (_riter.which()) {
-    case type_vector :  return boost::get<vector_type::reverse_iterator&>(_riter)++;
-    case type_map :     return boost::get<map_type::reverse_iterator&>(_riter)++;
-    default :           throw exception("unhandled riter++");
-    }
+    reverse_iterator result(*this);
+    ++*this;
+    return result;
 }
 
 ///
@@ -222,8 +284,8 @@ var::reverse_iterator var::reverse_iterator::operator++(int) {
 ///
 var::reverse_iterator var::reverse_iterator::operator--() {
     switch (_riter.which()) {
-    case type_vector :  return --boost::get<vector_type::reverse_iterator&>(_riter);
-    case type_map :     return --boost::get<map_type::reverse_iterator&>(_riter);
+    case type_vector :  ++boost::get<vector_type::iterator&>(_riter); return *this;
+    case type_map :     ++boost::get<map_type::iterator&>(_riter); return *this;
     default :           throw exception("unhandled --riter");
     }
 }
@@ -232,11 +294,9 @@ var::reverse_iterator var::reverse_iterator::operator--() {
 /// post-decrement reverse_iterator
 ///
 var::reverse_iterator var::reverse_iterator::operator--(int) {
-    switch (_riter.which()) {
-    case type_vector :  return boost::get<vector_type::reverse_iterator&>(_riter)--;
-    case type_map :     return boost::get<map_type::reverse_iterator&>(_riter)++;
-    default :           throw exception("unhandled iter--");
-    }
+    reverse_iterator result(*this);
+    --*this;
+    return result;
 }
 
 ///
@@ -0,0 +1,178 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <set>
+#include <vector>
+
+#include <dynamic/traverse.hpp>
+#include <dynamic/var.hpp>
+
+#include "persistent.hpp"
+
+namespace dynamic {
+
+namespace {
+
+/// @return heap bytes behind s, 0 if it is stored in the string object itself
+template <typename String>
+std::size_t buffer_bytes(const String& s) {
+    const char* data = reinterpret_cast<const char*>(s.data());
+    const char* object = reinterpret_cast<const char*>(&s);
+    if (data >= object && data < object + sizeof(s)) return 0;
+    return (s.capacity() + 1) * sizeof(typename String::value_type);
+}
+
+/// estimated size of one map tree node: the entry plus parent, left and right links and a color
+const std::size_t map_entry_bytes = sizeof(var::pair_type) + 4 * sizeof(void*);
+
+}
+
+///
+/// add the heap storage of one node to a memory_report, skipping nodes already seen
+///
+/// Returns true when the members of the node still have to be walked. The members of a
+/// persistent collection or a slice are not reached through tree_walker: they sit in
+/// trie leaves or a parent vector that other vars may share, so each newly seen leaf or
+/// parent pushes its members onto pending instead, and the shared parts are walked once.
+///
+struct var::memory_usage_visitor : public boost::static_visitor<bool>
+{
+    memory_usage_visitor(memory_report& report, std::set<const void*>& seen, std::vector<const var*>& pending) :
+        report(report), seen(seen), pending(pending) {}
+
+    memory_report& report;
+    std::set<const void*>& seen;
+    std::vector<const var*>& pending;
+
+    /// @return true the first time p is seen, counting it as a node of kind
+    bool first(const void* p, payload_kind kind) const {
+        if (!seen.insert(p).second) return false;
+        ++report.nodes[kind];
+        return true;
+    }
+
+    template <typename T>
+    result_type operator () (const T&) const { return false; }
+    result_type operator () (const string_t& value) const
+    {
+        if (first(value.ps.get(), payload_string))
+            report.bytes[payload_string] += sizeof(string_node) + buffer_bytes<string_storage>(*value.ps);
+        return false;
+    }
+    result_type operator () (const wstring_t& value) const
+    {
+        if (first(value.ps.get(), payload_wstring))
+            report.bytes[payload_wstring] += sizeof(wstring_node) + buffer_bytes<wstring_storage>(*value.ps);
+        return false;
+    }
+    result_type operator () (const vector_ptr& ptr) const
+    {
+        if (!first(ptr.get(), payload_vector)) return false;
+        report.bytes[payload_vector] += sizeof(vector_node) + ptr->capacity() * sizeof(var);
+        return true;
+    }
+    result_type operator () (const map_ptr& ptr) const
+    {
+        if (!first(ptr.get(), payload_map)) return false;
+        report.bytes[payload_map] += sizeof(map_node) + ptr->size() * map_entry_bytes;
+        return true;
+    }
+    // a slice keeps the whole vector it shares alive
+    result_type operator () (const slice_t& slice) const
+    {
+        if (!first(slice.parent.get(), payload_vector)) return false;
+        report.bytes[payload_vector] += sizeof(vector_node) + slice.parent->capacity() * sizeof(var);
+        for (vector_type::const_iterator it = slice.parent->begin(); it != slice.parent->end(); ++it)
+            pending.push_back(&*it);
+        return false;
+    }
+
+    // nodes of a persistent tree are shared between versions, so each one is counted once
+
+    result_type operator () (const pvector_ptr& ptr) const
+    {
+        if (!first(ptr.get(), payload_persistent)) return false;
+        report.bytes[payload_persistent] += sizeof(pvector_node);
+        std::vector<const pvector_node::node*> nodes(1, ptr->root.get());
+        nodes.push_back(ptr->tail.get());
+        while (!nodes.empty()) {
+            const pvector_node::node* n = nodes.back();
+            nodes.pop_back();
+            if (!first(n, payload_persistent)) continue;
+            report.bytes[payload_persistent] += sizeof(*n) + n->items.capacity() * sizeof(var)
+                                              + n->children.capacity() * sizeof(pvector_node::node_ptr);
+            for (std::size_t i = 0; i < n->items.size(); ++i)
+                pending.push_back(&n->items[i]);
+            for (std::size_t i = 0; i < n->children.size(); ++i)
+                nodes.push_back(n->children[i].get());
+        }
+        return false;
+    }
+    result_type operator () (const pmap_ptr& ptr) const
+    {
+        if (!first(ptr.get(), payload_persistent)) return false;
+        report.bytes[payload_persistent] += sizeof(pmap_node);
+        std::vector<const hamt_node*> nodes(1, ptr->root.get());
+        while (!nodes.empty()) {
+            const hamt_node* n = nodes.back();
+            nodes.pop_back();
+            if (!first(n, payload_persistent)) continue;
+            report.bytes[payload_persistent] += sizeof(*n) + n->entries.capacity() * sizeof(pair_type)
+                                              + n->children.capacity() * sizeof(pmap_node::node_ptr);
+            for (std::size_t i = 0; i < n->entries.size(); ++i) {
+                pending.push_back(&n->entries[i].first);
+                pending.push_back(&n->entries[i].second);
+            }
+            for (std::size_t i = 0; i < n->children.size(); ++i)
+                nodes.push_back(n->children[i].get());
+        }
+        return false;
+    }
+};
+
+///
+/// walk a var tree and report the bytes it holds by payload kind
+///
+/// Each var on the pending stack is walked with a tree_walker, so neither deep nesting
+/// nor long chains of persistent collections grow the call stack.
+///
+memory_report memory_usage(const var& v) {
+    memory_report report;
+    report.inline_bytes = sizeof(var);
+    std::set<const void*> seen;
+    std::vector<const var*> pending(1, &v);
+    const var::memory_usage_visitor count(report, seen, pending);
+    while (!pending.empty()) {
+        const var& root = *pending.back();
+        pending.pop_back();
+        for (tree_walker w(root); w.next(); )
+            if (w.event() != tree_walker::leave && !boost::apply_visitor(count, w.node()._var) &&
+                w.event() == tree_walker::enter)
+                w.skip();
+    }
+    return report;
+}
+
+}
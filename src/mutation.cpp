@@ -0,0 +1,234 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <iterator>
+#include <utility>
+
+#include <dynamic/exception.hpp>
+#include <dynamic/var.hpp>
+
+#include "persistent.hpp"
+
+namespace dynamic {
+
+///
+/// @return the vector of this var, detached so it can be modified
+///
+/// A slice becomes a vector of its own first. Throws invalid for any other type and
+/// frozen for a frozen vector.
+///
+var::vector_node& var::vector_for_update(const char* invalid, const char* frozen) {
+    detach();
+    if (type() != type_vector) throw exception(invalid);
+    vector_node& items = *boost::get<vector_ptr>(_var);
+    if (items.frozen) throw exception(frozen);
+    return items;
+}
+
+///
+/// @return the map of this var, detached so it can be modified
+///
+var::map_node& var::map_for_update(const char* invalid, const char* frozen) {
+    detach();
+    if (type() != type_map) throw exception(invalid);
+    map_node& entries = *boost::get<map_ptr>(_var);
+    if (entries.frozen) throw exception(frozen);
+    return entries;
+}
+
+///
+/// remove the item at index key from a vector, or the entry with key from a map
+///
+/// Erasing a key a map does not hold does nothing.
+///
+var& var::erase(const var& key) {
+    if (type() == type_map) {
+        map_node& entries = map_for_update("invalid erase() operation", "invalid erase() operation on frozen map");
+        entries.erase(key);
+        return *this;
+    }
+    vector_node& items = vector_for_update("invalid erase() operation", "invalid erase() operation on frozen vector");
+    if (!key.is_int()) throw exception("erase() on a vector requires int");
+    const int n = key;
+    if (n < 0 || size_type(n) >= items.size()) throw exception("erase() index out of range");
+    items.erase(items.begin() + n);
+    return *this;
+}
+
+///
+/// remove the items [first, last) from a vector
+///
+var& var::erase(size_type first, size_type last) {
+    vector_node& items = vector_for_update("invalid erase(,) operation", "invalid erase(,) operation on frozen vector");
+    if (first > last || last > items.size()) throw exception("erase(,) range out of range");
+    items.erase(items.begin() + first, items.begin() + last);
+    return *this;
+}
+
+///
+/// insert v into a vector before the item at index, or at the end if index is count()
+///
+var& var::insert(size_type index, const var& v) {
+    vector_node& items = vector_for_update("invalid insert() operation", "invalid insert() operation on frozen vector");
+    if (index > items.size()) throw exception("insert() index out of range");
+    items.insert(items.begin() + index, v);
+    return *this;
+}
+
+var& var::insert(size_type index, var&& v) {
+    vector_node& items = vector_for_update("invalid insert() operation", "invalid insert() operation on frozen vector");
+    if (index > items.size()) throw exception("insert() index out of range");
+    items.insert(items.begin() + index, std::move(v));
+    return *this;
+}
+
+///
+/// remove the last item of a vector
+///
+var& var::pop_back() {
+    vector_node& items = vector_for_update("invalid pop_back() operation", "invalid pop_back() operation on frozen vector");
+    if (items.empty()) throw exception("pop_back() on empty vector");
+    items.pop_back();
+    return *this;
+}
+
+///
+/// remove every member of a collection
+///
+/// A shared collection is not copied first, this var just takes a new empty one.
+///
+var& var::clear() {
+    switch (type()) {
+    case type_vector : {
+        vector_node& items = *boost::get<vector_ptr>(_var);
+        if (items.frozen) throw exception("invalid clear() operation on frozen vector");
+        if (items.unique()) items.clear();
+        else *this = make_vector();
+        return *this;
+    }
+    case type_map : {
+        map_node& entries = *boost::get<map_ptr>(_var);
+        if (entries.frozen) throw exception("invalid clear() operation on frozen map");
+        if (entries.unique()) entries.clear();
+        else *this = make_map();
+        return *this;
+    }
+    case type_persistent_vector :
+        if (boost::get<pvector_ptr>(_var)->frozen) throw exception("invalid clear() operation on frozen persistent vector");
+        *this = make_persistent_vector();
+        return *this;
+    case type_persistent_map :
+        if (boost::get<pmap_ptr>(_var)->frozen) throw exception("invalid clear() operation on frozen persistent map");
+        *this = make_persistent_map();
+        return *this;
+    case type_slice :
+        *this = make_vector();
+        return *this;
+    default :
+        throw exception("invalid clear() operation");
+    }
+}
+
+///
+/// make room for n items in a vector, so appending up to n items does not reallocate
+///
+var& var::reserve(size_type n) {
+    vector_for_update("invalid reserve() operation", "invalid reserve() operation on frozen vector").reserve(n);
+    return *this;
+}
+
+///
+/// release the storage a vector holds beyond its items
+///
+var& var::shrink_to_fit() {
+    vector_for_update("invalid shrink_to_fit() operation", "invalid shrink_to_fit() operation on frozen vector").shrink_to_fit();
+    return *this;
+}
+
+///
+/// move every member of source into this collection
+///
+/// Vector items are appended. Map entries are moved unless this map already has their
+/// key, those stay in source, as operator () does not overwrite an existing key either.
+///
+var& var::splice(var& source) {
+    if (&source == this) return *this;
+    if (type() == type_map) {
+        map_node& entries = map_for_update("invalid splice() operation", "invalid splice() operation on frozen map");
+        map_node& from = source.map_for_update("splice() source must be a map", "invalid splice() operation on frozen map");
+        if (entries.get_allocator() == from.get_allocator()) {
+            entries.merge(from);
+            return *this;
+        }
+        // nodes only move between maps using the same memory resource
+        for (map_type::iterator it = from.begin(); it != from.end();) {
+            if (entries.emplace(it->first, std::move(it->second)).second) it = from.erase(it);
+            else ++it;
+        }
+        return *this;
+    }
+    return splice(count(), source);
+}
+
+///
+/// move the entry with key from the map source into this map
+///
+/// The entry's node is unlinked from source and linked into this map, so neither its key
+/// nor its value is copied. Nothing happens if source does not hold key or this map
+/// already does.
+///
+var& var::splice(var& source, const var& key) {
+    if (&source == this) return *this;
+    map_node& entries = map_for_update("invalid splice(,) operation", "invalid splice(,) operation on frozen map");
+    map_node& from = source.map_for_update("splice(,) source must be a map", "invalid splice(,) operation on frozen map");
+    map_type::iterator it = from.find(key);
+    if (it == from.end() || entries.find(key) != entries.end()) return *this;
+    if (entries.get_allocator() == from.get_allocator()) {
+        entries.insert(from.extract(it));
+    }
+    else {
+        // nodes only move between maps using the same memory resource
+        entries.emplace(it->first, std::move(it->second));
+        from.erase(it);
+    }
+    return *this;
+}
+
+///
+/// move every item of the vector source into this vector before the item at index
+///
+/// The items are moved, not copied, and source is left empty.
+///
+var& var::splice(size_type index, var& source) {
+    if (&source == this) throw exception("splice() of a vector into itself");
+    vector_node& items = vector_for_update("invalid splice() operation", "invalid splice() operation on frozen vector");
+    vector_node& from = source.vector_for_update("splice() source must be a vector", "invalid splice() operation on frozen vector");
+    if (index > items.size()) throw exception("splice() index out of range");
+    items.insert(items.begin() + index, std::make_move_iterator(from.begin()), std::make_move_iterator(from.end()));
+    from.clear();
+    return *this;
+}
+
+}
@@ -0,0 +1,188 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <climits>
+
+#include <dynamic/exception.hpp>
+#include <dynamic/path.hpp>
+
+#include "persistent.hpp"
+
+namespace dynamic {
+
+///
+/// ctor: the whole document
+///
+path::path() {}
+
+///
+/// ctor: parse a JSON Pointer
+///
+path::path(const std::string& pointer) : _pointer(pointer) { parse(); }
+
+///
+/// ctor: parse a JSON Pointer
+///
+path::path(const char* pointer) : _pointer(pointer) { parse(); }
+
+///
+/// split the pointer into segments and build their keys
+///
+void path::parse() {
+    if (_pointer.empty()) return;
+    if (_pointer[0] != '/') throw exception("path must start with '/'");
+    std::string::size_type start = 1;
+    for (;;) {
+        std::string::size_type end = _pointer.find('/', start);
+        if (end == std::string::npos) end = _pointer.size();
+
+        std::string name;
+        for (std::string::size_type i = start; i < end; ++i) {
+            if (_pointer[i] != '~') {
+                name += _pointer[i];
+                continue;
+            }
+            if (i + 1 == end || (_pointer[i + 1] != '0' && _pointer[i + 1] != '1'))
+                throw exception("invalid escape in path");
+            name += _pointer[++i] == '0' ? '~' : '/';
+        }
+
+        segment s;
+        s.key = name;
+        s.index = npos;
+        s.append = name == "-";
+        // an index has no leading zeros and fits in an int key
+        if (!name.empty() && name.size() <= 9 && name.find_first_not_of("0123456789") == std::string::npos &&
+            (name.size() == 1 || name[0] != '0')) {
+            s.index = std::stoi(name);
+            s.int_key = int(s.index);
+        }
+        _segments.push_back(s);
+
+        if (end == _pointer.size()) break;
+        start = end + 1;
+    }
+}
+
+///
+/// @return the var the path leads to in doc, or 0 if there is none
+///
+const var* path::find(const var& doc) const {
+    const var* node = &doc;
+    for (std::vector<segment>::const_iterator s = _segments.begin(); s != _segments.end(); ++s) {
+        switch (node->type()) {
+        case var::type_vector : {
+            const var::vector_type& items = *boost::get<var::vector_ptr>(node->_var);
+            if (s->index >= items.size()) return 0;
+            node = &items[s->index];
+            break;
+        }
+        case var::type_slice : {
+            const var::slice_t& window = boost::get<var::slice_t>(node->_var);
+            if (s->index >= window.length) return 0;
+            node = &(*window.parent)[window.offset + s->index];
+            break;
+        }
+        case var::type_map : {
+            const var::map_type& entries = *boost::get<var::map_ptr>(node->_var);
+            var::map_type::const_iterator it = entries.find(s->key);
+            if (it == entries.end() && s->index != npos) it = entries.find(s->int_key);
+            if (it == entries.end()) return 0;
+            node = &it->second;
+            break;
+        }
+        case var::type_persistent_vector : {
+            const var::pvector_node& items = *boost::get<var::pvector_ptr>(node->_var);
+            if (s->index >= items.size) return 0;
+            node = &items.at(s->index);
+            break;
+        }
+        case var::type_persistent_map : {
+            const var::pmap_node& entries = *boost::get<var::pmap_ptr>(node->_var);
+            const var::pair_type* entry = entries.find(s->key);
+            if (!entry && s->index != npos) entry = entries.find(s->int_key);
+            if (!entry) return 0;
+            node = &entry->second;
+            break;
+        }
+        default :
+            return 0;
+        }
+    }
+    return node;
+}
+
+///
+/// @return true if a map or persistent map holds key
+///
+bool path::has_key(const var& map, const var& key) {
+    if (map.is_map()) {
+        const var::map_type& entries = *boost::get<var::map_ptr>(map._var);
+        return entries.find(key) != entries.end();
+    }
+    return boost::get<var::pmap_ptr>(map._var)->find(key) != 0;
+}
+
+///
+/// store value at the path in doc, creating what is missing on the way
+///
+/// A null var on the way, doc included, becomes a vector if the next segment is an
+/// index or "-", and a map otherwise. In a vector, the index one past the last item
+/// and "-" append. Collections on the way are detached first, so vars sharing them
+/// are not affected.
+///
+/// @return the stored value
+///
+var& path::set(var& doc, const var& value) const {
+    var* node = &doc;
+    for (std::vector<segment>::const_iterator s = _segments.begin(); s != _segments.end(); ++s) {
+        if (node->is_null())
+            *node = (s->index != npos || s->append) ? make_vector() : make_map();
+        if (node->is_vector() || node->is_persistent_vector() || node->is_slice()) {
+            const var::size_type count = node->count();
+            if (s->append || s->index == count) {
+                (*node)(none);
+                node = &(*node)[int(count)];
+            }
+            else if (s->index < count) {
+                node = &(*node)[int(s->index)];
+            }
+            else {
+                throw exception(s->index == npos ? "path segment is not a vector index" : "path index out of range");
+            }
+        }
+        else if (node->is_map() || node->is_persistent_map()) {
+            const var& key = (s->index != npos && !has_key(*node, s->key) && has_key(*node, s->int_key)) ? s->int_key : s->key;
+            node = &(*node)[key];
+        }
+        else {
+            throw exception("path leads through a scalar");
+        }
+    }
+    *node = value;
+    return *node;
+}
+
+}
@@ -0,0 +1,378 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+
+#include <dynamic/exception.hpp>
+#include <dynamic/var.hpp>
+
+#include "persistent.hpp"
+
+namespace dynamic {
+
+namespace {
+
+///
+/// make p the only reference to its node, copying the node if it is shared
+///
+template <typename T>
+void own(boost::intrusive_ptr<T>& p) {
+    if (!p->unique()) p = new T(*p);
+}
+
+/// @return number of bits set
+unsigned popcount(boost::uint32_t bits) {
+    bits = bits - ((bits >> 1) & 0x55555555);
+    bits = (bits & 0x33333333) + ((bits >> 2) & 0x33333333);
+    return (((bits + (bits >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24;
+}
+
+/// @return 32 bits of hash for the trie
+boost::uint32_t hash32(const var& key) {
+    std::size_t h = hash_value(key);
+    return boost::uint32_t(h ^ (h >> 16 >> 16));
+}
+
+/// @return true if a and b are the same key under less_var
+bool same_key(const var& a, const var& b) {
+    var::less_var less;
+    return !less(a, b) && !less(b, a);
+}
+
+/// orders entries by key
+struct less_entry {
+    bool operator () (const var::pair_type& lhs, const var& rhs) const { return var::less_var()(lhs.first, rhs); }
+};
+
+// pair_type is not assignable, so entries are inserted and erased by rebuilding the vector
+
+template <typename Entries>
+void insert_entry(Entries& entries, std::size_t pos, const var::pair_type& entry) {
+    Entries result(entries.get_allocator());
+    result.reserve(entries.size() + 1);
+    for (std::size_t i = 0; i < pos; ++i) result.push_back(entries[i]);
+    result.push_back(entry);
+    for (std::size_t i = pos; i < entries.size(); ++i) result.push_back(entries[i]);
+    entries.swap(result);
+}
+
+template <typename Entries>
+void erase_entry(Entries& entries, std::size_t pos) {
+    Entries result(entries.get_allocator());
+    result.reserve(entries.size() - 1);
+    for (std::size_t i = 0; i < entries.size(); ++i)
+        if (i != pos) result.push_back(entries[i]);
+    entries.swap(result);
+}
+
+}
+
+///
+/// create empty persistent vector
+///
+var make_persistent_vector() { return var(var::pvector_ptr(new var::pvector_node)); }
+
+///
+/// create empty persistent map
+///
+var make_persistent_map() { return var(var::pmap_ptr(new var::pmap_node)); }
+
+/// take a reference to a persistent vector
+void intrusive_ptr_add_ref(const var::pvector_node* p) { p->add_ref(); }
+/// drop a reference to a persistent vector
+void intrusive_ptr_release(const var::pvector_node* p) { if (p->release()) detail::destroy_collection(p); }
+/// take a reference to a persistent map
+void intrusive_ptr_add_ref(const var::pmap_node* p) { p->add_ref(); }
+/// drop a reference to a persistent map
+void intrusive_ptr_release(const var::pmap_node* p) { if (p->release()) detail::destroy_collection(p); }
+
+///
+/// @return the items of the leaf holding index
+///
+const var* var::pvector_node::leaf_for(size_type index) const {
+    if (index >= tail_offset()) return tail->items.data();
+    const node* n = root.get();
+    for (unsigned level = shift; level > 0; level -= bits)
+        n = n->children[(index >> level) & mask].get();
+    return n->items.data();
+}
+
+///
+/// @return item at index, which must be in range
+///
+const var& var::pvector_node::at(size_type index) const {
+    return leaf_for(index)[index & mask];
+}
+
+///
+/// @return modifiable item at index, copying the shared nodes on its path
+///
+/// The nodes on the path are marked unshareable, as the item may be modified through
+/// the reference after this version has been copied.
+///
+var& var::pvector_node::update(size_type index) {
+    unshareable = true;
+    if (index >= tail_offset()) {
+        own(tail);
+        tail->unshareable = true;
+        return tail->items[index & mask];
+    }
+    node_ptr* n = &root;
+    own(*n);
+    (*n)->unshareable = true;
+    for (unsigned level = shift; level > 0; level -= bits) {
+        n = &(*n)->children[(index >> level) & mask];
+        own(*n);
+        (*n)->unshareable = true;
+    }
+    return (*n)->items[index & mask];
+}
+
+///
+/// append an item
+///
+void var::pvector_node::push_back(const var& value) {
+    if (size - tail_offset() < size_type(width)) {
+        own(tail);
+        tail->items.push_back(value);
+        ++size;
+        return;
+    }
+    // the tail is full, move it into the tree
+    if ((size >> bits) > (size_type(1) << shift)) {
+        // the tree is full, grow a new root
+        node_ptr grown = node_ptr(new node);
+        grown->children.push_back(root);
+        grown->children.push_back(new_path(shift, tail));
+        root = grown;
+        shift += bits;
+    } else {
+        push_tail(shift, root, tail);
+    }
+    tail = node_ptr(new node);
+    tail->items.reserve(width);
+    tail->items.push_back(value);
+    ++size;
+}
+
+void var::pvector_node::push_tail(unsigned level, node_ptr& parent, const node_ptr& leaf) {
+    own(parent);
+    const size_type sub = ((size - 1) >> level) & mask;
+    if (level == unsigned(bits))
+        parent->children.push_back(leaf);
+    else if (sub < parent->children.size())
+        push_tail(level - bits, parent->children[sub], leaf);
+    else
+        parent->children.push_back(new_path(level - bits, leaf));
+}
+
+var::pvector_node::node_ptr var::pvector_node::new_path(unsigned level, const node_ptr& leaf) {
+    if (level == 0) return leaf;
+    node_ptr n = node_ptr(new node);
+    n->children.push_back(new_path(level - bits, leaf));
+    return n;
+}
+
+///
+/// @return entry for key, or 0 if there is none
+///
+const var::pair_type* var::pmap_node::find(const var& key) const {
+    const boost::uint32_t hash = hash32(key);
+    const hamt_node* n = root.get();
+    for (unsigned shift = 0; ; shift += bits) {
+        if (shift >= unsigned(collision_shift)) {
+            hamt_node::entry_list::const_iterator it = std::lower_bound(n->entries.begin(), n->entries.end(), key, less_entry());
+            return ((it != n->entries.end()) && same_key(it->first, key)) ? &*it : 0;
+        }
+        const boost::uint32_t bit = boost::uint32_t(1) << ((hash >> shift) & mask);
+        if (n->datamap & bit) {
+            const pair_type& entry = n->entries[popcount(n->datamap & (bit - 1))];
+            return same_key(entry.first, key) ? &entry : 0;
+        }
+        if (!(n->nodemap & bit)) return 0;
+        n = n->children[popcount(n->nodemap & (bit - 1))].get();
+    }
+}
+
+///
+/// @return modifiable value for key, copying the shared nodes on its path, or 0 if there is none
+///
+/// The nodes on the path are marked unshareable, as for pvector_node::update().
+///
+var* var::pmap_node::update(const var& key) {
+    if (!find(key)) return 0;
+    unshareable = true;
+    const boost::uint32_t hash = hash32(key);
+    node_ptr* n = &root;
+    own(*n);
+    for (unsigned shift = 0; ; shift += bits) {
+        hamt_node& node = **n;
+        node.unshareable = true;
+        if (shift >= unsigned(collision_shift))
+            return &std::lower_bound(node.entries.begin(), node.entries.end(), key, less_entry())->second;
+        const boost::uint32_t bit = boost::uint32_t(1) << ((hash >> shift) & mask);
+        if (node.datamap & bit) return &node.entries[popcount(node.datamap & (bit - 1))].second;
+        n = &node.children[popcount(node.nodemap & (bit - 1))];
+        own(*n);
+    }
+}
+
+///
+/// insert key,value unless key is present
+///
+/// @return modifiable value for key and true if it was inserted
+///
+std::pair<var*, bool> var::pmap_node::insert(const var& key, const var& value) {
+    return insert(root, hash32(key), 0, key, value);
+}
+
+std::pair<var*, bool> var::pmap_node::insert(node_ptr& n, boost::uint32_t hash, unsigned shift, const var& key, const var& value) {
+    own(n);
+    hamt_node& node = *n;
+    if (shift >= unsigned(collision_shift)) {
+        // keys whose hashes are equal are kept sorted
+        hamt_node::entry_list::iterator it = std::lower_bound(node.entries.begin(), node.entries.end(), key, less_entry());
+        if ((it != node.entries.end()) && same_key(it->first, key)) return std::make_pair(&it->second, false);
+        const std::size_t pos = it - node.entries.begin();
+        insert_entry(node.entries, pos, pair_type(key, value));
+        ++node.count;
+        return std::make_pair(&node.entries[pos].second, true);
+    }
+    const boost::uint32_t bit = boost::uint32_t(1) << ((hash >> shift) & mask);
+    if (node.datamap & bit) {
+        const std::size_t pos = popcount(node.datamap & (bit - 1));
+        if (same_key(node.entries[pos].first, key)) return std::make_pair(&node.entries[pos].second, false);
+        // two keys share this slot, push both down into a new child
+        node_ptr child = node_ptr(new hamt_node);
+        const pair_type existing = node.entries[pos];
+        insert(child, hash32(existing.first), shift + bits, existing.first, existing.second);
+        std::pair<var*, bool> result = insert(child, hash, shift + bits, key, value);
+        erase_entry(node.entries, pos);
+        node.datamap &= ~bit;
+        node.nodemap |= bit;
+        node.children.insert(node.children.begin() + popcount(node.nodemap & (bit - 1)), child);
+        ++node.count;
+        return result;
+    }
+    if (node.nodemap & bit) {
+        std::pair<var*, bool> result = insert(node.children[popcount(node.nodemap & (bit - 1))], hash, shift + bits, key, value);
+        if (result.second) ++node.count;
+        return result;
+    }
+    const std::size_t pos = popcount(node.datamap & (bit - 1));
+    insert_entry(node.entries, pos, pair_type(key, value));
+    node.datamap |= bit;
+    ++node.count;
+    return std::make_pair(&node.entries[pos].second, true);
+}
+
+///
+/// @return entry at position index in iteration order, and the node and offset holding it
+///
+const var::pair_type& var::pmap_node::entry_at(size_type index, const hamt_node** leaf, size_type* offset) const {
+    const hamt_node* n = root.get();
+    for (;;) {
+        if (index < n->entries.size()) {
+            *leaf = n;
+            *offset = index;
+            return n->entries[index];
+        }
+        index -= n->entries.size();
+        for (hamt_node::child_list::const_iterator it = n->children.begin(); it != n->children.end(); ++it) {
+            if (index < (*it)->count) {
+                n = it->get();
+                break;
+            }
+            index -= (*it)->count;
+        }
+    }
+}
+
+///
+/// ctor: position index in vec
+///
+var::pvector_iterator::pvector_iterator(const pvector_node* vec, size_type index)
+    : vec(vec), index(index), leaf(index < vec->size ? vec->leaf_for(index) : 0) {}
+
+///
+/// advance to the next item
+///
+void var::pvector_iterator::next() {
+    ++index;
+    if ((index & pvector_node::mask) == 0) leaf = index < vec->size ? vec->leaf_for(index) : 0;
+}
+
+///
+/// step back to the previous item
+///
+void var::pvector_iterator::prev() {
+    const bool crossing = !leaf || ((index & pvector_node::mask) == 0);
+    --index;
+    if (crossing) leaf = vec->leaf_for(index);
+}
+
+///
+/// @return item at the current position
+///
+const var& var::pvector_iterator::get() const {
+    if (!leaf) throw exception("persistent vector iterator out of range");
+    return leaf[index & pvector_node::mask];
+}
+
+///
+/// ctor: position index in map
+///
+var::pmap_iterator::pmap_iterator(const pmap_node* map, size_type index) : map(map), index(index), leaf(0), offset(0) {
+    if (index < map->size()) map->entry_at(index, &leaf, &offset);
+}
+
+///
+/// advance to the next entry
+///
+void var::pmap_iterator::next() {
+    ++index;
+    if (leaf && (offset + 1 < leaf->entries.size())) ++offset;
+    else if (index < map->size()) map->entry_at(index, &leaf, &offset);
+    else leaf = 0;
+}
+
+///
+/// step back to the previous entry
+///
+void var::pmap_iterator::prev() {
+    --index;
+    if (leaf && (offset > 0)) --offset;
+    else map->entry_at(index, &leaf, &offset);
+}
+
+///
+/// @return entry at the current position
+///
+const var::pair_type& var::pmap_iterator::get() const {
+    if (!leaf) throw exception("persistent map iterator out of range");
+    return leaf->entries[offset];
+}
+
+}
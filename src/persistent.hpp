@@ -0,0 +1,154 @@
+#ifndef DYNAMIC_PERSISTENT_HPP
+#define DYNAMIC_PERSISTENT_HPP
+
+/*
+    Copyright (C) 2009, Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Private to the library: storage of the persistent collection types.
+
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include <dynamic/var.hpp>
+
+namespace dynamic {
+
+///
+/// persistent vector: a 32-way radix balanced tree of leaves, plus a tail leaf for appends
+///
+/// Nodes are shared between versions. A version modifies a node in place only when it
+/// holds the only reference to it, otherwise the node is copied first, so an update
+/// copies at most one path of O(log n) nodes.
+///
+struct var::pvector_node : detail::ref_counted, detail::payload_node<payload_persistent> {
+    enum { bits = 5, width = 1 << bits, mask = width - 1 };
+
+    struct node;
+    typedef boost::intrusive_ptr<node> node_ptr;
+
+    /// a leaf holds items, a branch holds children
+    struct node : detail::ref_counted, detail::payload_node<payload_persistent> {
+        node() : unshareable(false) {}
+
+        std::vector<var, detail::payload_allocator<var, payload_persistent> > items;
+        std::vector<node_ptr, detail::payload_allocator<node_ptr, payload_persistent> > children;
+        /// set on the path to an item update() handed out
+        bool unshareable;
+
+        friend void intrusive_ptr_add_ref(const node* p) { p->add_ref(); }
+        friend void intrusive_ptr_release(const node* p) { if (p->release()) detail::destroy_collection(p); }
+    };
+
+    pvector_node() : size(0), shift(bits), root(new node), tail(new node), frozen(false), unshareable(false) {}
+
+    /// index of the first item in the tail
+    size_type tail_offset() const { return size < size_type(width) ? 0 : ((size - 1) >> bits) << bits; }
+
+    const var* leaf_for(size_type index) const;
+    const var& at(size_type index) const;
+    var& update(size_type index);
+    void push_back(const var& value);
+
+    size_type size;
+    unsigned shift;
+    node_ptr root;
+    node_ptr tail;
+    /// set by freeze(), rejects every later mutation
+    bool frozen;
+    /// set once update() has handed out an item, see var::unshare()
+    bool unshareable;
+    /// filled in by fingerprint_of() once frozen
+    detail::fingerprint_memo memo;
+
+private :
+    void push_tail(unsigned level, node_ptr& parent, const node_ptr& leaf);
+    static node_ptr new_path(unsigned level, const node_ptr& leaf);
+};
+
+///
+/// node of a hash array mapped trie
+///
+/// Entries stored directly in the node come first in iteration order, followed by the
+/// entries of each child. Below the last level of hash bits, keys that collide are
+/// kept in a single node sorted by less_var.
+///
+struct var::hamt_node : detail::ref_counted, detail::payload_node<payload_persistent> {
+    typedef std::vector<pair_type, detail::payload_allocator<pair_type, payload_persistent> > entry_list;
+    typedef std::vector<boost::intrusive_ptr<hamt_node>, detail::payload_allocator<boost::intrusive_ptr<hamt_node>, payload_persistent> > child_list;
+
+    hamt_node() : datamap(0), nodemap(0), count(0), unshareable(false) {}
+
+    /// bit set for each hash slot holding an entry
+    boost::uint32_t datamap;
+    /// bit set for each hash slot holding a child
+    boost::uint32_t nodemap;
+    entry_list entries;
+    child_list children;
+    /// number of entries in this subtree
+    size_type count;
+    /// set on the path to a value update() handed out
+    bool unshareable;
+
+    friend void intrusive_ptr_add_ref(const hamt_node* p) { p->add_ref(); }
+    friend void intrusive_ptr_release(const hamt_node* p) { if (p->release()) detail::destroy_collection(p); }
+};
+
+///
+/// persistent map: a hash array mapped trie keyed by hash_value()
+///
+/// Iteration order follows the hashes of the keys, not less_var. It only depends on the
+/// set of keys, so two persistent maps holding equal entries iterate in the same order.
+///
+struct var::pmap_node : detail::ref_counted, detail::payload_node<payload_persistent> {
+    enum { bits = 5, mask = (1 << bits) - 1, collision_shift = 35 };
+    typedef boost::intrusive_ptr<hamt_node> node_ptr;
+
+    pmap_node() : root(new hamt_node), frozen(false), unshareable(false) {}
+
+    /// number of entries
+    size_type size() const { return root->count; }
+
+    const pair_type* find(const var& key) const;
+    var* update(const var& key);
+    std::pair<var*, bool> insert(const var& key, const var& value);
+    const pair_type& entry_at(size_type index, const hamt_node** leaf, size_type* offset) const;
+
+    node_ptr root;
+    /// set by freeze(), rejects every later mutation
+    bool frozen;
+    /// set once update() has handed out a value, see var::unshare()
+    bool unshareable;
+    /// filled in by fingerprint_of() once frozen
+    detail::fingerprint_memo memo;
+
+private :
+    std::pair<var*, bool> insert(node_ptr& node, boost::uint32_t hash, unsigned shift, const var& key, const var& value);
+};
+
+}
+
+#endif // DYNAMIC_PERSISTENT_HPP
@@ -0,0 +1,516 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cctype>
+#include <cstdlib>
+#include <exception>
+#include <thread>
+
+#include <boost/make_shared.hpp>
+
+#include <dynamic/exception.hpp>
+#include <dynamic/path.hpp>
+#include <dynamic/query.hpp>
+
+namespace dynamic {
+
+///
+/// node of a compiled predicate
+///
+struct query::expr {
+    enum op_t { constant, field, equal, not_equal, less, less_equal, greater, greater_equal, and_, or_, not_, truthy };
+
+    explicit expr(op_t op) : op(op) {}
+
+    /// @return the var a constant or field operand stands for in v
+    const var& operand(const var& v) const {
+        if (op == constant) return value;
+        const var* found = at.find(v);
+        return found ? *found : none;
+    }
+
+    /// @return true if the predicate holds for v
+    bool test(const var& v) const {
+        switch (op) {
+        case equal :            return same(lhs->operand(v), rhs->operand(v));
+        case not_equal :        return !same(lhs->operand(v), rhs->operand(v));
+        case less :             return order(lhs->operand(v), rhs->operand(v)) < 0;
+        case less_equal :       return order(lhs->operand(v), rhs->operand(v)) <= 0;
+        case greater :          return order(lhs->operand(v), rhs->operand(v)) > 0;
+        case greater_equal :    return order(lhs->operand(v), rhs->operand(v)) >= 0;
+        case and_ :             return lhs->test(v) && rhs->test(v);
+        case or_ :              return lhs->test(v) || rhs->test(v);
+        case not_ :             return !lhs->test(v);
+        case truthy :           { const var& x = lhs->operand(v); return !x.is_null() && !(x.is_bool() && !bool(x)); }
+        default :               throw exception("invalid query predicate");
+        }
+    }
+
+    /// @return true if every field the predicate reads starts with one of names
+    bool reads_only(const std::vector<std::string>& names) const {
+        if (op == constant) return true;
+        if (op == field) {
+            for (std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it)
+                if (at.str() == *it || at.str().compare(0, it->size() + 1, *it + "/") == 0) return true;
+            return false;
+        }
+        return lhs->reads_only(names) && (!rhs || rhs->reads_only(names));
+    }
+
+    /// replace the leading pointer from[i] of every field by to[i]
+    void rebase(const std::vector<std::string>& from, const std::vector<path>& to) {
+        if (op == field) {
+            for (std::size_t i = 0; i < from.size(); ++i)
+                if (at.str() == from[i] || at.str().compare(0, from[i].size() + 1, from[i] + "/") == 0) {
+                    at = path(to[i].str() + at.str().substr(from[i].size()));
+                    return;
+                }
+            return;
+        }
+        if (lhs) lhs->rebase(from, to);
+        if (rhs) rhs->rebase(from, to);
+    }
+
+    static bool numeric(const var& v) { return v.is_int() || v.is_double(); }
+    static double number(const var& v) { return v.is_int() ? int(v) : double(v); }
+
+    /// equality, with ints and doubles compared by value
+    static bool same(const var& lhs, const var& rhs) {
+        if (numeric(lhs) && numeric(rhs)) return number(lhs) == number(rhs);
+        return lhs == rhs;
+    }
+
+    /// less_var order, with ints and doubles compared by value
+    static int order(const var& lhs, const var& rhs) {
+        if (numeric(lhs) && numeric(rhs)) {
+            const double l = number(lhs), r = number(rhs);
+            return l < r ? -1 : r < l ? 1 : 0;
+        }
+        return var::compare(lhs, rhs);
+    }
+
+    op_t op;
+    var value;
+    path at;
+    boost::shared_ptr<expr> lhs;
+    boost::shared_ptr<expr> rhs;
+};
+
+///
+/// stage of a compiled pipeline
+///
+struct query::stage {
+    enum kind_t { get, iterate, select, project };
+
+    explicit stage(kind_t kind) : kind(kind) {}
+
+    /// run v through this stage and the ones after it, appending the results to out
+    void push(const var& v, std::vector<var>& out) const {
+        switch (kind) {
+        case get : {
+            const var* found = at.find(v);
+            emit(found ? *found : none, out);
+            break;
+        }
+        case iterate : {
+            const var* items = at.find(v);
+            if (!items) break;
+            if (items->is_vector() || items->is_persistent_vector() || items->is_slice())
+                emit_range(*items, 0, items->count(), out);
+            else if (items->is_map() || items->is_persistent_map())
+                for (var::const_iterator it = items->begin(); it != items->end(); ++it)
+                    emit(it.pair().second, out);
+            break;
+        }
+        case select :
+            if (predicate->test(v)) emit(v, out);
+            break;
+        case project : {
+            var result = make_map();
+            for (std::size_t i = 0; i < names.size(); ++i) {
+                const var* found = fields[i].find(v);
+                result(names[i], found ? *found : none);
+            }
+            emit(result, out);
+            break;
+        }
+        }
+    }
+
+    /// pass elements [begin, end) of a vector to the next stage
+    void emit_range(const var& items, var::size_type begin, var::size_type end, std::vector<var>& out) const {
+        for (var::size_type i = begin; i < end; ++i)
+            emit(items[int(i)], out);
+    }
+
+    void emit(const var& v, std::vector<var>& out) const {
+        if (next) next->push(v, out);
+        else out.push_back(v);
+    }
+
+    kind_t kind;
+    /// path of get and iterate
+    path at;
+    boost::shared_ptr<expr> predicate;
+    /// names and paths of the fields of project
+    std::vector<std::string> names;
+    std::vector<path> fields;
+    boost::shared_ptr<const stage> next;
+};
+
+///
+/// recursive descent parser from query text to a pipeline
+///
+class query::parser {
+public :
+    explicit parser(const std::string& text) : _text(text), _pos(0) {}
+
+    /// @return the stages of the whole query, in order
+    std::vector<boost::shared_ptr<stage> > pipeline() {
+        std::vector<boost::shared_ptr<stage> > stages;
+        do {
+            skip_space();
+            if (keyword("select")) {
+                expect('(');
+                boost::shared_ptr<stage> s = boost::make_shared<stage>(stage::select);
+                s->predicate = disjunction();
+                expect(')');
+                stages.push_back(s);
+            }
+            else if (peek() == '{') {
+                stages.push_back(projection());
+            }
+            else if (peek() == '.') {
+                std::vector<std::string> pointers;
+                bool iterates = path_expression(pointers);
+                for (std::size_t i = 0; i < pointers.size(); ++i) {
+                    const bool last = i + 1 == pointers.size();
+                    if (last && !iterates && pointers[i].empty()) break; // . passes its input on
+                    boost::shared_ptr<stage> s = boost::make_shared<stage>(last && !iterates ? stage::get : stage::iterate);
+                    s->at = path(pointers[i]);
+                    stages.push_back(s);
+                }
+            }
+            else {
+                fail("query: expected a path, select or {");
+            }
+            skip_space();
+        } while (accept('|'));
+        if (_pos != _text.size()) fail("query: unexpected character");
+        return stages;
+    }
+
+    /// append s to a JSON Pointer as one segment
+    static void append_segment(std::string& pointer, const std::string& s) {
+        pointer += '/';
+        for (std::string::const_iterator c = s.begin(); c != s.end(); ++c) {
+            if (*c == '~') pointer += "~0";
+            else if (*c == '/') pointer += "~1";
+            else pointer += *c;
+        }
+    }
+
+private :
+    /// what must be a literal, as exception keeps the pointer
+    [[noreturn]] void fail(const char* what) const {
+        throw exception(what);
+    }
+
+    void skip_space() { while (_pos < _text.size() && std::isspace((unsigned char) _text[_pos])) ++_pos; }
+    char peek() { skip_space(); return _pos < _text.size() ? _text[_pos] : '\0'; }
+    bool accept(char c) { if (peek() != c) return false; ++_pos; return true; }
+    void expect(char c) { if (!accept(c)) fail("query: unexpected token"); }
+
+    static bool ident_char(char c) { return std::isalnum((unsigned char) c) || c == '_'; }
+
+    /// consume word if it comes next as a whole word
+    bool keyword(const char* word) {
+        skip_space();
+        const std::string::size_type n = std::char_traits<char>::length(word);
+        if (_text.compare(_pos, n, word) != 0) return false;
+        if (_pos + n < _text.size() && ident_char(_text[_pos + n])) return false;
+        _pos += n;
+        return true;
+    }
+
+    std::string identifier() {
+        skip_space();
+        const std::string::size_type start = _pos;
+        while (_pos < _text.size() && ident_char(_text[_pos])) ++_pos;
+        if (start == _pos) fail("query: expected a name");
+        return _text.substr(start, _pos - start);
+    }
+
+    std::string string_literal() {
+        expect('"');
+        std::string s;
+        while (_pos < _text.size() && _text[_pos] != '"') {
+            if (_text[_pos] == '\\' && _pos + 1 < _text.size()) ++_pos;
+            s += _text[_pos++];
+        }
+        if (_pos == _text.size()) fail("query: unterminated string");
+        ++_pos;
+        return s;
+    }
+
+    ///
+    /// parse .a.b[0]."c"[] into JSON Pointers, split after each []
+    ///
+    /// @return true if the path ends in []
+    ///
+    bool path_expression(std::vector<std::string>& pointers) {
+        expect('.');
+        pointers.assign(1, std::string());
+        bool iterates = false;
+        bool dot = true;
+        for (;;) {
+            if (_pos < _text.size() && dot && ident_char(_text[_pos])) {
+                append_segment(pointers.back(), identifier());
+            }
+            else if (_pos < _text.size() && dot && _text[_pos] == '"') {
+                append_segment(pointers.back(), string_literal());
+            }
+            else if (_pos < _text.size() && _text[_pos] == '[') {
+                ++_pos;
+                if (accept(']')) {
+                    pointers.push_back(std::string());
+                    iterates = true;
+                }
+                else {
+                    if (peek() == '"') append_segment(pointers.back(), string_literal());
+                    else append_segment(pointers.back(), std::to_string(integer()));
+                    expect(']');
+                }
+            }
+            else if (_pos < _text.size() && _text[_pos] == '.') {
+                ++_pos;
+                dot = true;
+                continue;
+            }
+            else {
+                break;
+            }
+            iterates = iterates && pointers.back().empty();
+            dot = false;
+        }
+        if (iterates) pointers.pop_back();
+        return iterates;
+    }
+
+    long integer() {
+        skip_space();
+        const char* start = _text.c_str() + _pos;
+        char* end;
+        const long n = std::strtol(start, &end, 10);
+        if (end == start || n < 0) fail("query: expected an index");
+        _pos += end - start;
+        return n;
+    }
+
+    boost::shared_ptr<stage> projection() {
+        expect('{');
+        boost::shared_ptr<stage> s = boost::make_shared<stage>(stage::project);
+        do {
+            const std::string name = peek() == '"' ? string_literal() : identifier();
+            std::string pointer;
+            if (accept(':')) {
+                std::vector<std::string> pointers;
+                if (peek() != '.' || path_expression(pointers) || pointers.size() != 1) fail("query: expected a path without []");
+                pointer = pointers[0];
+            }
+            else {
+                append_segment(pointer, name);
+            }
+            s->names.push_back(name);
+            s->fields.push_back(path(pointer));
+        } while (accept(','));
+        expect('}');
+        return s;
+    }
+
+    boost::shared_ptr<expr> binary(expr::op_t op, const boost::shared_ptr<expr>& lhs, const boost::shared_ptr<expr>& rhs) {
+        boost::shared_ptr<expr> e = boost::make_shared<expr>(op);
+        e->lhs = lhs;
+        e->rhs = rhs;
+        return e;
+    }
+
+    boost::shared_ptr<expr> disjunction() {
+        boost::shared_ptr<expr> e = conjunction();
+        while (keyword("or"))
+            e = binary(expr::or_, e, conjunction());
+        return e;
+    }
+
+    boost::shared_ptr<expr> conjunction() {
+        boost::shared_ptr<expr> e = negation();
+        while (keyword("and"))
+            e = binary(expr::and_, e, negation());
+        return e;
+    }
+
+    boost::shared_ptr<expr> negation() {
+        if (keyword("not")) return binary(expr::not_, negation(), boost::shared_ptr<expr>());
+        if (accept('(')) {
+            boost::shared_ptr<expr> e = disjunction();
+            expect(')');
+            return e;
+        }
+        return comparison();
+    }
+
+    boost::shared_ptr<expr> comparison() {
+        boost::shared_ptr<expr> lhs = operand();
+        static const struct { const char* text; expr::op_t op; } ops[] = {
+            { "==", expr::equal }, { "!=", expr::not_equal }, { "<=", expr::less_equal },
+            { ">=", expr::greater_equal }, { "<", expr::less }, { ">", expr::greater } };
+        skip_space();
+        for (std::size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); ++i)
+            if (_text.compare(_pos, std::char_traits<char>::length(ops[i].text), ops[i].text) == 0) {
+                _pos += std::char_traits<char>::length(ops[i].text);
+                return binary(ops[i].op, lhs, operand());
+            }
+        return binary(expr::truthy, lhs, boost::shared_ptr<expr>());
+    }
+
+    boost::shared_ptr<expr> operand() {
+        const char c = peek();
+        if (c == '.') {
+            std::vector<std::string> pointers;
+            if (path_expression(pointers) || pointers.size() != 1) fail("query: [] is not allowed in a predicate");
+            boost::shared_ptr<expr> e = boost::make_shared<expr>(expr::field);
+            e->at = path(pointers[0]);
+            return e;
+        }
+        boost::shared_ptr<expr> e = boost::make_shared<expr>(expr::constant);
+        if (c == '"') {
+            e->value = string_literal();
+        }
+        else if (std::isdigit((unsigned char) c) || c == '-') {
+            const char* start = _text.c_str() + _pos;
+            char* end;
+            const double n = std::strtod(start, &end);
+            if (end == start) fail("query: expected a number");
+            const std::string literal(start, end - start);
+            _pos += end - start;
+            if (literal.find_first_of(".eE") == std::string::npos && n >= -2147483648.0 && n <= 2147483647.0)
+                e->value = int(n);
+            else
+                e->value = n;
+        }
+        else if (keyword("true")) {
+            e->value = true;
+        }
+        else if (keyword("false")) {
+            e->value = false;
+        }
+        else if (!keyword("null")) {
+            fail("query: expected a path or a literal");
+        }
+        return e;
+    }
+
+    const std::string& _text;
+    std::string::size_type _pos;
+};
+
+///
+/// compile a query
+///
+query::query(const std::string& expression) : _expression(expression) {
+    std::vector<boost::shared_ptr<stage> > stages = parser(expression).pipeline();
+
+    // predicate pushdown: select only projected fields, before the projection builds its map
+    for (std::size_t i = 1; i < stages.size(); ++i) {
+        if (stages[i]->kind != stage::select || stages[i - 1]->kind != stage::project) continue;
+        stage& project = *stages[i - 1];
+        std::vector<std::string> pointers;
+        for (std::size_t f = 0; f < project.names.size(); ++f)
+        {
+            pointers.push_back(std::string());
+            parser::append_segment(pointers.back(), project.names[f]);
+        }
+        if (!stages[i]->predicate->reads_only(pointers)) continue;
+        stages[i]->predicate->rebase(pointers, project.fields);
+        std::swap(stages[i], stages[i - 1]);
+        if (i > 1) i -= 2; // it may move further up
+    }
+
+    for (std::size_t i = 1; i < stages.size(); ++i)
+        stages[i - 1]->next = stages[i];
+    if (stages.empty()) stages.push_back(boost::make_shared<stage>(stage::get));
+    _first = stages.front();
+}
+
+///
+/// @return vector of the vars the query produces from input
+///
+/// threads is the most threads to use, 0 for one per hardware thread.
+///
+var query::run(const var& input, std::size_t threads) const {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+#ifdef DYNAMIC_NON_ATOMIC_REFCOUNT
+    // results share nodes with the input, which needs atomic counts across threads
+    threads = 1;
+#endif
+    std::vector<var> out;
+    const var* items = _first->kind == stage::iterate ? _first->at.find(input) : 0;
+    if (items && (items->is_vector() || items->is_persistent_vector() || items->is_slice()))
+        threads = std::min<std::size_t>(threads, items->count() / min_chunk);
+    else
+        threads = 1;
+
+    if (threads <= 1) {
+        _first->push(input, out);
+    }
+    else {
+        // contiguous chunks, so concatenating the outputs keeps the input order
+        const var::size_type count = items->count();
+        std::vector<std::vector<var> > outputs(threads);
+        std::vector<std::exception_ptr> errors(threads);
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; ++t)
+            workers.push_back(std::thread([this, items, count, threads, t, &outputs, &errors] {
+                try {
+                    _first->emit_range(*items, count * t / threads, count * (t + 1) / threads, outputs[t]);
+                } catch (...) {
+                    errors[t] = std::current_exception();
+                }
+            }));
+        for (std::size_t t = 0; t < threads; ++t)
+            workers[t].join();
+        for (std::size_t t = 0; t < threads; ++t)
+            if (errors[t]) std::rethrow_exception(errors[t]);
+        for (std::size_t t = 0; t < threads; ++t)
+            out.insert(out.end(), outputs[t].begin(), outputs[t].end());
+    }
+
+    var result = make_vector();
+    for (std::vector<var>::const_iterator it = out.begin(); it != out.end(); ++it)
+        result(*it);
+    return result;
+}
+
+}
@@ -0,0 +1,115 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <dynamic/reclaimer.hpp>
+
+namespace dynamic {
+
+///
+/// ctor: start the reclaimer's thread
+///
+reclaimer::reclaimer(std::size_t capacity) : _capacity(capacity ? capacity : 1), _busy(false), _stop(false) {
+    // reserved up front so dispose() never allocates while holding the lock
+    _queue.reserve(_capacity);
+    _thread = std::thread(&reclaimer::run, this);
+}
+
+///
+/// dtor: destroy everything still queued, then stop the thread
+///
+reclaimer::~reclaimer() {
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _stop = true;
+    }
+    _work.notify_one();
+    _thread.join();
+}
+
+///
+/// move v onto the queue, or release it here if it is not a collection or the queue is full
+///
+/// @return true if v was queued
+///
+bool reclaimer::dispose(var&& v) {
+    var garbage(std::move(v));
+    if (!garbage.is_collection()) return false;
+    bool wake;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (_queue.size() >= _capacity) return false; // garbage is released after the lock
+        wake = _queue.empty();
+        _queue.push_back(std::move(garbage));
+    }
+    if (wake) _work.notify_one();
+    return true;
+}
+
+///
+/// wait until every var queued so far has been destroyed
+///
+void reclaimer::drain() {
+    std::unique_lock<std::mutex> guard(_lock);
+    _idle.wait(guard, [this] { return _queue.empty() && !_busy; });
+}
+
+///
+/// @return number of vars waiting on the queue
+///
+std::size_t reclaimer::pending() const {
+    std::lock_guard<std::mutex> guard(_lock);
+    return _queue.size();
+}
+
+///
+/// take the whole queue at a time and destroy it outside the lock
+///
+void reclaimer::run() {
+    std::vector<var> batch;
+    batch.reserve(_capacity);
+    std::unique_lock<std::mutex> guard(_lock);
+    for (;;) {
+        _work.wait(guard, [this] { return !_queue.empty() || _stop; });
+        if (_queue.empty()) return;
+        // batch is empty with its capacity intact, so the queue stays reserved
+        _queue.swap(batch);
+        _busy = true;
+        guard.unlock();
+        batch.clear();
+        guard.lock();
+        _busy = false;
+        if (_queue.empty()) _idle.notify_all();
+    }
+}
+
+///
+/// @return the process-wide reclaimer
+///
+reclaimer& default_reclaimer() {
+    static reclaimer instance;
+    return instance;
+}
+
+}
@@ -0,0 +1,246 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include <thread>
+
+#include <dynamic/exception.hpp>
+#include <dynamic/record_index.hpp>
+
+namespace dynamic {
+
+///
+/// index records by the value at the JSON Pointer key
+///
+record_index::record_index(var& records, const std::string& key, kind_t kind, std::size_t threads)
+    : _records(&records), _key(key), _kind(kind), _indexed(0) {
+    rebuild(threads);
+}
+
+///
+/// index records by the value at key
+///
+record_index::record_index(var& records, const path& key, kind_t kind, std::size_t threads)
+    : _records(&records), _key(key), _kind(kind), _indexed(0) {
+    rebuild(threads);
+}
+
+///
+/// append record to the vector and index it
+///
+record_index& record_index::operator () (const var& record) {
+    (*_records)(record);
+    update();
+    return *this;
+}
+
+///
+/// index the records appended to the vector since the last update
+///
+/// If the vector has shrunk, the index is rebuilt.
+///
+void record_index::update() {
+    const var& records = *_records;
+    if (records.count() < _indexed) {
+        rebuild();
+        return;
+    }
+    for (; _indexed < records.count(); ++_indexed)
+        if (const var* key = _key.find(records[int(_indexed)]))
+            add(*key, _indexed);
+}
+
+///
+/// index the whole vector again
+///
+/// Looking keys up and hashing or sorting them is split across up to threads threads, 0 for
+/// one per hardware thread, each taking at least min_chunk records.
+///
+void record_index::rebuild(std::size_t threads) {
+    const var& records = *_records;
+    if (!records.is_vector() && !records.is_persistent_vector() && !records.is_slice()) throw exception("record_index needs a vector");
+    const var::size_type n = records.count();
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+#ifdef DYNAMIC_NON_ATOMIC_REFCOUNT
+    // keys share nodes with the records, which needs atomic counts across threads
+    threads = 1;
+#endif
+    threads = std::max<std::size_t>(1, std::min<std::size_t>(threads, n / min_chunk));
+
+    // run work(t, begin, end) on contiguous chunks of the records
+    auto in_parallel = [threads, n](auto work) {
+        if (threads == 1) {
+            work(0, 0, n);
+            return;
+        }
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; ++t)
+            workers.push_back(std::thread(work, t, n * t / threads, n * (t + 1) / threads));
+        for (std::size_t t = 0; t < threads; ++t)
+            workers[t].join();
+    };
+
+    _shards.clear();
+    _entries.clear();
+    if (_kind == hash) {
+        std::vector<hashed_key> keys(n);
+        std::vector<char> found(n);
+        in_parallel([&](std::size_t, var::size_type begin, var::size_type end) {
+            for (var::size_type i = begin; i < end; ++i)
+                if (const var* key = _key.find(records[int(i)])) {
+                    keys[i].hash = dynamic::hash(*key);
+                    keys[i].value = *key;
+                    found[i] = 1;
+                }
+        });
+        // shard t takes the keys whose hash is t modulo the number of shards, in record order
+        _shards.resize(threads);
+        in_parallel([&](std::size_t t, var::size_type, var::size_type) {
+            for (var::size_type i = 0; i < n; ++i)
+                if (found[i] && keys[i].hash % threads == t)
+                    _shards[t][keys[i]].push_back(i);
+        });
+    }
+    else {
+        std::vector<std::vector<entry> > chunks(threads);
+        in_parallel([&](std::size_t t, var::size_type begin, var::size_type end) {
+            for (var::size_type i = begin; i < end; ++i)
+                if (const var* key = _key.find(records[int(i)]))
+                    chunks[t].push_back(entry(*key, i));
+            std::sort(chunks[t].begin(), chunks[t].end(), entry_less());
+        });
+        for (std::size_t t = 0; t < threads; ++t) {
+            const std::vector<entry>::difference_type middle = _entries.size();
+            _entries.insert(_entries.end(), chunks[t].begin(), chunks[t].end());
+            std::inplace_merge(_entries.begin(), _entries.begin() + middle, _entries.end(), entry_less());
+        }
+    }
+    _indexed = n;
+}
+
+///
+/// @return positions of the records whose key equals value, ascending
+///
+std::vector<var::size_type> record_index::find(const var& value) const {
+    if (_kind == hash) {
+        const std::vector<var::size_type>* positions = bucket(value);
+        return positions ? *positions : std::vector<var::size_type>();
+    }
+    std::vector<var::size_type> positions;
+    const std::pair<std::vector<entry>::const_iterator, std::vector<entry>::const_iterator> found = equal_range(value);
+    for (std::vector<entry>::const_iterator it = found.first; it != found.second; ++it)
+        positions.push_back(it->second);
+    return positions;
+}
+
+///
+/// @return positions of the records with low <= key < high, in key order
+///
+/// Only a sorted index can answer a range query.
+///
+std::vector<var::size_type> record_index::range(const var& low, const var& high) const {
+    if (_kind != sorted) throw exception("range needs a sorted index");
+    auto key_less = [](const entry& e, const var& key) { return var::compare(e.first, key) < 0; };
+    std::vector<entry>::const_iterator begin = std::lower_bound(_entries.begin(), _entries.end(), low, key_less);
+    std::vector<entry>::const_iterator end = std::lower_bound(begin, _entries.end(), high, key_less);
+    std::vector<var::size_type> positions;
+    for (; begin < end; ++begin)
+        positions.push_back(begin->second);
+    return positions;
+}
+
+///
+/// @return the first record whose key equals value, or 0 if there is none
+///
+const var* record_index::first(const var& value) const {
+    var::size_type position;
+    if (_kind == hash) {
+        const std::vector<var::size_type>* positions = bucket(value);
+        if (!positions) return 0;
+        position = positions->front();
+    }
+    else {
+        const std::pair<std::vector<entry>::const_iterator, std::vector<entry>::const_iterator> found = equal_range(value);
+        if (found.first == found.second) return 0;
+        position = found.first->second;
+    }
+    return &static_cast<const var&>(*_records)[int(position)];
+}
+
+///
+/// @return number of records whose key equals value
+///
+var::size_type record_index::count(const var& value) const {
+    if (_kind == hash) {
+        const std::vector<var::size_type>* positions = bucket(value);
+        return positions ? positions->size() : 0;
+    }
+    const std::pair<std::vector<entry>::const_iterator, std::vector<entry>::const_iterator> found = equal_range(value);
+    return found.second - found.first;
+}
+
+///
+/// index the record at position under key
+///
+void record_index::add(const var& key, var::size_type position) {
+    if (_kind == hash) {
+        if (_shards.empty()) _shards.resize(1);
+        hashed_key hashed;
+        hashed.hash = dynamic::hash(key);
+        hashed.value = key;
+        _shards[hashed.hash % _shards.size()][hashed].push_back(position);
+        return;
+    }
+    const entry e(key, position);
+    // appended records usually come last in key order too
+    if (_entries.empty() || !entry_less()(e, _entries.back())) _entries.push_back(e);
+    else _entries.insert(std::upper_bound(_entries.begin(), _entries.end(), e, entry_less()), e);
+}
+
+///
+/// @return positions under value in a hash index, or 0 if there are none
+///
+const std::vector<var::size_type>* record_index::bucket(const var& value) const {
+    if (_shards.empty()) return 0;
+    hashed_key key;
+    key.hash = dynamic::hash(value);
+    key.value = value;
+    const shard& s = _shards[key.hash % _shards.size()];
+    shard::const_iterator found = s.find(key);
+    return found == s.end() ? 0 : &found->second;
+}
+
+///
+/// @return entries of a sorted index whose key equals value
+///
+std::pair<std::vector<record_index::entry>::const_iterator, std::vector<record_index::entry>::const_iterator>
+record_index::equal_range(const var& value) const {
+    auto key_less = [](const entry& e, const var& key) { return var::compare(e.first, key) < 0; };
+    auto less_key = [](const var& key, const entry& e) { return var::compare(key, e.first) < 0; };
+    std::vector<entry>::const_iterator begin = std::lower_bound(_entries.begin(), _entries.end(), value, key_less);
+    return std::make_pair(begin, std::upper_bound(begin, _entries.end(), value, less_key));
+}
+
+}
@@ -23,72 +23,88 @@
     OTHER DEALINGS IN THE SOFTWARE.
 */
 
-#include <algorithm> // std::equal
+#include <cstring>
+#include <cwchar>
 
 #include <dynamic/exception.hpp>
+#include <dynamic/traverse.hpp>
 #include <dynamic/var.hpp>
 
+#include "persistent.hpp"
+
 namespace dynamic {
 
+namespace {
+
+/// @return true if a string payload holds the n characters at p
+template <typename Node, typename Char>
+bool equal_chars(const Node& s, const Char* p, std::size_t n) {
+    return s.size() == n && (n == 0 || std::memcmp(s.data(), p, n * sizeof(Char)) == 0);
+}
+
+}
+
 ///
 /// var == bool
 ///
 bool var::operator == (bool n) const {
-    return *this == var(n);
+    return type() == type_bool && boost::get<bool_t>(_var) == n;
 }
 
 ///
 /// var == int
 ///
 bool var::operator == (int n) const {
-    return *this == var(n);
+    return type() == type_int && boost::get<int_t>(_var) == n;
 }
 
 ///
 /// var == double
 ///
 bool var::operator == (double n) const {
-    return *this == var(n);
+    return type() == type_double && boost::get<double_t>(_var) == n;
 }
 
 ///
 /// var == string
 ///
 bool var::operator == (const std::string& s) const {
-    return *this == var(s);
+    return type() == type_string && equal_chars(*boost::get<string_t>(_var).ps, s.data(), s.size());
 }
 
 ///
 /// var == string constant
 ///
 bool var::operator == (const char* s) const {
-    return *this == var(s);
+    return type() == type_string && equal_chars(*boost::get<string_t>(_var).ps, s, std::strlen(s));
 }
 
 ///
 /// var == wide string
 ///
 bool var::operator == (const std::wstring& s) const {
-    return *this == var(s);
+    return type() == type_wstring && equal_chars(*boost::get<wstring_t>(_var).ps, s.data(), s.size());
 }
 
 ///
 /// var == wide string constant
 ///
 bool var::operator == (const wchar_t* s) const {
-    return *this == var(s);
+    return type() == type_wstring && equal_chars(*boost::get<wstring_t>(_var).ps, s, std::wcslen(s));
 }
 
 ///
-/// var == var
+/// compare two vars without looking at the members of collections
 ///
-struct var::equal_visitor : public boost::static_visitor<bool>
+struct var::equal_visitor : public boost::static_visitor<int>
 {
+    enum { different, same, compare_members };
+
     // Different types
     template <typename T, typename U>
-    result_type operator () (const T& lhs, const U& rhs) const
+    result_type operator () (const T&, const U&) const
     {
-        return false;
+        return different;
     }
     // Same types
     template <typename T>
@@ -97,43 +113,204 @@ struct var::equal_visitor : public boost::static_visitor<bool>
         // Use overloaded functions to handle explicit specialization
         return equal(lhs, rhs);
     }
+    // a slice equals the vector of its elements
+    result_type operator () (const vector_ptr& lhs, const slice_t& rhs) const
+    {
+        return lhs->size() == rhs.length ? compare_members : different;
+    }
+    result_type operator () (const slice_t& lhs, const vector_ptr& rhs) const
+    {
+        return (*this)(rhs, lhs);
+    }
 
 private:
-    bool equal(const null_t&, const null_t&) const
+    static result_type result(bool b) { return b ? same : different; }
+
+    result_type equal(const null_t&, const null_t&) const
     {
-        return true;
+        return same;
     }
-    bool equal(const bool_t& lhs, const bool_t& rhs) const
+    result_type equal(const bool_t& lhs, const bool_t& rhs) const
     {
-        return lhs == rhs;
+        return result(lhs == rhs);
     }
-    bool equal(const int_t& lhs, const int_t& rhs) const
+    result_type equal(const int_t& lhs, const int_t& rhs) const
     {
-        return lhs == rhs;
+        return result(lhs == rhs);
     }
-    bool equal(const double_t& lhs, const double_t& rhs) const
+    result_type equal(const double_t& lhs, const double_t& rhs) const
     {
-        return lhs == rhs;
+        return result(lhs == rhs);
     }
-    bool equal(const string_t& lhs, const string_t& rhs) const
+    // shared strings are equal without reading them
+    result_type equal(const string_t& lhs, const string_t& rhs) const
     {
-        return *(lhs.ps) == *(rhs.ps);
+        return result(lhs.ps == rhs.ps || equal_chars(*lhs.ps, rhs.ps->data(), rhs.ps->size()));
     }
-    bool equal(const wstring_t& lhs, const wstring_t& rhs) const
+    result_type equal(const wstring_t& lhs, const wstring_t& rhs) const
     {
-        return *(lhs.ps) == *(rhs.ps);
+        return result(lhs.ps == rhs.ps || equal_chars(*lhs.ps, rhs.ps->data(), rhs.ps->size()));
     }
-    bool equal(const vector_ptr& lhs, const vector_ptr& rhs) const
+    // a shared collection is equal to itself, others need the same size and, when both
+    // are frozen and already fingerprinted, the same fingerprint before their members are compared
+    template <typename T>
+    result_type equal(const boost::intrusive_ptr<T>& lhs, const boost::intrusive_ptr<T>& rhs) const
     {
-        return std::equal(lhs->begin(), lhs->end(), rhs->begin());
+        if (lhs == rhs) return same;
+        if (size(*lhs) != size(*rhs)) return different;
+        fingerprint l, r;
+        if (lhs->frozen && rhs->frozen && lhs->memo.get(l) && rhs->memo.get(r) && l != r) return different;
+        return compare_members;
     }
-    bool equal(const map_ptr& lhs, const map_ptr& rhs) const
+
+    result_type equal(const slice_t& lhs, const slice_t& rhs) const
     {
-        return std::equal(lhs->begin(), lhs->end(), rhs->begin());
+        if (lhs.length != rhs.length) return different;
+        if (lhs.parent == rhs.parent && lhs.offset == rhs.offset) return same;
+        return compare_members;
     }
+
+    static size_type size(const vector_node& n) { return n.size(); }
+    static size_type size(const map_node& n) { return n.size(); }
+    static size_type size(const pvector_node& n) { return n.size; }
+    static size_type size(const pmap_node& n) { return n.size(); }
 };
+
+///
+/// var == var
+///
+/// Compares the members of both trees in step, with an explicit stack so nesting depth costs
+/// no call stack. Persistent maps holding the same keys iterate in the same order as well.
+///
 bool var::operator == (const var& v) const {
-    return boost::apply_visitor(equal_visitor(), _var, v._var);
+    int match = boost::apply_visitor(equal_visitor(), _var, v._var);
+    if (match != equal_visitor::compare_members) return match == equal_visitor::same;
+    boost::container::small_vector<std::pair<member_cursor, member_cursor>, 8> stack;
+    stack.emplace_back(member_cursor(*this), member_cursor(v));
+    while (!stack.empty()) {
+        member_cursor& lhs = stack.back().first;
+        member_cursor& rhs = stack.back().second;
+        // equal sizes, so both run out together
+        if (!lhs.next()) {
+            stack.pop_back();
+            continue;
+        }
+        rhs.next();
+        const var& l = lhs.member();
+        const var& r = rhs.member();
+        match = boost::apply_visitor(equal_visitor(), l._var, r._var);
+        if (match == equal_visitor::different) return false;
+        if (match == equal_visitor::compare_members) stack.emplace_back(member_cursor(l), member_cursor(r));
+    }
+    return true;
+}
+
+///
+/// order two vars without looking at the members of collections
+///
+struct var::compare_visitor : public boost::static_visitor<int>
+{
+    enum { less = -1, same = 0, greater = 1, compare_members = 2 };
+
+    /// @return order of lhs and rhs by type, then by value, or compare_members for two collections
+    static result_type shallow(const var& lhs, const var& rhs)
+    {
+        // a slice orders as the vector of its elements
+        const code lt = lhs.is_slice() ? type_vector : lhs.type(), rt = rhs.is_slice() ? type_vector : rhs.type();
+        if (lt != rt) return lt < rt ? less : greater;
+        return boost::apply_visitor(compare_visitor(), lhs._var, rhs._var);
+    }
+
+    // Different types are ordered by type before visiting
+    template <typename T, typename U>
+    result_type operator () (const T&, const U&) const
+    {
+        return same;
+    }
+    // Same types
+    template <typename T>
+    result_type operator () (const T& lhs, const T& rhs) const
+    {
+        return compare(lhs, rhs);
+    }
+    // a vector and a slice are ordered by their members
+    result_type operator () (const vector_ptr&, const slice_t&) const
+    {
+        return compare_members;
+    }
+    result_type operator () (const slice_t&, const vector_ptr&) const
+    {
+        return compare_members;
+    }
+
+private:
+    template <typename T>
+    static result_type order(const T& lhs, const T& rhs) { return lhs < rhs ? less : rhs < lhs ? greater : same; }
+
+    result_type compare(const null_t&, const null_t&) const
+    {
+        return same;
+    }
+    result_type compare(const bool_t& lhs, const bool_t& rhs) const
+    {
+        return order(lhs, rhs);
+    }
+    result_type compare(const int_t& lhs, const int_t& rhs) const
+    {
+        return order(lhs, rhs);
+    }
+    result_type compare(const double_t& lhs, const double_t& rhs) const
+    {
+        return order(lhs, rhs);
+    }
+    result_type compare(const string_t& lhs, const string_t& rhs) const
+    {
+        return lhs.ps == rhs.ps ? same : order(lhs.ps->compare(*rhs.ps), 0);
+    }
+    result_type compare(const wstring_t& lhs, const wstring_t& rhs) const
+    {
+        return lhs.ps == rhs.ps ? same : order(lhs.ps->compare(*rhs.ps), 0);
+    }
+    // a shared collection is equal to itself, others are ordered by their members
+    template <typename T>
+    result_type compare(const boost::intrusive_ptr<T>& lhs, const boost::intrusive_ptr<T>& rhs) const
+    {
+        return lhs == rhs ? same : compare_members;
+    }
+    result_type compare(const slice_t& lhs, const slice_t& rhs) const
+    {
+        return lhs.parent == rhs.parent && lhs.offset == rhs.offset && lhs.length == rhs.length ? same : compare_members;
+    }
+};
+
+///
+/// three-way comparison in less_var order
+///
+/// Walks both trees in step like operator ==, stopping at the first member that differs.
+///
+int var::compare(const var& lhs, const var& rhs) {
+    int order = compare_visitor::shallow(lhs, rhs);
+    if (order != compare_visitor::compare_members) return order;
+    boost::container::small_vector<std::pair<member_cursor, member_cursor>, 8> stack;
+    stack.emplace_back(member_cursor(lhs), member_cursor(rhs));
+    while (!stack.empty()) {
+        const bool more_lhs = stack.back().first.next();
+        const bool more_rhs = stack.back().second.next();
+        if (!more_lhs || !more_rhs) {
+            // the shorter collection comes first
+            if (more_lhs != more_rhs) return more_lhs ? compare_visitor::greater : compare_visitor::less;
+            stack.pop_back();
+            continue;
+        }
+        const var& l = stack.back().first.member();
+        const var& r = stack.back().second.member();
+        order = compare_visitor::shallow(l, r);
+        if (order == compare_visitor::compare_members)
+            stack.emplace_back(member_cursor(l), member_cursor(r));
+        else if (order != compare_visitor::same)
+            return order;
+    }
+    return compare_visitor::same;
 }
 
 ///
@@ -189,7 +366,7 @@ bool var::operator != (const wchar_t* s) const {
 /// var != var
 ///
 bool var::operator != (const var& v) const {
-    return !boost::apply_visitor(equal_visitor(), _var, v._var);
+    return !(*this == v);
 }
 
 ///
@@ -283,7 +460,7 @@ bool var::operator <= (double n) const {
 /// var <= string
 ///
 bool var::operator <= (const std::string& s) const {
-    if (is_string()) return *boost::get<string_t>(_var).ps <= s;
+    if (is_string()) return *boost::get<string_t>(_var).ps <= std::string_view(s);
     throw exception("invalid <= comparison to string");
 }
 
@@ -299,7 +476,7 @@ bool var::operator <= (const char* s) const {
 /// var <= wide string
 ///
 bool var::operator <= (const std::wstring& s) const {
-    if (is_wstring()) return *boost::get<wstring_t>(_var).ps <= s;
+    if (is_wstring()) return *boost::get<wstring_t>(_var).ps <= std::wstring_view(s);
     throw exception("invalid <= comparison to wstring");
 }
 
@@ -356,7 +533,7 @@ bool var::operator > (double n) const {
 /// var > string
 ///
 bool var::operator > (const std::string& s) const {
-    if (is_string()) return *boost::get<string_t>(_var).ps > s;
+    if (is_string()) return *boost::get<string_t>(_var).ps > std::string_view(s);
     throw exception("invalid > comparison to string");
 }
 
@@ -371,7 +548,7 @@ bool var::operator > (const char* s) const {
 /// var > wide string
 ///
 bool var::operator > (const std::wstring& s) const {
-    if (is_wstring()) return *boost::get<wstring_t>(_var).ps > s;
+    if (is_wstring()) return *boost::get<wstring_t>(_var).ps > std::wstring_view(s);
     throw exception("invalid > comparison to wstring");
 }
 
@@ -428,7 +605,7 @@ bool var::operator >= (double n) const {
 /// var >= string
 ///
 bool var::operator >= (const std::string& s) const {
-    if (is_string()) return *boost::get<string_t>(_var).ps >= s;
+    if (is_string()) return *boost::get<string_t>(_var).ps >= std::string_view(s);
     throw exception("invalid >= comparison to string");
 }
 
@@ -444,7 +621,7 @@ bool var::operator >= (const char* s) const {
 /// var >= wide string
 ///
 bool var::operator >= (const std::wstring& s) const {
-    if (is_wstring()) return *boost::get<wstring_t>(_var).ps >= s;
+    if (is_wstring()) return *boost::get<wstring_t>(_var).ps >= std::wstring_view(s);
     throw exception("invalid >= comparison to wstring");
 }
 
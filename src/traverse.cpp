@@ -0,0 +1,117 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <dynamic/traverse.hpp>
+
+namespace dynamic {
+
+///
+/// position before the first member of a collection
+///
+member_cursor::member_cursor(const var& collection) :
+    _collection(&collection), _member(0), _type(var::code(collection._var.which())), _phase(0), _index(0),
+    _item(0), _items_end(0)
+{
+    if (_type == var::type_vector) {
+        const var::vector_type& items = *boost::get<var::vector_ptr>(collection._var);
+        _item = items.data();
+        _items_end = _item + items.size();
+    }
+    else if (_type == var::type_slice) {
+        // a slice walks its window of the parent like a vector
+        const var::slice_t& window = boost::get<var::slice_t>(collection._var);
+        _type = var::type_vector;
+        _item = window.parent->data() + window.offset;
+        _items_end = _item + window.length;
+    }
+    else if (_type == var::type_map) {
+        const var::map_type& entries = *boost::get<var::map_ptr>(collection._var);
+        _entry = entries.begin();
+        _entries_end = entries.end();
+    }
+    else {
+        _it.emplace(collection.begin());
+        _end.emplace(collection.end());
+    }
+}
+
+///
+/// walk root, the first call to next() produces its first event
+///
+tree_walker::tree_walker(const var& root) :
+    _root(&root), _node(0), _event(leaf), _role(tree_walker::root), _index(0), _started(false), _skip(false) {}
+
+///
+/// move to the next event
+///
+bool tree_walker::next() {
+    if (!_started) {
+        _started = true;
+        _node = _root;
+        _event = member_cursor::is_collection(*_root) ? enter : leaf;
+        return true;
+    }
+    if (_event == enter) {
+        if (_skip) {
+            _skip = false;
+            _event = leave;
+            return true;
+        }
+        _stack.emplace_back(*_node);
+    }
+    if (_stack.empty()) return false;
+
+    member_cursor& top = _stack.back();
+    if (top.next()) {
+        _node = &top.member();
+        _role = top.on_value() ? value : top.is_map() ? key : element;
+        _index = top.index();
+        _event = member_cursor::is_collection(*_node) ? enter : leaf;
+        return true;
+    }
+
+    _node = &top.collection();
+    _event = leave;
+    _stack.pop_back();
+    if (_stack.empty()) {
+        _role = root;
+        _index = 0;
+    }
+    else {
+        const member_cursor& parent = _stack.back();
+        _role = parent.on_value() ? value : parent.is_map() ? key : element;
+        _index = parent.index();
+    }
+    return true;
+}
+
+///
+/// skip the members of the collection just entered
+///
+void tree_walker::skip() {
+    if (_event == enter) _skip = true;
+}
+
+}
@@ -66,7 +66,8 @@ var::operator double() const {
 ///
 var::operator std::string() const {
     try {
-        return *boost::get<string_t>(_var).ps;
+        const string_node& s = *boost::get<string_t>(_var).ps;
+        return std::string(s.data(), s.size());
     } catch (const boost::bad_get&) {
         throw exception("cannot convert to string");
     }
@@ -77,7 +78,8 @@ var::operator std::string() const {
 ///
 var::operator std::wstring() const {
     try {
-        return *boost::get<wstring_t>(_var).ps;
+        const wstring_node& s = *boost::get<wstring_t>(_var).ps;
+        return std::wstring(s.data(), s.size());
     } catch (const boost::bad_get&) {
         throw exception("cannot convert to wstring");
     }
@@ -94,8 +96,11 @@ struct var::name_visitor : public boost::static_visitor<std::string>
     result_type operator () (const double_t&) const { return "double"; }
     result_type operator () (const string_t& value) const { return "string"; }
     result_type operator () (const wstring_t& value) const { return "wstring"; }
-    result_type operator () (const vector_ptr& ptr) const { return "vector"; }
-    result_type operator () (const map_ptr& ptr) const { return "map"; }
+    result_type operator () (const vector_ptr&) const { return "vector"; }
+    result_type operator () (const map_ptr&) const { return "map"; }
+    result_type operator () (const pvector_ptr&) const { return "persistent_vector"; }
+    result_type operator () (const pmap_ptr&) const { return "persistent_map"; }
+    result_type operator () (const slice_t&) const { return "slice"; }
 };
 std::string var::name() const {
     return boost::apply_visitor(name_visitor(), _var);
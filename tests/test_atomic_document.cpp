@@ -0,0 +1,129 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+BOOST_AUTO_TEST_CASE (atomic_document_publish) {
+    atomic_document doc(make_map("version", 1));
+    {
+        atomic_document::snapshot s1 = doc.read();
+        BOOST_CHECK(s1.root()["version"] == 1);
+        BOOST_CHECK(s1.root().is_frozen());
+
+        doc.publish(make_map("version", 2));
+        atomic_document::snapshot s2 = doc.read();
+        BOOST_CHECK(s2.root()["version"] == 2);
+        // s1 still pins the first version
+        BOOST_CHECK(s1.root()["version"] == 1);
+        BOOST_CHECK_EQUAL(doc.retired(), 1);
+        BOOST_CHECK_EQUAL(doc.reclaim(), 0);
+    }
+    BOOST_CHECK_EQUAL(doc.reclaim(), 1);
+    BOOST_CHECK_EQUAL(doc.retired(), 0);
+
+    const var kept = doc.load();
+    doc.publish(make_map("version", 3));
+    BOOST_CHECK_EQUAL(doc.retired(), 0);
+    BOOST_CHECK(kept["version"] == 2);
+    BOOST_CHECK(doc.read().root()["version"] == 3);
+
+    // a loaded tree iterates like any other var
+    var loaded = doc.load();
+    int entries = 0;
+    for (var::const_iterator it = loaded.begin(); it != loaded.end(); ++it) ++entries;
+    BOOST_CHECK_EQUAL(entries, 1);
+}
+
+BOOST_AUTO_TEST_CASE (atomic_document_publish_copies) {
+    atomic_document doc;
+    var config = make_map("routes", make_vector(1)(2));
+    const var kept = config;
+    doc.publish(config);
+
+    // the caller's vars keep mutable nodes of their own
+    BOOST_CHECK(!config.is_frozen());
+    BOOST_CHECK(!kept.is_frozen());
+    config["routes"](3);
+    *config["routes"].begin() = 42;
+    {
+        atomic_document::snapshot s = doc.read();
+        BOOST_CHECK(s.root().is_frozen());
+        BOOST_CHECK(s.root() == make_map("routes", make_vector(1)(2)));
+    }
+
+    // a moved in tree is frozen without a copy
+    var next = make_map("routes", make_vector(5));
+    const var* routes = &static_cast<const var&>(next)["routes"][0];
+    doc.publish(std::move(next));
+    atomic_document::snapshot s = doc.read();
+    BOOST_CHECK(&s.root()["routes"][0] == routes);
+    BOOST_CHECK(s.root()["routes"].is_frozen());
+}
+
+static var make_version(int n) {
+    var v = make_vector();
+    for (int i = 0; i < 64; ++i) v(n);
+    return make_map("version", n)("items", v);
+}
+
+BOOST_AUTO_TEST_CASE (atomic_document_stress) {
+    const int readers = 4, versions = 300;
+    atomic_document doc(make_version(0));
+    std::atomic<bool> done(false);
+    std::atomic<int> failures(0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < readers; ++t)
+        threads.push_back(std::thread([&] {
+            int last = 0;
+            while (!done.load()) {
+                atomic_document::snapshot s = doc.read();
+                const var& root = s.root();
+                int n = root["version"];
+                const var& items = root["items"];
+                if (n < last || items.count() != 64) ++failures;
+                for (int i = 0; i < 64; ++i)
+                    if (int(items[i]) != n) ++failures;
+                last = n;
+            }
+        }));
+
+    for (int n = 1; n <= versions; ++n) doc.publish(make_version(n));
+    done = true;
+    for (int t = 0; t < readers; ++t) threads[t].join();
+
+    BOOST_CHECK_EQUAL(failures.load(), 0);
+    doc.reclaim();
+    BOOST_CHECK_EQUAL(doc.retired(), 0);
+    BOOST_CHECK(doc.read().root()["version"] == versions);
+}
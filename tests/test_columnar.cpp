@@ -0,0 +1,168 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+namespace {
+
+var make_records(int n) {
+    var records = make_vector();
+    for (int i = 0; i < n; ++i) {
+        var record = make_map("id", i)("price", i % 10 * 1.5)("name", i % 3 ? "even" : "odd")("active", i % 2 == 0);
+        if (i % 7 == 0) record("note", "seventh");
+        if (i % 5 == 0) record["price"] = none;
+        records(record);
+    }
+    return records;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE (columnar_schema) {
+    const var records = make_records(130);
+    const column_table table = to_columnar(records);
+    BOOST_CHECK_EQUAL(table.rows(), 130);
+    BOOST_REQUIRE_EQUAL(table.columns().size(), 5);
+    BOOST_CHECK_EQUAL(table.find("id")->type(), column::type_int);
+    BOOST_CHECK_EQUAL(table.find("price")->type(), column::type_double);
+    BOOST_CHECK_EQUAL(table.find("name")->type(), column::type_string);
+    BOOST_CHECK_EQUAL(table.find("active")->type(), column::type_bool);
+    BOOST_CHECK_EQUAL(table.find("note")->type(), column::type_string);
+    BOOST_CHECK(!table.find("missing"));
+
+    const column& id = *table.find("id");
+    BOOST_CHECK_EQUAL(id.ints()[129], 129);
+    BOOST_CHECK(id.at(64) == 64);
+
+    const column& price = *table.find("price");
+    BOOST_CHECK(!price.is_valid(5));
+    BOOST_CHECK(price.has(5));
+    BOOST_CHECK(price.at(5).is_null());
+    BOOST_CHECK_EQUAL(price.doubles()[5], 0.0);
+    BOOST_CHECK(price.at(6) == 9.0);
+
+    const column& note = *table.find("note");
+    BOOST_CHECK(note.has(70));
+    BOOST_CHECK(!note.has(71));
+    BOOST_CHECK(note.string_at(71).empty());
+    BOOST_CHECK(note.string_at(70) == "seventh");
+    BOOST_CHECK_EQUAL(note.offsets().back(), note.chars().size());
+    BOOST_CHECK_THROW(id.string_at(0), exception);
+}
+
+BOOST_AUTO_TEST_CASE (columnar_round_trip) {
+    const var records = make_records(200);
+    BOOST_CHECK(from_columnar(to_columnar(records)) == records);
+
+    // mixed types, collections and wide strings fall back to vars
+    var mixed = make_vector();
+    mixed(make_map("v", 1)("w", L"wide"));
+    mixed(make_map("v", 2.5)("w", make_vector(1)(2)));
+    mixed(make_map("v", "three")(7, none));
+    const column_table table = to_columnar(mixed);
+    BOOST_CHECK_EQUAL(table.find("v")->type(), column::type_var);
+    BOOST_CHECK_EQUAL(table.find("w")->type(), column::type_var);
+    BOOST_CHECK_EQUAL(table.find(7)->type(), column::type_null);
+    BOOST_CHECK(from_columnar(table) == mixed);
+
+    BOOST_CHECK_EQUAL(to_columnar(make_vector()).columns().size(), 0);
+    BOOST_CHECK(from_columnar(to_columnar(make_persistent_vector())) == make_vector());
+    BOOST_CHECK_THROW(to_columnar(make_map()), exception);
+    BOOST_CHECK_THROW(to_columnar(make_vector(1)), exception);
+}
+
+BOOST_AUTO_TEST_CASE (columnar_mixed_numbers) {
+    // JSON numbers: ints and doubles in one field pack as doubles
+    var records = make_vector();
+    records(make_map("n", 5))(make_map("n", 7.5))(make_map("n", none))(make_map("n", 100))(make_map("n", -2.5));
+    const column_table table = to_columnar(records);
+    const column& n = *table.find("n");
+    BOOST_CHECK_EQUAL(n.type(), column::type_double);
+    BOOST_CHECK_EQUAL(n.doubles()[3], 100.0);
+    BOOST_CHECK_EQUAL(n.sum(), 110.0);
+    BOOST_CHECK(n.max() == 100);
+    BOOST_CHECK(n.max().is_int());
+    BOOST_CHECK(n.min() == -2.5);
+    column::bitmap big = n.filter(column::greater, 6);
+    BOOST_CHECK_EQUAL(column::count(big), 2);
+    BOOST_CHECK_EQUAL(n.sum(&big), 107.5);
+
+    // the rows that held ints come back as ints
+    BOOST_CHECK(n.at(0).is_int());
+    BOOST_CHECK(n.at(1).is_double());
+    BOOST_CHECK(from_columnar(table) == records);
+}
+
+BOOST_AUTO_TEST_CASE (columnar_filter) {
+    const column_table table = to_columnar(make_records(130));
+    const column& id = *table.find("id");
+    column::bitmap low = id.filter(column::less, 10);
+    BOOST_CHECK_EQUAL(column::count(low), 10);
+    BOOST_CHECK_EQUAL(column::count(id.filter(column::greater_equal, 64.5)), 65);
+    BOOST_CHECK_EQUAL(column::count(id.filter(column::not_equal, 3)), 129);
+
+    // null rows never match
+    const column& price = *table.find("price");
+    BOOST_CHECK_EQUAL(column::count(price.filter(column::equal, 1)), 0);
+    BOOST_CHECK_EQUAL(column::count(price.filter(column::equal, 1.5)), 13);
+    BOOST_CHECK_EQUAL(column::count(price.filter(column::greater_equal, 0)), 104);
+
+    BOOST_CHECK_EQUAL(column::count(table.find("name")->filter(column::equal, "odd")), 44);
+    BOOST_CHECK_EQUAL(column::count(table.find("name")->filter(column::greater, "a")), 130);
+    BOOST_CHECK_EQUAL(column::count(table.find("active")->filter(column::equal, true)), 65);
+    BOOST_CHECK_EQUAL(column::count(table.find("note")->filter(column::equal, "seventh")), 19);
+    BOOST_CHECK_EQUAL(column::count(id.filter(column::equal, "0")), 0);
+}
+
+BOOST_AUTO_TEST_CASE (columnar_aggregates) {
+    const column_table table = to_columnar(make_records(130));
+    const column& id = *table.find("id");
+    BOOST_CHECK_EQUAL(id.sum(), 129 * 130 / 2);
+    column::bitmap low = id.filter(column::less, 10);
+    BOOST_CHECK_EQUAL(id.sum(&low), 45);
+    BOOST_CHECK_EQUAL(table.find("active")->sum(), 65);
+    BOOST_CHECK_THROW(table.find("name")->sum(), exception);
+    column::bitmap bad(1);
+    BOOST_CHECK_THROW(id.sum(&bad), exception);
+
+    BOOST_CHECK(id.min() == 0);
+    BOOST_CHECK(id.max() == 129);
+    BOOST_CHECK(id.max(&low) == 9);
+    BOOST_CHECK(table.find("price")->min() == 1.5);
+    BOOST_CHECK(table.find("name")->min() == "even");
+    BOOST_CHECK(table.find("name")->max() == "odd");
+    column::bitmap none_selected(low.size());
+    BOOST_CHECK(id.min(&none_selected).is_null());
+
+    BOOST_CHECK_EQUAL(id.count_distinct(), 130);
+    BOOST_CHECK_EQUAL(table.find("price")->count_distinct(), 8);
+    BOOST_CHECK_EQUAL(table.find("name")->count_distinct(), 2);
+    BOOST_CHECK_EQUAL(table.find("active")->count_distinct(&low), 2);
+    BOOST_CHECK_EQUAL(table.find("note")->count_distinct(), 1);
+}
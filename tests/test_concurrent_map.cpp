@@ -0,0 +1,109 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+BOOST_AUTO_TEST_CASE (concurrent_map_basic) {
+    concurrent_map_ptr m = make_concurrent_map(5);
+    BOOST_CHECK_EQUAL(m->shards(), 8);
+    BOOST_CHECK_EQUAL(m->count(), 0);
+
+    BOOST_CHECK(m->insert_or_assign("hello", "world"));
+    BOOST_CHECK(m->insert_or_assign(1, 2.5));
+    BOOST_CHECK(!m->insert_or_assign(1, 3.5));
+    BOOST_CHECK_EQUAL(m->count(), 2);
+
+    var v;
+    BOOST_CHECK(m->find("hello", v));
+    BOOST_CHECK(v == "world");
+    BOOST_CHECK(m->find(1, v));
+    BOOST_CHECK(v == 3.5);
+    BOOST_CHECK(!m->find(2, v));
+    BOOST_CHECK(m->contains(1));
+    BOOST_CHECK(!m->contains(1.0));
+
+    BOOST_CHECK(m->erase(1));
+    BOOST_CHECK(!m->erase(1));
+    BOOST_CHECK_EQUAL(m->count(), 1);
+
+    m->clear();
+    BOOST_CHECK_EQUAL(m->count(), 0);
+    BOOST_CHECK_THROW(concurrent_map(0), dynamic::exception);
+}
+
+static var twice(const var& k) { return var(int(k) * 2); }
+
+BOOST_AUTO_TEST_CASE (concurrent_map_compute_if_absent) {
+    concurrent_map_ptr m = make_concurrent_map();
+    BOOST_CHECK(m->compute_if_absent(21, twice) == 42);
+    m->insert_or_assign(5, "five");
+    BOOST_CHECK(m->compute_if_absent(5, twice) == "five");
+    BOOST_CHECK_EQUAL(m->count(), 2);
+}
+
+BOOST_AUTO_TEST_CASE (concurrent_map_snapshot) {
+    concurrent_map_ptr m = make_concurrent_map(4);
+    for (int i = 0; i < 100; ++i) m->insert_or_assign(i, i * i);
+
+    var s = m->snapshot();
+    BOOST_CHECK(s.is_map());
+    BOOST_CHECK_EQUAL(s.count(), 100);
+    BOOST_CHECK(s[7] == 49);
+
+    m->erase(7);
+    BOOST_CHECK_EQUAL(s.count(), 100);
+    BOOST_CHECK(s[7] == 49);
+}
+
+BOOST_AUTO_TEST_CASE (concurrent_map_threads) {
+    const int threads = 4, per_thread = 1000;
+    concurrent_map_ptr m = make_concurrent_map();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+        workers.push_back(std::thread([m, t] {
+            for (int i = 0; i < per_thread; ++i) {
+                m->insert_or_assign(t * per_thread + i, t);
+                m->compute_if_absent(-i - 1, twice);
+                if (i % 2) m->erase(t * per_thread + i);
+            }
+        }));
+    for (int t = 0; t < threads; ++t) workers[t].join();
+
+    var v;
+    // odd keys of each thread's range were erased, the negative keys were computed once
+    BOOST_CHECK_EQUAL(m->count(), threads * per_thread / 2 + per_thread);
+    BOOST_CHECK(m->find(-10, v));
+    BOOST_CHECK(v == -20);
+    BOOST_CHECK(m->find(per_thread + 2, v));
+    BOOST_CHECK(v == 1);
+    BOOST_CHECK(!m->find(per_thread + 3, v));
+}
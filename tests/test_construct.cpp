@@ -0,0 +1,91 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <iterator>
+#include <list>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+BOOST_AUTO_TEST_CASE (construct_literals) {
+    const var list = { 1, 2.5, "three" };
+    BOOST_CHECK(list.is_vector());
+    BOOST_CHECK(list == make_vector(1)(2.5)("three"));
+
+    const var doc = { { "name", "plover" }, { "sizes", { 1, 2, 3 } }, { "owner", { { "id", 7 } } } };
+    BOOST_CHECK(doc.is_map());
+    BOOST_CHECK(doc == make_map("name", "plover")("sizes", make_vector(1)(2)(3))("owner", make_map("id", 7)));
+
+    // pairs not keyed by strings stay vectors
+    const var pairs = { { 1, 2 }, { 3, 4 } };
+    BOOST_CHECK(pairs.is_vector());
+    BOOST_CHECK(pairs[1] == make_vector(3)(4));
+    const var mixed = { { "a", 1 }, 2 };
+    BOOST_CHECK(mixed.is_vector());
+
+    BOOST_CHECK(var({ 5 }) == make_vector(5));
+    BOOST_CHECK(var{}.is_null());
+    const var copy(list);
+    BOOST_CHECK(copy == list);
+
+    // the first of equal keys wins, as with operator ()
+    const var repeated = { { "a", 1 }, { "a", 2 } };
+    BOOST_CHECK(repeated == make_map("a", 1));
+}
+
+BOOST_AUTO_TEST_CASE (construct_explicit_literals) {
+    BOOST_CHECK(make_vector({ { "a", 1 } }) == make_vector(make_vector("a")(1)));
+    BOOST_CHECK(make_vector({ 1, 2 }) == make_vector(1)(2));
+    BOOST_CHECK(make_vector({}).count() == 0);
+    BOOST_CHECK(make_map({ { 1, "one" }, { 2, "two" } }) == make_map(1, "one")(2, "two"));
+    BOOST_CHECK_THROW(make_map({ 1, 2 }), exception);
+
+    // the existing overloads keep their meaning
+    BOOST_CHECK(make_vector(1) == make_vector()(1));
+    BOOST_CHECK(make_map("a", "b") == make_map()("a", "b"));
+    BOOST_CHECK(make_map(1, 2) == make_map()(1, 2));
+}
+
+BOOST_AUTO_TEST_CASE (construct_ranges) {
+    const std::vector<int> ints = { 3, 1, 2 };
+    BOOST_CHECK(make_vector(ints.begin(), ints.end()) == make_vector(3)(1)(2));
+    const std::list<std::string> names = { "a", "b" };
+    BOOST_CHECK(make_vector(names.begin(), names.end()) == make_vector("a")("b"));
+    std::istringstream in("4 5 6");
+    BOOST_CHECK(make_vector(std::istream_iterator<int>(in), std::istream_iterator<int>()) == make_vector(4)(5)(6));
+    BOOST_CHECK(make_vector(ints.begin(), ints.begin()).count() == 0);
+
+    const std::map<std::string, int> sorted = { { "a", 1 }, { "b", 2 }, { "c", 3 } };
+    BOOST_CHECK(make_map(sorted.begin(), sorted.end()) == make_map("a", 1)("b", 2)("c", 3));
+    const std::vector<std::pair<int, std::string> > unsorted = { { 2, "two" }, { 1, "one" }, { 2, "again" } };
+    BOOST_CHECK(make_map(unsorted.begin(), unsorted.end()) == make_map(1, "one")(2, "two"));
+}
@@ -0,0 +1,151 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+namespace {
+
+struct point {
+    int x;
+    int y;
+    std::optional<std::string> label;
+};
+
+struct shape {
+    std::string name;
+    std::vector<point> points;
+    std::map<std::string, double> weights;
+};
+
+}
+
+DYNAMIC_CONVERT_STRUCT(point, (x)(y)(label))
+DYNAMIC_CONVERT_STRUCT(shape, (name)(points)(weights))
+
+BOOST_AUTO_TEST_CASE (convert_scalars) {
+    BOOST_CHECK(to_var(true) == true);
+    BOOST_CHECK(to_var(short(3)) == 3);
+    BOOST_CHECK(to_var(7u) == 7);
+    BOOST_CHECK(to_var(2.5f) == 2.5);
+    BOOST_CHECK(to_var("abc") == "abc");
+    BOOST_CHECK(to_var(std::wstring(L"w")) == L"w");
+    BOOST_CHECK_THROW(to_var(3000000000LL), exception);
+    BOOST_CHECK_THROW(to_var(3000000000u), exception);
+
+    BOOST_CHECK_EQUAL(from_var<long>(var(-5)), -5);
+    BOOST_CHECK_EQUAL(from_var<double>(var(2)), 2.0);
+    BOOST_CHECK_EQUAL(from_var<std::string>(var("abc")), "abc");
+    BOOST_CHECK_THROW(from_var<unsigned>(var(-1)), exception);
+    BOOST_CHECK_THROW(from_var<unsigned char>(var(300)), exception);
+    BOOST_CHECK_THROW(from_var<int>(var("1")), exception);
+    BOOST_CHECK_THROW(from_var<bool>(var(1)), exception);
+}
+
+BOOST_AUTO_TEST_CASE (convert_containers) {
+    const std::vector<int> ints = { 1, 2, 3 };
+    BOOST_CHECK(to_var(ints) == make_vector(1)(2)(3));
+    BOOST_CHECK(from_var<std::vector<int> >(make_vector(1)(2)(3)) == ints);
+    BOOST_CHECK(from_var<std::vector<int> >(make_vector(0)(1)(2)(3).slice(1, 3)) == ints);
+    BOOST_CHECK_THROW(from_var<std::vector<int> >(make_map()), exception);
+
+    const std::map<std::string, std::vector<double> > series = { { "a", { 1.5 } }, { "b", {} } };
+    const var v = to_var(series);
+    BOOST_CHECK(v == make_map("a", make_vector(1.5))("b", make_vector()));
+    BOOST_CHECK((from_var<std::map<std::string, std::vector<double> > >(v) == series));
+
+    const std::unordered_map<int, std::string> names = { { 1, "one" }, { 2, "two" } };
+    BOOST_CHECK(to_var(names) == make_map(1, "one")(2, "two"));
+    BOOST_CHECK((from_var<std::unordered_map<int, std::string> >(to_var(names)) == names));
+
+    BOOST_CHECK(to_var(std::optional<int>()).is_null());
+    BOOST_CHECK(to_var(std::optional<int>(4)) == 4);
+    BOOST_CHECK(!from_var<std::optional<int> >(none));
+    BOOST_CHECK(*from_var<std::optional<int> >(var(4)) == 4);
+
+    const std::tuple<int, std::string, bool> t(1, "x", false);
+    BOOST_CHECK(to_var(t) == make_vector(1)("x")(false));
+    BOOST_CHECK((from_var<std::tuple<int, std::string, bool> >(to_var(t)) == t));
+    BOOST_CHECK_THROW((from_var<std::tuple<int, int> >(make_vector(1))), exception);
+    BOOST_CHECK(to_var(std::make_pair(1, 2.5)) == make_vector(1)(2.5));
+    BOOST_CHECK((from_var<std::pair<int, double> >(make_vector(1)(2.5)) == std::make_pair(1, 2.5)));
+}
+
+BOOST_AUTO_TEST_CASE (convert_moves) {
+    std::vector<var> items = { make_vector(1)(2), make_map("a", 1) };
+    const var* first = &items[0][0];
+    const var v = to_var(std::move(items));
+    BOOST_CHECK(&v[0][0] == first);
+    BOOST_CHECK(items[0].is_null());
+}
+
+BOOST_AUTO_TEST_CASE (convert_structs) {
+    shape s;
+    s.name = "triangle";
+    s.points = { { 0, 0, std::nullopt }, { 4, 0, std::string("b") }, { 0, 3, std::nullopt } };
+    s.weights = { { "area", 6.0 } };
+
+    const var v = to_var(s);
+    BOOST_CHECK(v["name"] == "triangle");
+    BOOST_CHECK(v["points"][1] == make_map("x", 4)("y", 0)("label", "b"));
+    BOOST_CHECK(v["points"][0]["label"].is_null());
+    BOOST_CHECK(v["weights"]["area"] == 6.0);
+
+    const shape back = from_var<shape>(v);
+    BOOST_CHECK_EQUAL(back.name, "triangle");
+    BOOST_CHECK_EQUAL(back.points.size(), 3);
+    BOOST_CHECK_EQUAL(back.points[2].y, 3);
+    BOOST_CHECK(*back.points[1].label == "b");
+    BOOST_CHECK(!back.points[0].label);
+    BOOST_CHECK(back.weights == s.weights);
+
+    // optional members may be missing, others may not
+    const point p = from_var<point>(make_map("x", 1)("y", 2));
+    BOOST_CHECK(!p.label);
+    BOOST_CHECK_THROW(from_var<point>(make_map("x", 1)), exception);
+
+    // members of a persistent map are looked up the same way
+    var pm = make_persistent_map();
+    for (int i = 0; i != 64; ++i) pm(i, i);
+    pm("y", 5)("x", 4)("label", "c");
+    const point q = from_var<point>(pm);
+    BOOST_CHECK_EQUAL(q.x, 4);
+    BOOST_CHECK_EQUAL(q.y, 5);
+    BOOST_CHECK(*q.label == "c");
+    BOOST_CHECK(!from_var<point>(make_persistent_map()("x", 1)("y", 2)).label);
+    BOOST_CHECK_THROW(from_var<point>(make_persistent_map()("y", 1)), exception);
+    BOOST_CHECK_THROW(from_var<point>(make_vector(1)), exception);
+}
@@ -0,0 +1,157 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+BOOST_AUTO_TEST_CASE (cow_vector) {
+    var a = make_vector(1)(2)(3);
+    var b = a;
+    b(4);
+    b[0] = "one";
+    BOOST_CHECK_EQUAL(a.count(), 3);
+    BOOST_CHECK(a[0] == 1);
+    BOOST_CHECK_EQUAL(b.count(), 4);
+    BOOST_CHECK(b[0] == "one");
+
+    // unshared vectors are modified in place
+    var& first = b[0];
+    b[1] = 20;
+    BOOST_CHECK(&first == &b[0]);
+}
+
+BOOST_AUTO_TEST_CASE (cow_map_path) {
+    var a = make_map("x", make_map("y", 1))("z", make_vector(1)(2));
+    var b = a;
+    b["x"]["y"] = 2;
+    b["x"]("w", 3);
+    BOOST_CHECK(a["x"]["y"] == 1);
+    BOOST_CHECK_EQUAL(a["x"].count(), 1);
+    BOOST_CHECK(b["x"]["y"] == 2);
+    BOOST_CHECK_EQUAL(b["x"].count(), 2);
+
+    // "z" was not on the modified path, so it is still shared, and freezing one
+    // var holding it copies it rather than freezing it for the others
+    const var& ca = a;
+    var za = ca["z"];
+    za.freeze();
+    const var& cb = b;
+    BOOST_CHECK(za.is_frozen());
+    BOOST_CHECK(!ca["z"].is_frozen());
+    BOOST_CHECK(!cb["z"].is_frozen());
+    BOOST_CHECK(cb["z"] == za);
+}
+
+BOOST_AUTO_TEST_CASE (cow_const_lookup) {
+    var a = make_map("x", 1);
+    const var& ca = a;
+    BOOST_CHECK_THROW(ca["missing"], dynamic::exception);
+    BOOST_CHECK_EQUAL(a.count(), 1);
+}
+
+BOOST_AUTO_TEST_CASE (cow_iterators) {
+    var a = make_vector(1)(2)(3);
+    var b = a;
+    for (var::iterator it = b.begin(); it != b.end(); ++it)
+        *it = 0;
+    BOOST_CHECK(a[2] == 3);
+    BOOST_CHECK(b[2] == 0);
+}
+
+BOOST_AUTO_TEST_CASE (cow_references_outlive_copies) {
+    // a reference taken before a copy only ever writes into the original
+    var a = make_vector(1)(2);
+    var& r = a[0];
+    var b = a;
+    r = 99;
+    BOOST_CHECK(a == make_vector(99)(2));
+    BOOST_CHECK(b == make_vector(1)(2));
+
+    var m = make_map("x", make_map("y", 1));
+    var& y = m["x"]["y"];
+    var n;
+    n = m;
+    y = 2;
+    const var& cn = n;
+    BOOST_CHECK(cn["x"]["y"] == 1);
+
+    var::iterator it = a.begin();
+    var c = a;
+    *it = 5;
+    BOOST_CHECK(c[0] == 99);
+    BOOST_CHECK(a[0] == 5);
+
+    var s = a;
+    var& last = s[1];
+    var window = s.slice(0, 2);
+    last = 7;
+    BOOST_CHECK(window[1] == 2);
+
+    var p = make_persistent_vector();
+    for (int i = 0; i < 100; ++i)
+        p(i);
+    var& item = p[40];
+    var q = p;
+    item = -1;
+    BOOST_CHECK(q[40] == 40);
+    BOOST_CHECK(p[40] == -1);
+
+    var pm = make_persistent_map()("k", make_vector(1));
+    var& inner = pm["k"][0];
+    var qm = pm;
+    inner = 2;
+    const var& cqm = qm;
+    BOOST_CHECK(cqm["k"][0] == 1);
+
+    // copies of a chain of references, however deep, stay apart
+    const int depth = 200000;
+    var deep = 0;
+    for (int i = 0; i < depth; ++i)
+        deep = make_vector(deep);
+    var* leaf = &deep;
+    for (int i = 0; i < depth; ++i)
+        leaf = &(*leaf)[0];
+    var copy = deep;
+    *leaf = 1;
+    const var* copied = &copy;
+    for (int i = 0; i < depth; ++i)
+        copied = &(*copied)[0];
+    BOOST_CHECK(*copied == 0);
+}
+
+BOOST_AUTO_TEST_CASE (deep_clone) {
+    var a = make_map("x", make_vector(make_map("y", 1)));
+    a.freeze();
+    var b = a.deep_clone();
+    BOOST_CHECK(!b.is_frozen());
+    BOOST_CHECK(b == a);
+    b["x"][0]["y"] = 2;
+    const var& ca = a;
+    BOOST_CHECK(ca["x"][0]["y"] == 1);
+    BOOST_CHECK(var(5).deep_clone() == 5);
+}
@@ -0,0 +1,115 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+namespace {
+
+/// n records that repeat the same address, tags and status
+var make_records(int n) {
+    var records = make_vector();
+    for (int i = 0; i < n; ++i)
+        records(make_map("id", i)
+                        ("status", "a status string too long for the small buffer")
+                        ("address", make_map("street", "1 Main Street, Springfield")("zip", 12345))
+                        ("tags", make_vector("reference")("imported")));
+    return records;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE (dedupe_shares_subtrees) {
+    var records = make_records(100);
+    const var original = records.deep_clone();
+    const memory_report before = memory_usage(records);
+
+    dedupe_report report = dedupe(records);
+    BOOST_CHECK(records == original);
+    BOOST_CHECK(report.shared > 0);
+    BOOST_CHECK(report.bytes_saved() > 0);
+    BOOST_CHECK_EQUAL(report.bytes_before, before.total());
+
+    // one address map and one record map per id remain
+    const memory_report after = memory_usage(records);
+    BOOST_CHECK_EQUAL(after.total(), report.bytes_after);
+    BOOST_CHECK_EQUAL(after.nodes[payload_map], 101);
+    BOOST_CHECK_EQUAL(after.nodes[payload_vector], 2);
+    // every distinct key and string value once
+    BOOST_CHECK_EQUAL(after.nodes[payload_string], 10);
+    BOOST_CHECK(after.total() < before.total() / 2);
+
+    // a second pass finds nothing left to share
+    BOOST_CHECK_EQUAL(dedupe(records).shared, 0);
+}
+
+BOOST_AUTO_TEST_CASE (dedupe_copy_on_write) {
+    var records = make_records(3);
+    dedupe(records);
+    records[1]["address"]["zip"] = 99999;
+    records[2]["tags"](L"new");
+    BOOST_CHECK(records[0]["address"]["zip"] == 12345);
+    BOOST_CHECK(records[1]["address"]["zip"] == 99999);
+    BOOST_CHECK(records[2]["address"]["zip"] == 12345);
+    BOOST_CHECK_EQUAL(records[0]["tags"].count(), 2);
+    BOOST_CHECK_EQUAL(records[2]["tags"].count(), 3);
+}
+
+BOOST_AUTO_TEST_CASE (dedupe_leaves_frozen_alone) {
+    var frozen_tags = make_vector("reference")("imported").freeze();
+    var doc = make_vector(frozen_tags)(make_vector("reference")("imported"))(frozen_tags.deep_clone().freeze());
+    dedupe_report report = dedupe(doc);
+    // the frozen copies share, the mutable one keeps its own node
+    BOOST_CHECK_EQUAL(report.shared, 1);
+    BOOST_CHECK(doc[0].is_frozen());
+    BOOST_CHECK(doc[2].is_frozen());
+    BOOST_CHECK(!doc[1].is_frozen());
+    BOOST_CHECK(doc[0] == doc[1]);
+
+    var frozen = make_records(10).freeze();
+    BOOST_CHECK_EQUAL(dedupe(frozen).shared, 0);
+
+    var scalar = 42;
+    BOOST_CHECK_EQUAL(dedupe(scalar).shared, 0);
+}
+
+BOOST_AUTO_TEST_CASE (dedupe_deep_tree) {
+    // the pass and the memory_usage() calls around it walk without recursing
+    const int depth = 200000;
+    var first = 1, second = 1;
+    for (int i = 0; i < depth; ++i) {
+        first = make_vector(first);
+        second = make_vector(second);
+    }
+    var doc = make_vector(first)(second);
+    dedupe_report report = dedupe(doc);
+    // every level of the second copy is replaced by the first
+    BOOST_CHECK_EQUAL(report.shared, std::size_t(depth));
+    BOOST_CHECK(report.bytes_saved() > 0);
+    BOOST_CHECK(doc[0] == doc[1]);
+}
@@ -0,0 +1,132 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+BOOST_AUTO_TEST_CASE (freeze_rejects_mutation) {
+    var d = make_map("list", make_vector(1)(2)(3))("name", "fred");
+    BOOST_CHECK(!d.is_frozen());
+    d.freeze();
+    BOOST_CHECK(d.is_frozen());
+    BOOST_CHECK(var(1).is_frozen());
+
+    BOOST_CHECK_THROW(d("age", 35), dynamic::exception);
+    BOOST_CHECK_THROW(d("age"), dynamic::exception);
+    BOOST_CHECK_THROW(d["name"], dynamic::exception);
+    BOOST_CHECK_THROW(d[1], dynamic::exception);
+
+    const var& cd = d;
+    BOOST_CHECK(cd["name"] == "fred");
+    BOOST_CHECK(cd["list"].is_frozen());
+    BOOST_CHECK(cd["list"][2] == 3);
+    BOOST_CHECK_THROW(cd["age"], dynamic::exception);
+    BOOST_CHECK_EQUAL(d.count(), 2);
+
+    var list = cd["list"];
+    BOOST_CHECK_THROW(list(4), dynamic::exception);
+    BOOST_CHECK_THROW(list[0], dynamic::exception);
+
+    // non-const iterators read the frozen nodes but never write into them
+    int sum = 0;
+    for (var::const_iterator it = list.begin(); it != list.end(); ++it) sum += int(*it);
+    BOOST_CHECK_EQUAL(sum, 6);
+    var::iterator it = list.begin();
+    BOOST_CHECK_THROW(*it, dynamic::exception);
+    BOOST_CHECK_THROW(d.begin().pair(), dynamic::exception);
+    BOOST_CHECK(d.rbegin() != d.rend());
+    BOOST_CHECK(*cd["list"].begin() == 1);
+    BOOST_CHECK(list.is_frozen());
+
+    // the var itself can still be rebound
+    d = 5;
+    BOOST_CHECK(d == 5);
+}
+
+BOOST_AUTO_TEST_CASE (freeze_is_shared) {
+    var v = make_vector(make_map("a", 1));
+    var copy = v;
+    frozen_var f = freeze(v);
+    // vars sharing the tree keep mutable nodes of their own
+    BOOST_CHECK(!v.is_frozen());
+    BOOST_CHECK(!copy.is_frozen());
+    copy(2);
+    copy[0]("b", 2);
+    BOOST_CHECK_EQUAL(copy.count(), 2);
+    BOOST_CHECK_EQUAL(f.count(), 1);
+    BOOST_CHECK_EQUAL(f[0].count(), 1);
+
+    // a var frozen after being copied does not freeze its copies
+    var a = make_vector(1)(2);
+    var b = a;
+    b.freeze();
+    a(3);
+    *a.begin() = 42;
+    BOOST_CHECK(a == make_vector(42)(2)(3));
+    BOOST_CHECK(b == make_vector(1)(2));
+    BOOST_CHECK(b.is_frozen());
+
+    // copies of a frozen var share its nodes and stay frozen
+    var c = b;
+    BOOST_CHECK(c.is_frozen());
+    BOOST_CHECK_THROW(c(3), dynamic::exception);
+    BOOST_CHECK(b == make_vector(1)(2));
+
+    BOOST_CHECK_EQUAL(f.count(), 1);
+    BOOST_CHECK(f[0]["a"] == 1);
+    BOOST_CHECK(f.root() == v);
+    int n = 0;
+    for (var::const_iterator it = f.begin(); it != f.end(); ++it) ++n;
+    BOOST_CHECK_EQUAL(n, 1);
+
+    std::stringstream ss;
+    ss << f.root();
+    BOOST_CHECK_EQUAL(ss.str(), "[ { \"a\" : 1 } ]");
+}
+
+BOOST_AUTO_TEST_CASE (frozen_var_threads) {
+    var routes = make_map();
+    for (int i = 0; i < 100; ++i) routes(i, make_vector(i)(i * 2));
+    const frozen_var table(routes);
+
+    std::vector<std::thread> readers;
+    std::vector<int> sums(4, 0);
+    for (int t = 0; t < 4; ++t)
+        readers.push_back(std::thread([&table, &sums, t] {
+            for (int i = 0; i < 100; ++i)
+                sums[t] += int(table[i][1]);
+        }));
+    for (int t = 0; t < 4; ++t) {
+        readers[t].join();
+        BOOST_CHECK_EQUAL(sums[t], 9900);
+    }
+}
@@ -0,0 +1,132 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+namespace {
+
+var make_sales(int n) {
+    static const char* regions[] = { "north", "south", "east" };
+    var sales = make_vector();
+    for (int i = 0; i < n; ++i)
+        sales(make_map("region", regions[i % 3])("date", make_map("year", 2020 + i % 2))("units", i % 4)("price", i * 0.5));
+    return sales;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE (group_by_aggregates) {
+    const var sales = make_sales(12);
+    var report = group_by().key("region", "/region")
+                           .count("n").sum("units", "/units").sum("revenue", "/price").min("low", "/price")
+                           .max("high", "/units").avg("mean", "/units").collect("all", "/units")
+                           .run(sales);
+    BOOST_REQUIRE_EQUAL(report.count(), 3);
+    // groups in order of first appearance
+    BOOST_CHECK(report[0]["region"] == "north");
+    BOOST_CHECK(report[1]["region"] == "south");
+    BOOST_CHECK(report[2]["region"] == "east");
+
+    // north has records 0, 3, 6 and 9
+    const var& north = report[0];
+    BOOST_CHECK(north["n"] == 4);
+    BOOST_CHECK(north["units"] == 0 + 3 + 2 + 1);
+    BOOST_CHECK(north["units"].is_int());
+    BOOST_CHECK(north["revenue"] == 9.0);
+    BOOST_CHECK(north["low"] == 0.0);
+    BOOST_CHECK(north["high"] == 3);
+    BOOST_CHECK(north["mean"] == 1.5);
+    BOOST_CHECK(north["all"] == make_vector(0)(3)(2)(1));
+}
+
+BOOST_AUTO_TEST_CASE (group_by_composite_keys) {
+    const var sales = make_sales(12);
+    var report = group_by().key("region", "/region").key("year", "/date/year").count("n").run(sales);
+    BOOST_REQUIRE_EQUAL(report.count(), 6);
+    BOOST_CHECK(report[0] == make_map("region", "north")("year", 2020)("n", 2));
+    BOOST_CHECK(report[4] == make_map("region", "south")("year", 2020)("n", 2));
+
+    // no keys: one group over every record
+    report = group_by().count("n").sum("units", "/units").run(sales);
+    BOOST_CHECK(report == make_vector(make_map("n", 12)("units", 18)));
+}
+
+BOOST_AUTO_TEST_CASE (group_by_missing_values) {
+    var records = make_vector();
+    records(make_map("k", 1)("v", 2));
+    records(make_map("v", 3));
+    records(make_map("k", 1)("v", none));
+    records(make_map("k", none)("v", 1.5));
+    var report = group_by().key("k", "/k").count("n").sum("sum", "/v").avg("avg", "/v").min("min", "/w").run(records);
+    BOOST_REQUIRE_EQUAL(report.count(), 2);
+    BOOST_CHECK(report[0] == make_map("k", 1)("n", 2)("sum", 2)("avg", 2.0)("min", none));
+    BOOST_CHECK(report[1] == make_map("k", none)("n", 2)("sum", 4.5)("avg", 2.25)("min", none));
+
+    BOOST_CHECK(group_by().key("k", "/k").count("n").run(make_vector()) == make_vector());
+    BOOST_CHECK_THROW(group_by().sum("s", "/k").run(make_vector(make_map("k", "text"))), exception);
+    BOOST_CHECK_THROW(group_by().count("n").run(make_map()), exception);
+}
+
+BOOST_AUTO_TEST_CASE (group_by_int_overflow) {
+    var records = make_vector(make_map("v", 2000000000))(make_map("v", 2000000000));
+    var report = group_by().sum("s", "/v").run(records);
+    BOOST_CHECK(report[0]["s"] == 4000000000.0);
+}
+
+BOOST_AUTO_TEST_CASE (group_by_mixed_numbers) {
+    var records = make_vector(make_map("v", 5))(make_map("v", 7.5))(make_map("v", 100));
+    var report = group_by().min("low", "/v").max("high", "/v").run(records);
+    BOOST_CHECK(report[0]["low"] == 5);
+    BOOST_CHECK(report[0]["high"] == 100);
+
+    // the chunks' tables merge by value too
+    records = make_vector();
+    for (int i = 0; i != int(group_by::min_chunk) * 2; ++i)
+        records(make_map("v", i < int(group_by::min_chunk) ? var(i % 10 + 0.5) : var(i % 10 + 50)));
+    const group_by spec = group_by().min("low", "/v").max("high", "/v");
+    report = spec.run(records, 2);
+    BOOST_CHECK(report[0]["low"] == 0.5);
+    BOOST_CHECK(report[0]["high"] == 59);
+    BOOST_CHECK(report == spec.run(records, 1));
+}
+
+BOOST_AUTO_TEST_CASE (group_by_threads) {
+    const var sales = make_sales(int(group_by::min_chunk) * 3 + 11);
+    const group_by spec = group_by().key("region", "/region").key("year", "/date/year")
+                                    .count("n").sum("units", "/units").min("low", "/price").max("high", "/price")
+                                    .collect("all", "/units");
+    var serial = spec.run(sales, 1);
+    BOOST_CHECK_EQUAL(serial.count(), 6);
+    BOOST_CHECK(spec.run(sales, 3) == serial);
+
+    var bad = make_sales(int(group_by::min_chunk) * 2);
+    bad[int(group_by::min_chunk) + 1]["units"] = "many";
+    BOOST_CHECK_THROW(spec.run(bad, 2), exception);
+    BOOST_CHECK_THROW(group_by().sum("s", "/units").run(bad, 2), exception);
+}
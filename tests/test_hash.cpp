@@ -0,0 +1,122 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+namespace {
+
+var make_doc() {
+    return make_map("name", "widget")("size", 3)("price", 9.5)("tags", make_vector("a")(L"b")(make_map(1, 2)));
+}
+
+}
+
+BOOST_AUTO_TEST_CASE (hash_consistent_with_equality) {
+    BOOST_CHECK_EQUAL(hash(make_doc()), hash(make_doc()));
+    BOOST_CHECK(fingerprint_of(make_doc()) == fingerprint_of(make_doc()));
+    BOOST_CHECK_EQUAL(hash(var(0.0)), hash(var(-0.0)));
+    BOOST_CHECK_EQUAL(hash(var("text")), hash(var(std::string("text"))));
+
+    // insertion order does not matter to either map type
+    BOOST_CHECK_EQUAL(hash(make_map(1, "one")(2, "two")), hash(make_map(2, "two")(1, "one")));
+    var p1 = make_persistent_map(), p2 = make_persistent_map();
+    for (int i = 0; i < 100; ++i) {
+        p1(i, i * 2);
+        p2(99 - i, (99 - i) * 2);
+    }
+    BOOST_CHECK(p1 == p2);
+    BOOST_CHECK_EQUAL(hash(p1), hash(p2));
+
+    std::hash<var> hasher;
+    BOOST_CHECK_EQUAL(hasher(make_doc()), hash(make_doc()));
+}
+
+BOOST_AUTO_TEST_CASE (hash_distinguishes_structure) {
+    BOOST_CHECK(hash(var(1)) != hash(var(1.0)));
+    BOOST_CHECK(hash(var(1)) != hash(var(true)));
+    BOOST_CHECK(hash(var("a")) != hash(var(L"a")));
+    BOOST_CHECK(hash(var("")) != hash(none));
+    BOOST_CHECK(hash(make_vector()) != hash(make_map()));
+    BOOST_CHECK(hash(make_vector(1)(2)) != hash(make_vector(2)(1)));
+    BOOST_CHECK(hash(make_vector(make_vector(1))(2)) != hash(make_vector(make_vector(1)(2))));
+    BOOST_CHECK(hash(make_map(1, 2)) != hash(make_vector(1)(2)));
+    BOOST_CHECK(hash(make_vector(1)(2)) != hash(make_persistent_vector()(1)(2)));
+
+    var a = make_doc(), b = make_doc();
+    b["tags"][2][1] = 3;
+    BOOST_CHECK(fingerprint_of(a) != fingerprint_of(b));
+}
+
+BOOST_AUTO_TEST_CASE (hash_unordered_containers) {
+    std::unordered_set<var> seen;
+    for (int i = 0; i < 100; ++i) {
+        seen.insert(make_vector(i % 10)("x"));
+        seen.insert(make_doc());
+    }
+    BOOST_CHECK_EQUAL(seen.size(), 11);
+    BOOST_CHECK(seen.count(make_doc()) == 1);
+
+    std::unordered_map<var, int> counts;
+    ++counts[make_map("k", 1)];
+    ++counts[make_map("k", 1)];
+    ++counts[make_map("k", 2)];
+    BOOST_CHECK_EQUAL(counts[make_map("k", 1)], 2);
+    BOOST_CHECK_EQUAL(counts.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE (fingerprint_stable) {
+    // fixed digests, so fingerprints stored by one process stay valid in the next
+    BOOST_CHECK_EQUAL(fingerprint_of(none).str(), fingerprint_of(var()).str());
+    BOOST_CHECK_EQUAL(fingerprint_of(var(42)).str().size(), 32);
+    BOOST_CHECK_EQUAL(fingerprint_of(var(42)).str(), "07134018a32147febcd1e55c4a7f80fa");
+    BOOST_CHECK_EQUAL(fingerprint_of(make_doc()).str(), "21814a0dd2ef856e0d6e7b6318096166");
+}
+
+BOOST_AUTO_TEST_CASE (fingerprint_memo) {
+    var doc = make_doc();
+    const fingerprint mutable_fp = fingerprint_of(doc);
+    doc.freeze();
+    BOOST_CHECK(fingerprint_of(doc) == mutable_fp);
+    // the second call is served from the memo
+    BOOST_CHECK(fingerprint_of(doc) == mutable_fp);
+
+    // a tree sharing the frozen subtree reuses its fingerprint
+    var outer = make_vector(doc)(doc);
+    BOOST_CHECK(fingerprint_of(outer) == fingerprint_of(make_vector(make_doc())(make_doc())));
+
+    // a clone can be modified, and does not inherit the memo
+    var copy = doc.deep_clone();
+    BOOST_CHECK(fingerprint_of(copy) == mutable_fp);
+    copy["size"] = 4;
+    BOOST_CHECK(fingerprint_of(copy) != mutable_fp);
+    BOOST_CHECK(fingerprint_of(doc) == mutable_fp);
+}
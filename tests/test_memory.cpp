@@ -0,0 +1,132 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+///
+/// installs an allocation_counter for the lifetime of the test
+///
+struct counting {
+    counting() : previous(set_allocation_hook(&counter)) {}
+    ~counting() { set_allocation_hook(previous); }
+
+    allocation_counter counter;
+    allocation_hook* previous;
+};
+
+BOOST_AUTO_TEST_CASE (allocation_counts) {
+    counting c;
+    {
+        var v = make_vector("a long enough string to leave the small buffer")(L"a wide string")(make_map(1, 2));
+        // the node and the character buffer
+        BOOST_CHECK_EQUAL(c.counter.allocations(payload_string), 2);
+        BOOST_CHECK_EQUAL(c.counter.allocations(payload_wstring), 2);
+        BOOST_CHECK(c.counter.allocations(payload_vector) >= 2);
+        BOOST_CHECK_EQUAL(c.counter.allocations(payload_map), 2);
+        BOOST_CHECK(c.counter.bytes_in_use(payload_vector) > 0);
+        BOOST_CHECK_EQUAL(c.counter.frees(payload_map), 0);
+    }
+    for (int kind = 0; kind < payload_kind_count; ++kind) {
+        BOOST_CHECK_EQUAL(c.counter.allocations(payload_kind(kind)), c.counter.frees(payload_kind(kind)));
+        BOOST_CHECK_EQUAL(c.counter.bytes_in_use(payload_kind(kind)), 0);
+    }
+    BOOST_CHECK_EQUAL(c.counter.bytes_in_use(), 0);
+
+    c.counter.reset();
+    BOOST_CHECK_EQUAL(c.counter.allocations(payload_string), 0);
+}
+
+BOOST_AUTO_TEST_CASE (allocation_copies_share) {
+    counting c;
+    var a = make_vector(1)(2)(3);
+    const std::size_t allocations = c.counter.allocations(payload_vector);
+    var b = a;
+    var d = b;
+    BOOST_CHECK_EQUAL(c.counter.allocations(payload_vector), allocations);
+    b(4);
+    BOOST_CHECK(c.counter.allocations(payload_vector) > allocations);
+}
+
+BOOST_AUTO_TEST_CASE (allocation_frozen_rejects_free) {
+    var big = make_map();
+    for (int i = 0; i < 1000; ++i)
+        big(i, i);
+    big.freeze();
+    counting c;
+    // a rejected modification of a shared frozen map copies nothing
+    var reader = big;
+    BOOST_CHECK_THROW(reader[5], exception);
+    BOOST_CHECK_THROW(reader("x", 1), exception);
+    BOOST_CHECK_THROW(reader.erase(5), exception);
+    BOOST_CHECK_EQUAL(c.counter.allocations(payload_map), 0);
+    BOOST_CHECK(reader.is_frozen());
+    BOOST_CHECK(reader == big);
+}
+
+BOOST_AUTO_TEST_CASE (memory_usage_scalars) {
+    memory_report r = memory_usage(var(42));
+    BOOST_CHECK_EQUAL(r.inline_bytes, sizeof(var));
+    BOOST_CHECK_EQUAL(r.total(), sizeof(var));
+
+    r = memory_usage(var("short"));
+    BOOST_CHECK_EQUAL(r.nodes[payload_string], 1);
+    BOOST_CHECK(r.bytes[payload_string] > 0);
+
+    memory_report large = memory_usage(var(std::string(1000, 'x')));
+    BOOST_CHECK(large.bytes[payload_string] >= r.bytes[payload_string] + 1000);
+}
+
+BOOST_AUTO_TEST_CASE (memory_usage_shared_once) {
+    var big = std::string(1000, 'x');
+    var inner = make_vector(big)(big);
+    memory_report one = memory_usage(inner);
+    BOOST_CHECK_EQUAL(one.nodes[payload_string], 1);
+    BOOST_CHECK_EQUAL(one.nodes[payload_vector], 1);
+
+    // the same vector twice is counted once
+    var outer = make_map(1, inner)(2, inner);
+    memory_report two = memory_usage(outer);
+    BOOST_CHECK_EQUAL(two.nodes[payload_vector], 1);
+    BOOST_CHECK_EQUAL(two.nodes[payload_map], 1);
+    BOOST_CHECK_EQUAL(two.bytes[payload_string], one.bytes[payload_string]);
+    BOOST_CHECK_EQUAL(two.bytes[payload_vector], one.bytes[payload_vector]);
+}
+
+BOOST_AUTO_TEST_CASE (memory_usage_persistent_versions) {
+    var v1 = make_persistent_vector();
+    for (int i = 0; i < 10000; ++i)
+        v1(i);
+    var v2 = v1;
+    v2[0] = -1;
+    memory_report one = memory_usage(v1);
+    memory_report both = memory_usage(make_vector(v1)(v2));
+    // the second version only adds the copied path
+    BOOST_CHECK(both.bytes[payload_persistent] > one.bytes[payload_persistent]);
+    BOOST_CHECK(both.bytes[payload_persistent] < one.bytes[payload_persistent] * 11 / 10);
+}
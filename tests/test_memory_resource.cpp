@@ -0,0 +1,112 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <memory_resource>
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+///
+/// memory resource that counts the bytes it hands out
+///
+class counting_resource : public std::pmr::memory_resource {
+public :
+    counting_resource() : allocations(0), bytes(0) {}
+
+    std::size_t allocations;
+    std::size_t bytes;
+
+private :
+    void* do_allocate(std::size_t n, std::size_t alignment) {
+        ++allocations;
+        bytes += n;
+        return std::pmr::new_delete_resource()->allocate(n, alignment);
+    }
+    void do_deallocate(void* p, std::size_t n, std::size_t alignment) {
+        bytes -= n;
+        std::pmr::new_delete_resource()->deallocate(p, n, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept { return this == &other; }
+};
+
+BOOST_AUTO_TEST_CASE (resource_scope) {
+    counting_resource pool;
+    BOOST_CHECK(current_memory_resource() == 0);
+    {
+        memory_resource_scope scope(&pool);
+        BOOST_CHECK(current_memory_resource() == &pool);
+        {
+            counting_resource inner;
+            memory_resource_scope nested(&inner);
+            BOOST_CHECK(current_memory_resource() == &inner);
+        }
+        BOOST_CHECK(current_memory_resource() == &pool);
+    }
+    BOOST_CHECK(current_memory_resource() == 0);
+}
+
+BOOST_AUTO_TEST_CASE (resource_propagates) {
+    counting_resource pool;
+    var doc;
+    {
+        memory_resource_scope scope(&pool);
+        doc = make_map("name", "a string long enough to need its own buffer")
+                      ("items", make_vector(1)(2)(L"a wide string long enough for a buffer"))
+                      ("versions", make_persistent_vector()(1)(2));
+    }
+    BOOST_CHECK(pool.allocations > 0);
+    const std::size_t bytes = pool.bytes;
+    BOOST_CHECK(bytes > 0);
+
+    // reading outside the scope allocates nothing
+    const var& cdoc = doc;
+    BOOST_CHECK(cdoc["items"][2] == L"a wide string long enough for a buffer");
+    BOOST_CHECK_EQUAL(pool.bytes, bytes);
+
+    // a copy-on-write copy made outside the scope goes to the global heap
+    var copy = doc;
+    copy["items"](3);
+    BOOST_CHECK_EQUAL(pool.bytes, bytes);
+
+    // every node returns its memory to the pool, even outside the scope
+    doc = none;
+    copy = none;
+    BOOST_CHECK_EQUAL(pool.bytes, 0);
+}
+
+BOOST_AUTO_TEST_CASE (resource_monotonic) {
+    char buffer[64 * 1024];
+    std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+    memory_resource_scope scope(&arena);
+    var list = make_vector();
+    for (int i = 0; i < 100; ++i)
+        list(make_map("id", i)("name", "record"));
+    BOOST_CHECK_EQUAL(list.count(), 100);
+    const var& clist = list;
+    BOOST_CHECK(clist[99]["id"] == 99);
+}
@@ -0,0 +1,124 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+BOOST_AUTO_TEST_CASE (mutation_vector) {
+    var list = make_vector(0)(1)(2)(3)(4);
+    list.erase(1);
+    BOOST_CHECK(list == make_vector(0)(2)(3)(4));
+    list.erase(1, 3);
+    BOOST_CHECK(list == make_vector(0)(4));
+    list.insert(1, "x").insert(3, 5);
+    BOOST_CHECK(list == make_vector(0)("x")(4)(5));
+    list.pop_back();
+    BOOST_CHECK(list == make_vector(0)("x")(4));
+    list.reserve(100).shrink_to_fit();
+    BOOST_CHECK_EQUAL(list.count(), 3);
+
+    BOOST_CHECK_THROW(list.erase(3), exception);
+    BOOST_CHECK_THROW(list.erase("a"), exception);
+    BOOST_CHECK_THROW(list.erase(2, 4), exception);
+    BOOST_CHECK_THROW(list.insert(4, 1), exception);
+    BOOST_CHECK_THROW(make_vector().pop_back(), exception);
+    BOOST_CHECK_THROW(var(1).insert(0, 1), exception);
+    BOOST_CHECK_THROW(make_map().reserve(1), exception);
+
+    list.clear();
+    BOOST_CHECK(list.is_vector());
+    BOOST_CHECK_EQUAL(list.count(), 0);
+}
+
+BOOST_AUTO_TEST_CASE (mutation_moves) {
+    var item = make_vector(1)(2);
+    const var* items = &item[0];
+    var list = make_vector();
+    list.insert(0, std::move(item));
+    BOOST_CHECK(&list[0][0] == items);
+
+    var source = make_vector("b")("c");
+    var target = make_vector("a")("d");
+    target.reserve(4).splice(1, source);
+    BOOST_CHECK(target == make_vector("a")("b")("c")("d"));
+    BOOST_CHECK_EQUAL(source.count(), 0);
+}
+
+BOOST_AUTO_TEST_CASE (mutation_map) {
+    var map = make_map("a", 1)("b", 2)("c", 3);
+    map.erase("b").erase("z");
+    BOOST_CHECK(map == make_map("a", 1)("c", 3));
+
+    var other = make_map("c", 30)("d", 4)("e", 5);
+    const var* d = &other["d"];
+    map.splice(other, "d");
+    BOOST_CHECK(&map["d"] == d);
+    BOOST_CHECK(other == make_map("c", 30)("e", 5));
+
+    // an existing key is not overwritten and stays in the source
+    map.splice(other, "c").splice(other, "z");
+    BOOST_CHECK(map["c"] == 3);
+    map.splice(other);
+    BOOST_CHECK(map == make_map("a", 1)("c", 3)("d", 4)("e", 5));
+    BOOST_CHECK(other == make_map("c", 30));
+
+    var list = make_vector(1);
+    BOOST_CHECK_THROW(map.splice(list), exception);
+    map.clear();
+    BOOST_CHECK(map.is_map());
+    BOOST_CHECK_EQUAL(map.count(), 0);
+}
+
+BOOST_AUTO_TEST_CASE (mutation_copy_on_write) {
+    const var original = make_vector(1)(2)(3);
+    var copy = original;
+    copy.erase(0);
+    BOOST_CHECK(original == make_vector(1)(2)(3));
+    BOOST_CHECK(copy == make_vector(2)(3));
+
+    var shared = original;
+    shared.clear();
+    BOOST_CHECK_EQUAL(original.count(), 3);
+
+    // a slice becomes a vector of its own
+    var page = original.slice(1, 2);
+    page.insert(0, 0);
+    BOOST_CHECK(page.is_vector());
+    BOOST_CHECK(page == make_vector(0)(2)(3));
+    BOOST_CHECK(original == make_vector(1)(2)(3));
+
+    var frozen = make_vector(1)(2);
+    frozen.freeze();
+    BOOST_CHECK_THROW(frozen.erase(0), exception);
+    BOOST_CHECK_THROW(frozen.clear(), exception);
+    var frozen_map = make_map("a", 1);
+    frozen_map.freeze();
+    var source = make_map("b", 2);
+    BOOST_CHECK_THROW(frozen_map.splice(source, "b"), exception);
+    BOOST_CHECK(source == make_map("b", 2));
+}
@@ -0,0 +1,118 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+namespace {
+
+var make_doc() {
+    return make_map("a", make_map("b", make_vector(0)(1)(2)(make_map("c", "deep"))))
+                   ("a/b", 1)
+                   ("m~n", 2)
+                   ("", 3)
+                   (7, "int key")
+                   ("07", "string key");
+}
+
+}
+
+BOOST_AUTO_TEST_CASE (path_find) {
+    const var doc = make_doc();
+    BOOST_CHECK(*path("/a/b/3/c").find(doc) == "deep");
+    BOOST_CHECK(*path("/a/b/1").find(doc) == 1);
+    BOOST_CHECK(path("").find(doc) == &doc);
+    BOOST_CHECK_EQUAL(path("").size(), 0);
+    BOOST_CHECK_EQUAL(path("/a/b/3/c").size(), 4);
+    BOOST_CHECK_EQUAL(path("/a/b/3/c").str(), "/a/b/3/c");
+
+    // escapes and the empty key
+    BOOST_CHECK(*path("/a~1b").find(doc) == 1);
+    BOOST_CHECK(*path("/m~0n").find(doc) == 2);
+    BOOST_CHECK(*path("/").find(doc) == 3);
+
+    // digits name an int key when there is no such string key
+    BOOST_CHECK(*path("/7").find(doc) == "int key");
+    BOOST_CHECK(*path("/07").find(doc) == "string key");
+
+    // misses
+    BOOST_CHECK(!path("/x").find(doc));
+    BOOST_CHECK(!path("/a/b/4").find(doc));
+    BOOST_CHECK(!path("/a/b/-").find(doc));
+    BOOST_CHECK(!path("/a/b/01").find(doc));
+    BOOST_CHECK(!path("/a/b/c").find(doc));
+    BOOST_CHECK(!path("/a/b/0/c").find(doc));
+    BOOST_CHECK(!path("/a/b/3/c/d").find(var("scalar")));
+
+    var p = make_persistent_map()("list", make_persistent_vector()("x")("y"));
+    BOOST_CHECK(*path("/list/1").find(p) == "y");
+    BOOST_CHECK(!path("/list/2").find(p));
+}
+
+BOOST_AUTO_TEST_CASE (path_invalid) {
+    BOOST_CHECK_THROW(path("a/b"), dynamic::exception);
+    BOOST_CHECK_THROW(path("/a~2"), dynamic::exception);
+    BOOST_CHECK_THROW(path("/a~"), dynamic::exception);
+}
+
+BOOST_AUTO_TEST_CASE (path_set) {
+    var doc;
+    path("/a/b/0/c").set(doc, "created");
+    BOOST_CHECK(doc.is_map());
+    BOOST_CHECK(doc["a"]["b"].is_vector());
+    BOOST_CHECK(doc["a"]["b"][0]["c"] == "created");
+
+    path("/a/b/-").set(doc, 1);
+    path("/a/b/2").set(doc, 2);
+    BOOST_CHECK_EQUAL(doc["a"]["b"].count(), 3);
+    BOOST_CHECK(doc["a"]["b"][2] == 2);
+    path("/a/b/0").set(doc, "replaced");
+    BOOST_CHECK(doc["a"]["b"][0] == "replaced");
+    BOOST_CHECK_THROW(path("/a/b/9").set(doc, 0), dynamic::exception);
+    BOOST_CHECK_THROW(path("/a/b/x").set(doc, 0), dynamic::exception);
+    BOOST_CHECK_THROW(path("/a/b/1/x").set(doc, 0), dynamic::exception);
+
+    // copies are not affected
+    var copy = doc;
+    path("/a/new").set(doc, true);
+    BOOST_CHECK(*path("/a/new").find(doc) == true);
+    BOOST_CHECK(!path("/a/new").find(copy));
+
+    // an int key is updated in place
+    var ints = make_map(7, "old");
+    path("/7").set(ints, "new");
+    BOOST_CHECK_EQUAL(ints.count(), 1);
+    BOOST_CHECK(ints[7] == "new");
+
+    var frozen = make_map("k", 1).freeze();
+    BOOST_CHECK_THROW(path("/k").set(frozen, 2), dynamic::exception);
+
+    var root = 1;
+    path("").set(root, "whole");
+    BOOST_CHECK(root == "whole");
+}
@@ -0,0 +1,168 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <sstream>
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+BOOST_AUTO_TEST_CASE (persistent_vector_push_back) {
+    var v = make_persistent_vector();
+    BOOST_CHECK(v.is_persistent_vector());
+    BOOST_CHECK(v.is_collection());
+    for (int i = 0; i < 33000; ++i)
+        v(i);
+    BOOST_CHECK_EQUAL(v.count(), 33000);
+    const var& cv = v;
+    BOOST_CHECK(cv[0] == 0);
+    BOOST_CHECK(cv[31] == 31);
+    BOOST_CHECK(cv[32] == 32);
+    BOOST_CHECK(cv[1023] == 1023);
+    BOOST_CHECK(cv[1024] == 1024);
+    BOOST_CHECK(cv[32767] == 32767);
+    BOOST_CHECK(cv[32999] == 32999);
+    BOOST_CHECK_THROW(cv[33000], dynamic::exception);
+    BOOST_CHECK_THROW(cv[-1], dynamic::exception);
+
+    int expected = 0;
+    for (var::const_iterator it = cv.begin(); it != cv.end(); ++it)
+        BOOST_CHECK(*it == expected++);
+    BOOST_CHECK_EQUAL(expected, 33000);
+}
+
+BOOST_AUTO_TEST_CASE (persistent_vector_versions) {
+    var v1 = make_persistent_vector();
+    for (int i = 0; i < 2000; ++i)
+        v1(i);
+    var v2 = v1;
+    v2[5] = "five";
+    v2[1500] = "fifteen hundred";
+    v2(2000);
+    const var& c1 = v1;
+    const var& c2 = v2;
+    BOOST_CHECK_EQUAL(v1.count(), 2000);
+    BOOST_CHECK(c1[5] == 5);
+    BOOST_CHECK(c1[1500] == 1500);
+    BOOST_CHECK_EQUAL(v2.count(), 2001);
+    BOOST_CHECK(c2[5] == "five");
+    BOOST_CHECK(c2[1500] == "fifteen hundred");
+    BOOST_CHECK(c2[2000] == 2000);
+    BOOST_CHECK(c2[6] == 6);
+    BOOST_CHECK(v1 != v2);
+}
+
+BOOST_AUTO_TEST_CASE (persistent_map_basic) {
+    var m = make_persistent_map();
+    BOOST_CHECK(m.is_persistent_map());
+    for (int i = 0; i < 5000; ++i)
+        m(i, i * 2);
+    m("name", "value");
+    BOOST_CHECK_EQUAL(m.count(), 5001);
+    const var& cm = m;
+    BOOST_CHECK(cm[0] == 0);
+    BOOST_CHECK(cm[4999] == 9998);
+    BOOST_CHECK(cm["name"] == "value");
+    BOOST_CHECK_THROW(cm["missing"], dynamic::exception);
+
+    // inserting an existing key keeps the count
+    m(7, 70);
+    BOOST_CHECK_EQUAL(m.count(), 5001);
+    m[7] = 70;
+    BOOST_CHECK(cm[7] == 70);
+
+    int seen = 0;
+    for (var::const_iterator it = cm.begin(); it != cm.end(); ++it, ++seen)
+        BOOST_CHECK(cm[*it] == it.pair().second);
+    BOOST_CHECK_EQUAL(seen, 5001);
+}
+
+BOOST_AUTO_TEST_CASE (persistent_map_versions) {
+    var m1 = make_persistent_map();
+    for (int i = 0; i < 100; ++i)
+        m1(i, i);
+    var m2 = m1;
+    m2[10] = "ten";
+    m2(100, 100);
+    const var& c1 = m1;
+    const var& c2 = m2;
+    BOOST_CHECK_EQUAL(m1.count(), 100);
+    BOOST_CHECK(c1[10] == 10);
+    BOOST_CHECK_THROW(c1[100], dynamic::exception);
+    BOOST_CHECK_EQUAL(m2.count(), 101);
+    BOOST_CHECK(c2[10] == "ten");
+    BOOST_CHECK(c2[100] == 100);
+}
+
+BOOST_AUTO_TEST_CASE (persistent_equality) {
+    var a = make_persistent_map();
+    var b = make_persistent_map();
+    for (int i = 0; i < 50; ++i)
+        a(i, i);
+    for (int i = 49; i >= 0; --i)
+        b(i, i);
+    BOOST_CHECK(a == b);
+    b[3] = 4;
+    BOOST_CHECK(a != b);
+
+    var x = make_persistent_vector()(1)(2);
+    var y = make_persistent_vector()(1)(2);
+    BOOST_CHECK(x == y);
+    y(3);
+    BOOST_CHECK(x != y);
+}
+
+BOOST_AUTO_TEST_CASE (persistent_frozen) {
+    var v = make_persistent_vector()(1)(2);
+    var m = make_persistent_map()("a", 1);
+    v.freeze();
+    m.freeze();
+    BOOST_CHECK(v.is_frozen());
+    BOOST_CHECK_THROW(v(3), dynamic::exception);
+    BOOST_CHECK_THROW(v[0] = 3, dynamic::exception);
+    BOOST_CHECK_THROW(m("b", 2), dynamic::exception);
+    BOOST_CHECK_THROW(m["a"] = 2, dynamic::exception);
+
+    var copy = v.deep_clone();
+    BOOST_CHECK(!copy.is_frozen());
+    copy(3);
+    BOOST_CHECK_EQUAL(copy.count(), 3);
+    BOOST_CHECK_EQUAL(v.count(), 2);
+}
+
+BOOST_AUTO_TEST_CASE (persistent_iterators) {
+    var v = make_persistent_vector()(1)(2);
+    var::iterator it = v.begin();
+    BOOST_CHECK_THROW(*it, dynamic::exception);
+    BOOST_CHECK_THROW(v.rbegin(), dynamic::exception);
+}
+
+BOOST_AUTO_TEST_CASE (persistent_write) {
+    std::ostringstream os;
+    os << make_persistent_vector()(1)("two");
+    BOOST_CHECK_EQUAL(os.str(), "[ 1, \"two\" ]");
+}
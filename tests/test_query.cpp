@@ -0,0 +1,147 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <atomic>
+#include <new>
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+namespace {
+
+var make_orders(int n) {
+    var items = make_vector();
+    for (int i = 0; i < n; ++i)
+        items(make_map("id", i)("price", i % 20 + 0.5)("name", "item")("stock", make_map("count", i % 3)));
+    return make_map("items", items)("owner", "shop");
+}
+
+/// fails every map allocation while armed
+struct failing_maps : allocation_hook {
+    failing_maps() : armed(false), previous(set_allocation_hook(this)) {}
+    ~failing_maps() { set_allocation_hook(previous); }
+
+    void* allocate(std::size_t bytes, payload_kind kind) {
+        if (armed && kind == payload_map) throw std::bad_alloc();
+        return ::operator new(bytes);
+    }
+    void deallocate(void* p, std::size_t, payload_kind) { ::operator delete(p); }
+
+    std::atomic<bool> armed;
+    allocation_hook* previous;
+};
+
+}
+
+BOOST_AUTO_TEST_CASE (query_paths) {
+    const var doc = make_map("a", make_map("b", make_vector(1)(2)(make_map("c d", 3))))("x/y", 4);
+    BOOST_CHECK(query(".").run(doc) == make_vector(doc));
+    BOOST_CHECK(query(".a.b[1]").run(doc) == make_vector(2));
+    BOOST_CHECK(query(".a.b[2].\"c d\"").run(doc) == make_vector(3));
+    BOOST_CHECK(query(".\"x/y\"").run(doc) == make_vector(4));
+    BOOST_CHECK(query(".a.b[]").run(doc) == make_vector(1)(2)(make_map("c d", 3)));
+    BOOST_CHECK(query(".missing").run(doc) == make_vector(none));
+    BOOST_CHECK(query(".missing[]").run(doc) == make_vector());
+    BOOST_CHECK(query(".a | .b | .[] | .\"c d\"").run(doc) == make_vector(none)(none)(3));
+    BOOST_CHECK_EQUAL(query(" .a.b[] ").str(), " .a.b[] ");
+}
+
+BOOST_AUTO_TEST_CASE (query_select) {
+    const var doc = make_orders(40);
+    var result = query(".items[] | select(.price > 19) | .id").run(doc);
+    BOOST_CHECK(result == make_vector(19)(39));
+
+    // ints and doubles compare by value
+    BOOST_CHECK_EQUAL(query(".items[] | select(.price == 3.5)").run(doc).count(), 2);
+    BOOST_CHECK_EQUAL(query(".items[] | select(.stock.count == 0.0)").run(doc).count(), 14);
+
+    BOOST_CHECK_EQUAL(query(".items[] | select(.id < 10 and not (.stock.count != 1))").run(doc).count(), 3);
+    BOOST_CHECK_EQUAL(query(".items[] | select(.id >= 38 or .id <= 1)").run(doc).count(), 4);
+    BOOST_CHECK_EQUAL(query(".items[] | select(.name == \"item\")").run(doc).count(), 40);
+    BOOST_CHECK_EQUAL(query(".items[] | select(.stock.count)").run(doc).count(), 40);
+    BOOST_CHECK_EQUAL(query(".items[] | select(.missing)").run(doc).count(), 0);
+    BOOST_CHECK_EQUAL(query(".items[] | select(.missing == null)").run(doc).count(), 40);
+    BOOST_CHECK_EQUAL(query(".items[] | select(true)").run(doc).count(), 40);
+}
+
+BOOST_AUTO_TEST_CASE (query_project) {
+    const var doc = make_orders(4);
+    var result = query(".items[] | {id, price, n: .stock.count, absent}").run(doc);
+    BOOST_REQUIRE_EQUAL(result.count(), 4);
+    BOOST_CHECK(result[1] == make_map("id", 1)("price", 1.5)("n", 1)("absent", none));
+
+    // select after a project sees the projected names, and is pushed before it
+    result = query(".items[] | {id, n: .stock.count} | select(.n == 2 and .id > 0) | .id").run(doc);
+    BOOST_CHECK(result == make_vector(2));
+    result = query(".items[] | {id: .price, price: .id} | select(.id == 2.5 and .price == 2)").run(doc);
+    BOOST_CHECK(result == make_vector(make_map("id", 2.5)("price", 2)));
+    result = query(".items[] | {\"the id\": .id} | select(.\"the id\" == 3)").run(doc);
+    BOOST_CHECK(result == make_vector(make_map("the id", 3)));
+}
+
+BOOST_AUTO_TEST_CASE (query_maps) {
+    const var doc = make_map("a", make_map("x", 1)("y", 2)("z", 3));
+    BOOST_CHECK(query(".a[] | select(. >= 2)").run(doc) == make_vector(2)(3));
+}
+
+BOOST_AUTO_TEST_CASE (query_threads) {
+    const var doc = make_orders(int(query::min_chunk) * 3 + 7);
+    const query q(".items[] | select(.stock.count == 1) | {id}");
+    var serial = q.run(doc, 1);
+    BOOST_CHECK_EQUAL(serial.count(), int(query::min_chunk) + 2);
+    BOOST_CHECK(q.run(doc, 3) == serial);
+    BOOST_CHECK(q.run(doc, 64) == serial);
+    BOOST_CHECK(q.run(doc) == serial);
+}
+
+BOOST_AUTO_TEST_CASE (query_thread_errors) {
+    failing_maps hook;
+    {
+        const var doc = make_orders(int(query::min_chunk) * 2);
+        const query q(".items[] | {id}");
+        // an error in a worker reaches the caller instead of terminating
+        hook.armed = true;
+        BOOST_CHECK_THROW(q.run(doc, 2), std::bad_alloc);
+        hook.armed = false;
+        BOOST_CHECK_EQUAL(q.run(doc, 2).count(), int(query::min_chunk) * 2);
+    }
+}
+
+BOOST_AUTO_TEST_CASE (query_errors) {
+    BOOST_CHECK_THROW(query(""), exception);
+    BOOST_CHECK_THROW(query("items"), exception);
+    BOOST_CHECK_THROW(query(".a |"), exception);
+    BOOST_CHECK_THROW(query(".a[x]"), exception);
+    BOOST_CHECK_THROW(query(".a[0"), exception);
+    BOOST_CHECK_THROW(query("select(.a > )"), exception);
+    BOOST_CHECK_THROW(query("select(.a[] > 1)"), exception);
+    BOOST_CHECK_THROW(query("select(.a"), exception);
+    BOOST_CHECK_THROW(query("{a: .b[]}"), exception);
+    BOOST_CHECK_THROW(query(".\"a"), exception);
+    BOOST_CHECK_THROW(query(".a .b"), exception);
+}
@@ -0,0 +1,136 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+namespace {
+
+///
+/// installs an allocation_counter for the lifetime of the test
+///
+struct counting {
+    counting() : previous(set_allocation_hook(&counter)) {}
+    ~counting() { set_allocation_hook(previous); }
+
+    allocation_counter counter;
+    allocation_hook* previous;
+};
+
+var make_tree(int n) {
+    var tree = make_vector();
+    for (int i = 0; i < n; ++i)
+        tree(make_map("id", i)("name", "a long enough string to leave the small buffer"));
+    return tree;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE (var_move) {
+    var a = make_vector(1)(2);
+    var b(std::move(a));
+    BOOST_CHECK(a.is_null());
+    BOOST_CHECK_EQUAL(b.count(), 2);
+
+    var c = "three";
+    c = std::move(b);
+    BOOST_CHECK(b.is_null());
+    BOOST_CHECK_EQUAL(c.count(), 2);
+
+    // moving a member over its own collection
+    var doc = make_map("inner", make_vector(4)(5));
+    doc = std::move(doc["inner"]);
+    BOOST_CHECK(doc.is_vector());
+    BOOST_CHECK_EQUAL(int(doc[1]), 5);
+
+    c = std::move(c);
+    BOOST_CHECK_EQUAL(c.count(), 2);
+}
+
+BOOST_AUTO_TEST_CASE (reclaimer_frees_in_background) {
+    counting c;
+    {
+        reclaimer r;
+        var tree = make_tree(1000);
+        BOOST_CHECK(c.counter.bytes_in_use() > 0);
+        BOOST_CHECK(r.dispose(std::move(tree)));
+        BOOST_CHECK(tree.is_null());
+        r.drain();
+        BOOST_CHECK_EQUAL(r.pending(), 0);
+        BOOST_CHECK_EQUAL(c.counter.bytes_in_use(), 0);
+    }
+    for (int kind = 0; kind < payload_kind_count; ++kind)
+        BOOST_CHECK_EQUAL(c.counter.allocations(payload_kind(kind)), c.counter.frees(payload_kind(kind)));
+}
+
+BOOST_AUTO_TEST_CASE (reclaimer_fallback) {
+    counting c;
+    reclaimer r(1);
+
+    // scalars and strings are released at once
+    var s = "a long enough string to leave the small buffer";
+    BOOST_CHECK(!r.dispose(std::move(s)));
+    BOOST_CHECK(s.is_null());
+    BOOST_CHECK_EQUAL(c.counter.bytes_in_use(payload_string), 0);
+
+    // a shared tree stays alive through its other reference
+    var tree = make_tree(10);
+    var copy = tree;
+    r.dispose(std::move(tree));
+    r.drain();
+    BOOST_CHECK_EQUAL(copy.count(), 10);
+    BOOST_CHECK_EQUAL(int(copy[9]["id"]), 9);
+
+    // whatever does not fit on the queue is released by the caller
+    int queued = 0;
+    for (int i = 0; i < 100; ++i)
+        queued += r.dispose(make_tree(10));
+    BOOST_CHECK(queued >= 1 && queued <= 100);
+    BOOST_CHECK(r.pending() <= r.capacity());
+    copy = none;
+    r.drain();
+    BOOST_CHECK_EQUAL(c.counter.bytes_in_use(), 0);
+}
+
+BOOST_AUTO_TEST_CASE (reclaimer_deep_tree) {
+    var deep = make_vector();
+    for (int i = 0; i < 100000; ++i)
+        deep = make_vector(deep);
+    BOOST_CHECK(dispose_async(std::move(deep)));
+    default_reclaimer().drain();
+}
+
+BOOST_AUTO_TEST_CASE (reclaimer_dtor_drains) {
+    counting c;
+    {
+        reclaimer r;
+        for (int i = 0; i < 20; ++i)
+            r.dispose(make_tree(100));
+    }
+    BOOST_CHECK_EQUAL(c.counter.bytes_in_use(), 0);
+}
@@ -0,0 +1,142 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+namespace {
+
+var make_orders(int n) {
+    var orders = make_vector();
+    for (int i = 0; i < n; ++i)
+        orders(make_map("id", i)("customer", make_map("name", i % 3 ? "ann" : "bob"))("total", i % 10 * 2.5));
+    return orders;
+}
+
+typedef std::vector<var::size_type> positions;
+
+}
+
+BOOST_AUTO_TEST_CASE (record_index_hash) {
+    var orders = make_orders(30);
+    orders(make_map("note", "no id"));
+    const record_index by_id(orders, "/id");
+    BOOST_CHECK_EQUAL(by_id.kind(), record_index::hash);
+    BOOST_CHECK_EQUAL(by_id.size(), 31);
+    BOOST_CHECK(by_id.find(7) == positions(1, 7));
+    BOOST_CHECK(by_id.find(30).empty());
+    BOOST_CHECK(by_id.find("7").empty());
+    BOOST_REQUIRE(by_id.first(12));
+    BOOST_CHECK(*by_id.first(12) == orders[12]);
+    BOOST_CHECK(!by_id.first(none));
+    BOOST_CHECK_THROW(by_id.range(0, 10), exception);
+
+    const record_index by_name(orders, path("/customer/name"));
+    BOOST_CHECK_EQUAL(by_name.count("bob"), 10);
+    BOOST_CHECK_EQUAL(by_name.count("ann"), 20);
+    positions bobs = by_name.find("bob");
+    BOOST_REQUIRE_EQUAL(bobs.size(), 10);
+    BOOST_CHECK_EQUAL(bobs[0], 0);
+    BOOST_CHECK_EQUAL(bobs[9], 27);
+}
+
+BOOST_AUTO_TEST_CASE (record_index_sorted) {
+    var orders = make_orders(30);
+    const record_index by_total(orders, "/total", record_index::sorted);
+    BOOST_CHECK_EQUAL(by_total.count(5.0), 3);
+    BOOST_CHECK(by_total.find(5.0) == positions({ 2, 12, 22 }));
+    BOOST_CHECK(by_total.range(2.5, 7.5) == positions({ 1, 11, 21, 2, 12, 22 }));
+    BOOST_CHECK(by_total.range(100.0, 200.0).empty());
+    BOOST_CHECK_EQUAL(by_total.range(none, 1000.0).size(), 30);
+    BOOST_CHECK(by_total.first(22.5) == &orders[9]);
+}
+
+BOOST_AUTO_TEST_CASE (record_index_append) {
+    var orders = make_orders(10);
+    record_index by_id(orders, "/id");
+    record_index by_total(orders, "/total", record_index::sorted);
+
+    by_id(make_map("id", 100)("total", 1.0));
+    BOOST_CHECK_EQUAL(orders.count(), 11);
+    BOOST_CHECK(by_id.find(100) == positions(1, 10));
+
+    // appended straight to the vector, picked up by update()
+    orders(make_map("id", 5)("total", 0.0));
+    BOOST_CHECK_EQUAL(by_id.count(5), 1);
+    by_id.update();
+    by_total.update();
+    BOOST_CHECK(by_id.find(5) == positions({ 5, 11 }));
+    BOOST_CHECK(by_total.find(0.0) == positions({ 0, 11 }));
+    BOOST_CHECK(by_total.range(0.0, 2.0) == positions({ 0, 11, 10 }));
+
+    // a shrunk vector is indexed again
+    orders = make_orders(3);
+    by_id.update();
+    BOOST_CHECK_EQUAL(by_id.size(), 3);
+    BOOST_CHECK(by_id.find(100).empty());
+}
+
+BOOST_AUTO_TEST_CASE (record_index_read_only_records) {
+    // lookups never detach the records
+    var orders = make_orders(20);
+    const var shared = orders;
+    const record_index by_id(orders, "/id");
+    BOOST_REQUIRE(by_id.first(3));
+    BOOST_CHECK(by_id.first(3) == &shared[3]);
+
+    var frozen = make_orders(20).freeze();
+    const record_index frozen_by_id(frozen, "/id", record_index::sorted);
+    BOOST_REQUIRE(frozen_by_id.first(5));
+    BOOST_CHECK((*frozen_by_id.first(5))["id"] == 5);
+
+    var page = make_orders(20).slice(10, 5);
+    const record_index page_by_id(page, "/id");
+    BOOST_REQUIRE(page_by_id.first(12));
+    BOOST_CHECK((*page_by_id.first(12))["id"] == 12);
+    BOOST_CHECK(page.is_slice());
+}
+
+BOOST_AUTO_TEST_CASE (record_index_threads) {
+    var orders = make_orders(int(record_index::min_chunk) * 3 + 5);
+    const record_index serial(orders, "/customer/name", record_index::hash, 1);
+    const record_index parallel(orders, "/customer/name", record_index::hash, 3);
+    BOOST_CHECK(serial.find("bob") == parallel.find("bob"));
+    BOOST_CHECK(serial.find("ann") == parallel.find("ann"));
+
+    const record_index sorted_serial(orders, "/total", record_index::sorted, 1);
+    const record_index sorted_parallel(orders, "/total", record_index::sorted, 3);
+    BOOST_CHECK(sorted_serial.range(5.0, 10.0) == sorted_parallel.range(5.0, 10.0));
+    BOOST_CHECK(sorted_serial.find(0.0) == sorted_parallel.find(0.0));
+}
+
+BOOST_AUTO_TEST_CASE (record_index_errors) {
+    var scalar = 1;
+    BOOST_CHECK_THROW(record_index(scalar, "/id"), exception);
+    var map = make_map();
+    BOOST_CHECK_THROW(record_index(map, "/id", record_index::sorted), exception);
+}
@@ -182,3 +182,42 @@ BOOST_FIXTURE_TEST_CASE (relational_eq_string_charp, eq_fixture) {
     BOOST_CHECK(!(vca == vsb));
     BOOST_CHECK(!(vca == _vsb));
 }
+
+BOOST_AUTO_TEST_CASE (relational_eq_strings_by_content) {
+    BOOST_CHECK(var("") == "");
+    BOOST_CHECK(var("") == std::string());
+    BOOST_CHECK(!(var("abc") == "abcd"));
+    BOOST_CHECK(!(var("abcd") == "abc"));
+    BOOST_CHECK(var(std::string("a\0b", 3)) == std::string("a\0b", 3));
+    BOOST_CHECK(!(var(std::string("a\0b", 3)) == std::string("a\0c", 3)));
+    BOOST_CHECK(var(L"wide") == L"wide");
+    BOOST_CHECK(var(L"wide") == std::wstring(L"wide"));
+    BOOST_CHECK(!(var(L"wide") == L"wider"));
+    BOOST_CHECK(!(var("wide") == L"wide"));
+}
+
+BOOST_AUTO_TEST_CASE (relational_eq_collections) {
+    var a = make_vector(1)(make_map("k", make_vector("x")("y")));
+    var shared = a;
+    BOOST_CHECK(a == shared);
+    BOOST_CHECK(a == a.deep_clone());
+
+    // a shorter right hand side is unequal, never read past its end
+    BOOST_CHECK(!(make_vector(1)(2)(3) == make_vector(1)(2)));
+    BOOST_CHECK(!(make_vector(1)(2) == make_vector(1)(2)(3)));
+    BOOST_CHECK(!(make_map(1, 2) == make_map(1, 2)(3, 4)));
+
+    var b = a.deep_clone();
+    b[1]["k"][1] = "z";
+    BOOST_CHECK(!(a == b));
+    BOOST_CHECK(a[0] == b[0]);
+
+    // frozen trees with known fingerprints
+    var fa = a.deep_clone().freeze(), fb = b.deep_clone().freeze(), fc = a.deep_clone().freeze();
+    fingerprint_of(fa);
+    fingerprint_of(fb);
+    fingerprint_of(fc);
+    BOOST_CHECK(!(fa == fb));
+    BOOST_CHECK(fa == fc);
+    BOOST_CHECK(fa == a);
+}
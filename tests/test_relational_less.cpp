@@ -0,0 +1,143 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+namespace {
+
+const var::less_var less;
+
+/// @return true if lhs and rhs are equivalent under less_var
+bool equivalent(const var& lhs, const var& rhs) { return !less(lhs, rhs) && !less(rhs, lhs); }
+
+}
+
+BOOST_AUTO_TEST_CASE (relational_less_vectors) {
+    BOOST_CHECK(less(make_vector(1)(2), make_vector(1)(3)));
+    BOOST_CHECK(!less(make_vector(1)(3), make_vector(1)(2)));
+    // a prefix comes first
+    BOOST_CHECK(less(make_vector(), make_vector(0)));
+    BOOST_CHECK(less(make_vector(1)(2), make_vector(1)(2)(0)));
+    BOOST_CHECK(less(make_vector(make_vector(1)), make_vector(make_vector(1)(0))));
+    BOOST_CHECK(equivalent(make_vector(1)("a"), make_vector(1)("a")));
+    // by type first, whatever the members
+    BOOST_CHECK(less(make_vector(9), make_map(0, 0)));
+    BOOST_CHECK(less(make_vector(9), make_persistent_vector()(0)));
+    BOOST_CHECK(less(var("z"), make_vector()));
+
+    var shared = make_vector(1)(2);
+    BOOST_CHECK(equivalent(shared, shared));
+    BOOST_CHECK_EQUAL(var::compare(shared, make_vector(1)(2)), 0);
+    BOOST_CHECK(var::compare(make_vector(1), make_vector(2)) < 0);
+    BOOST_CHECK(var::compare(make_vector(2), make_vector(1)) > 0);
+}
+
+BOOST_AUTO_TEST_CASE (relational_less_maps) {
+    BOOST_CHECK(less(make_map(1, "a"), make_map(1, "b")));
+    BOOST_CHECK(less(make_map(1, "z"), make_map(2, "a")));
+    BOOST_CHECK(less(make_map(1, "a"), make_map(1, "a")(2, "b")));
+    BOOST_CHECK(equivalent(make_map(1, "a")(2, "b"), make_map(2, "b")(1, "a")));
+
+    var p = make_persistent_map(), q = make_persistent_map();
+    for (int i = 0; i < 50; ++i) {
+        p(i, i);
+        q(49 - i, 49 - i);
+    }
+    BOOST_CHECK(equivalent(p, q));
+    q[7] = -1;
+    BOOST_CHECK(!equivalent(p, q));
+}
+
+BOOST_AUTO_TEST_CASE (relational_less_collection_keys) {
+    // distinct collections stay distinct keys
+    var m = make_map();
+    m(make_vector(1)(2), "first");
+    m(make_vector(1)(3), "second");
+    m(make_map("k", 1), "third");
+    m[make_vector(1)(2)] = "replaced";
+    BOOST_CHECK_EQUAL(m.count(), 3);
+    BOOST_CHECK(m[make_vector(1)(2)] == "replaced");
+    BOOST_CHECK(m[make_vector(1)(3)] == "second");
+    BOOST_CHECK(m[make_map("k", 1)] == "third");
+
+    var p = make_persistent_map();
+    p(make_vector("a"), 1)(make_vector("b"), 2)(make_vector("a"), 3);
+    BOOST_CHECK_EQUAL(p.count(), 2);
+    BOOST_CHECK(p[make_vector("a")] == 1);
+    BOOST_CHECK(p[make_vector("b")] == 2);
+
+    concurrent_map c;
+    c.insert_or_assign(make_vector(1), "one");
+    c.insert_or_assign(make_vector(2), "two");
+    BOOST_CHECK_EQUAL(c.count(), 2);
+}
+
+BOOST_AUTO_TEST_CASE (relational_less_total_order) {
+    std::vector<var> values;
+    values.push_back(none);
+    values.push_back(1);
+    values.push_back("a");
+    values.push_back(make_vector());
+    values.push_back(make_vector(1));
+    values.push_back(make_vector(1)(2));
+    values.push_back(make_vector(make_vector(1)));
+    values.push_back(make_vector(make_vector(2)));
+    values.push_back(make_map());
+    values.push_back(make_map(1, 2));
+    values.push_back(make_map(1, make_vector(2)));
+    values.push_back(make_persistent_vector()(1));
+    values.push_back(make_persistent_map()(1, 2));
+    for (std::size_t i = 0; i < values.size(); ++i)
+        for (std::size_t j = 0; j < values.size(); ++j) {
+            BOOST_CHECK_EQUAL(equivalent(values[i], values[j]), values[i] == values[j]);
+            BOOST_CHECK_EQUAL(less(values[i], values[j]), var::compare(values[i], values[j]) < 0);
+            for (std::size_t k = 0; k < values.size(); ++k)
+                if (less(values[i], values[j]) && less(values[j], values[k]))
+                    BOOST_CHECK(less(values[i], values[k]));
+        }
+
+    std::vector<var> sorted(values.rbegin(), values.rend());
+    std::sort(sorted.begin(), sorted.end(), less);
+    for (std::size_t i = 1; i < sorted.size(); ++i)
+        BOOST_CHECK(less(sorted[i - 1], sorted[i]));
+}
+
+BOOST_AUTO_TEST_CASE (relational_less_deep) {
+    var a = make_vector(), b = make_vector();
+    for (int i = 0; i < 100000; ++i) {
+        a = make_vector(a);
+        b = make_vector(b);
+    }
+    BOOST_CHECK(equivalent(a, b));
+    b = make_vector(b)(1);
+    BOOST_CHECK(less(make_vector(a), b));
+}
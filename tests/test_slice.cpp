@@ -0,0 +1,130 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <sstream>
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+namespace {
+
+var numbers(int n) {
+    var list = make_vector();
+    for (int i = 0; i < n; ++i)
+        list(i);
+    return list;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE (slice_reads) {
+    const var list = numbers(10);
+    const var page = list.slice(2, 3);
+    BOOST_CHECK(page.is_slice());
+    BOOST_CHECK(page.is_collection());
+    BOOST_CHECK(!page.is_vector());
+    BOOST_CHECK_EQUAL(page.name(), "slice");
+    BOOST_CHECK_EQUAL(page.count(), 3);
+    BOOST_CHECK(page[0] == 2);
+    BOOST_CHECK(page[2] == 4);
+    BOOST_CHECK_THROW(page[3], exception);
+
+    // the elements are the parent's own
+    BOOST_CHECK(&page[0] == &list[2]);
+    int expected = 2;
+    for (var::const_iterator it = page.begin(); it != page.end(); ++it)
+        BOOST_CHECK(*it == expected++);
+    BOOST_CHECK_EQUAL(expected, 5);
+
+    // a slice of a slice refers to the same parent
+    const var inner = page.slice(1, 10);
+    BOOST_CHECK(inner.is_slice());
+    BOOST_CHECK_EQUAL(inner.count(), 2);
+    BOOST_CHECK(&inner[0] == &list[3]);
+}
+
+BOOST_AUTO_TEST_CASE (slice_bounds) {
+    const var list = numbers(5);
+    BOOST_CHECK_EQUAL(list.slice(3, 100).count(), 2);
+    BOOST_CHECK_EQUAL(list.slice(5, 1).count(), 0);
+    BOOST_CHECK_THROW(list.slice(6, 1), exception);
+    BOOST_CHECK_THROW(make_map("a", 1).slice(0, 1), exception);
+    BOOST_CHECK_THROW(var(1).slice(0, 1), exception);
+}
+
+BOOST_AUTO_TEST_CASE (slice_equals_vector) {
+    const var list = numbers(6);
+    const var page = list.slice(1, 3);
+    BOOST_CHECK(page == make_vector(1)(2)(3));
+    BOOST_CHECK(make_vector(1)(2)(3) == page);
+    BOOST_CHECK(page != make_vector(1)(2));
+    BOOST_CHECK(page == numbers(4).slice(1, 3));
+    BOOST_CHECK_EQUAL(hash(page), hash(make_vector(1)(2)(3)));
+    BOOST_CHECK_EQUAL(var::compare(page, make_vector(1)(2)(3)), 0);
+    BOOST_CHECK(page < make_vector(1)(2)(4));
+    BOOST_CHECK(make_vector(1)(2) < page);
+}
+
+BOOST_AUTO_TEST_CASE (slice_copy_on_write) {
+    var list = numbers(6);
+    var page = list.slice(1, 3);
+
+    // a mutation turns the slice into a vector of its own
+    page(99);
+    BOOST_CHECK(page.is_vector());
+    BOOST_CHECK(page == make_vector(1)(2)(3)(99));
+    BOOST_CHECK(list == numbers(6));
+
+    // a mutated parent detaches from the node the slice refers to
+    var other = list.slice(0, 2);
+    list[0] = 42;
+    BOOST_CHECK(other == make_vector(0)(1));
+    BOOST_CHECK(list[0] == 42);
+}
+
+BOOST_AUTO_TEST_CASE (slice_in_tree) {
+    const var list = numbers(4);
+    var doc = make_map("page", list.slice(1, 2));
+    std::ostringstream out;
+    out << doc;
+    BOOST_CHECK_EQUAL(out.str(), "{ \"page\" : [ 1, 2 ] }");
+
+    BOOST_CHECK(*path("/page/1").find(doc) == 2);
+    BOOST_CHECK(path("/page/2").find(doc) == 0);
+
+    const var copy = doc.deep_clone();
+    BOOST_CHECK(copy["page"].is_vector());
+    BOOST_CHECK(copy == doc);
+
+    BOOST_CHECK(memory_usage(doc).total() > 0);
+
+    var root = list.slice(0, 2);
+    root.freeze();
+    BOOST_CHECK(root.is_vector());
+    BOOST_CHECK(root.is_frozen());
+}
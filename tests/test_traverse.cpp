@@ -0,0 +1,158 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <sstream>
+#include <string>
+
+#include <boost/functional/hash.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+#include <dynamic/traverse.hpp>
+
+using namespace dynamic;
+
+/// @return one letter per event: e(nter), l(eave) or v (leaf), with the role of each var
+static std::string events(const var& v) {
+    std::string result;
+    for (tree_walker w(v); w.next(); ) {
+        result += "elv"[w.event()];
+        result += "rekv"[w.role()];
+    }
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE (walk_events) {
+    BOOST_CHECK_EQUAL(events(var(1)), "vr");
+    BOOST_CHECK_EQUAL(events(make_vector()), "erlr");
+    BOOST_CHECK_EQUAL(events(make_vector(1)(make_vector(2))), "erveeevelelr");
+    BOOST_CHECK_EQUAL(events(make_map("a", 1)("b", make_vector())), "ervkvvvkevlvlr");
+    BOOST_CHECK_EQUAL(events(make_persistent_vector()(1)(2)), "ervevelr");
+}
+
+BOOST_AUTO_TEST_CASE (walk_positions) {
+    var doc = make_map("a", make_vector(10)(20))("b", 2);
+    tree_walker w(doc);
+    BOOST_CHECK(w.next() && w.event() == tree_walker::enter && w.depth() == 0);
+    BOOST_CHECK(w.next() && w.node() == "a" && w.index() == 0 && w.depth() == 1);
+    BOOST_CHECK(w.next() && w.event() == tree_walker::enter && w.role() == tree_walker::value);
+    BOOST_CHECK(w.next() && w.node() == 10 && w.index() == 0 && w.depth() == 2);
+    BOOST_CHECK(w.next() && w.node() == 20 && w.index() == 1);
+    BOOST_CHECK(w.next() && w.event() == tree_walker::leave && w.role() == tree_walker::value && w.index() == 0);
+    BOOST_CHECK(w.next() && w.node() == "b" && w.index() == 1);
+    BOOST_CHECK(w.next() && w.node() == 2 && w.role() == tree_walker::value);
+    BOOST_CHECK(w.next() && w.event() == tree_walker::leave && w.role() == tree_walker::root);
+    BOOST_CHECK(!w.next());
+}
+
+BOOST_AUTO_TEST_CASE (walk_skip) {
+    var doc = make_vector(make_vector(1)(2))(3);
+    std::string result;
+    for (tree_walker w(doc); w.next(); ) {
+        if (w.event() == tree_walker::enter && w.depth() == 1) w.skip();
+        result += "elv"[w.event()];
+    }
+    BOOST_CHECK_EQUAL(result, "eelvl");
+}
+
+/// @return a vector nested depth levels deep around an int
+static var nest(int depth) {
+    var v = 1;
+    for (int i = 0; i < depth; ++i)
+        v = make_vector(v);
+    return v;
+}
+
+BOOST_AUTO_TEST_CASE (deep_nesting) {
+    // far deeper than a recursive walk could go on a default stack
+    const int depth = 200000;
+    var a = nest(depth);
+    var b = nest(depth);
+    BOOST_CHECK(a == b);
+    var c = nest(depth - 1);
+    BOOST_CHECK(a != c);
+
+    std::ostringstream os;
+    os << a;
+    BOOST_CHECK_EQUAL(os.str().size(), std::size_t(depth * 4 + 1));
+
+    boost::hash<var> hasher;
+    BOOST_CHECK_EQUAL(hasher(a), hasher(b));
+
+    const memory_report usage = memory_usage(a);
+    BOOST_CHECK_EQUAL(usage.nodes[payload_vector], std::size_t(depth));
+
+    a.freeze();
+    BOOST_CHECK(a.is_frozen());
+    var d = a.deep_clone();
+    BOOST_CHECK(!d.is_frozen());
+    BOOST_CHECK(d == b);
+
+    // teardown is iterative as well
+    a = none;
+    b = none;
+    c = none;
+    d = none;
+}
+
+/// @return depth levels of maps, persistent vectors and persistent maps in turn around an int
+static var nest_mixed(int depth) {
+    var v = 1;
+    for (int i = 0; i < depth; ++i)
+        switch (i % 3) {
+        case 0 :    v = make_map("k", v); break;
+        case 1 :    v = make_persistent_vector()(v); break;
+        default :   v = make_persistent_map()("k", v); break;
+        }
+    return v;
+}
+
+BOOST_AUTO_TEST_CASE (deep_nesting_collections) {
+    // every walk in the library keeps its stack use flat for each kind of collection
+    const int depth = 200000;
+    var a = nest_mixed(depth);
+    var b = nest_mixed(depth);
+    BOOST_CHECK(a == b);
+    BOOST_CHECK_EQUAL(var::compare(a, b), 0);
+    BOOST_CHECK_EQUAL(hash_value(a), hash_value(b));
+    BOOST_CHECK(fingerprint_of(a) == fingerprint_of(b));
+
+    std::ostringstream os;
+    os << a;
+    BOOST_CHECK(!os.str().empty());
+
+    const memory_report usage = memory_usage(a);
+    BOOST_CHECK_EQUAL(usage.nodes[payload_map], std::size_t(depth / 3 + 1));
+
+    var c = a.deep_clone();
+    BOOST_CHECK(c == b);
+    a.freeze();
+    BOOST_CHECK(a.is_frozen());
+    BOOST_CHECK(a == c);
+
+    a = none;
+    b = none;
+    c = none;
+}
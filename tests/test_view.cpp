@@ -0,0 +1,113 @@
+/*
+    Copyright (C) 2009, 2011 Ferruccio Barletta (ferruccio.barletta@gmail.com)
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <sstream>
+
+#include <boost/test/unit_test.hpp>
+
+#include <dynamic/dynamic.hpp>
+
+using namespace dynamic;
+
+namespace {
+
+bool odd(const var& v) { return int(v) % 2 != 0; }
+var square(const var& v) { return int(v) * int(v); }
+
+}
+
+BOOST_AUTO_TEST_CASE (view_sources) {
+    const var list = make_vector(1)(2)(3);
+    BOOST_CHECK(view(list).to_var() == list);
+    BOOST_CHECK_EQUAL(view(list).count(), 3);
+    BOOST_CHECK(view(make_vector()).empty());
+
+    const var map = make_map("a", 1)("b", 2);
+    BOOST_CHECK(keys(map).to_var() == make_vector("a")("b"));
+    BOOST_CHECK(view(map).to_var() == make_vector("a")("b"));
+    BOOST_CHECK(values(map).to_var() == make_vector(1)(2));
+
+    var persistent = make_persistent_vector();
+    persistent(4)(5);
+    BOOST_CHECK(view(persistent).to_var() == make_vector(4)(5));
+
+    // iteration refers to the collection's own elements
+    view_iterator<collection_view::cursor_type> it = view(list).begin();
+    BOOST_CHECK(&*it == &list[0]);
+    BOOST_CHECK(++it != view(list).end());
+    BOOST_CHECK(*it++ == 2);
+    BOOST_CHECK(*it == 3);
+    BOOST_CHECK(++it == view(list).end());
+}
+
+BOOST_AUTO_TEST_CASE (view_adaptors_compose) {
+    var list = make_vector();
+    for (int i = 0; i < 10; ++i)
+        list(i);
+    BOOST_CHECK(view(list).filter(odd).to_var() == make_vector(1)(3)(5)(7)(9));
+    BOOST_CHECK(view(list).transform(square).take(4).to_var() == make_vector(0)(1)(4)(9));
+    BOOST_CHECK(view(list).filter(odd).transform(square).drop(1).take(2).to_var() == make_vector(9)(25));
+    BOOST_CHECK(view(list).drop(8).to_var() == make_vector(8)(9));
+    BOOST_CHECK(view(list).drop(20).empty());
+    BOOST_CHECK(view(list).take(0).empty());
+    BOOST_CHECK_EQUAL(view(list).take(20).count(), 10);
+    BOOST_CHECK(values(make_map("x", 3)("y", 4)).transform([](const var& v) { return int(v) + 1; }).to_var() == make_vector(4)(5));
+
+    int sum = 0;
+    for (const var& v : view(list).filter([](const var& v) { return int(v) > 6; }))
+        sum += int(v);
+    BOOST_CHECK_EQUAL(sum, 7 + 8 + 9);
+}
+
+BOOST_AUTO_TEST_CASE (view_lazy) {
+    var list = make_vector(1)(2)(3)(4);
+    int calls = 0;
+    auto counted = view(list).transform([&calls](const var& v) { ++calls; return int(v) * 10; });
+    BOOST_CHECK_EQUAL(calls, 0);
+    BOOST_CHECK(counted.take(2).to_var() == make_vector(10)(20));
+    BOOST_CHECK_EQUAL(calls, 2);
+
+    // a view sees the collection as it is when iterated
+    list(5);
+    BOOST_CHECK_EQUAL(view(list).count(), 5);
+}
+
+BOOST_AUTO_TEST_CASE (view_write) {
+    const var list = make_vector(1)("two")(make_map("three", 3));
+    std::ostringstream expected, written;
+    expected << list;
+    written << view(list);
+    BOOST_CHECK_EQUAL(written.str(), expected.str());
+
+    std::ostringstream empty;
+    empty << view(list).take(0);
+    std::ostringstream empty_vector;
+    empty_vector << make_vector();
+    BOOST_CHECK_EQUAL(empty.str(), empty_vector.str());
+
+    std::wostringstream wwritten;
+    wwritten << view(list).filter([](const var& v) { return v.is_int(); }).transform([](const var& v) { return v; });
+    BOOST_CHECK(wwritten.str() == L"[ 1 ]");
+}